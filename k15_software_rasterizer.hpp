@@ -2,6 +2,7 @@
 #define K15_SOFTWARE_RASTERIZER_INCLUDE
 
 #include <stdint.h>
+#include <atomic>
 #include "k15_font.hpp"
 
 struct vector4f_t
@@ -24,6 +25,11 @@ struct vector2u_t
     uint32_t x, y;
 };
 
+struct vector2i_t
+{
+    int32_t x, y;
+};
+
 struct bounding_box_t
 {
     uint32_t x1, x2, y1, y2;
@@ -34,6 +40,16 @@ struct vertex_buffer_handle_t
     void* pHandle;
 };
 
+struct index_buffer_handle_t
+{
+    void* pHandle;
+};
+
+struct instance_buffer_handle_t
+{
+    void* pHandle;
+};
+
 struct uniform_buffer_handle_t
 {
     void* pHandle;
@@ -74,34 +90,133 @@ enum class sample_addressing_mode_t
     mirror
 };
 
+enum class index_format_t
+{
+    uint16 = 0,
+    uint32
+};
+
+enum class vertex_attribute_t
+{
+    position = 0,
+    normal,
+    color,
+    texcoord,
+
+    count
+};
+
+//FK: Format of a vertex attribute in the source vertex data.
+//    Missing components are 0, except for w of positions and colors which is 1.
+enum class vertex_attribute_format_t
+{
+    float2 = 0,
+    float3,
+    float4,
+    half2,
+    half4,
+    snorm8x4,
+    unorm8x4
+};
+
+//FK: How vertex attributes get interpolated across a triangle. Affine interpolation is cheaper but distorts attributes
+//    of triangles with a large depth range (eg: textures on floors), it's fine for small or screen aligned geometry.
+enum class interpolation_mode_t : uint8_t
+{
+    affine = 0,
+    perspective_correct
+};
+
+struct vertex_attribute_desc_t
+{
+    vertex_attribute_t          attribute;
+    vertex_attribute_format_t   format;
+    uint32_t                    offsetInBytes;
+};
+
+//FK: Describes interleaved source vertex data. Attributes that are not part of the layout don't get stored,
+//    transformed or interpolated - their content is undefined in the vertex and pixel shader. A position is required.
+struct vertex_layout_t
+{
+    vertex_attribute_desc_t     attributes[(uint32_t)vertex_attribute_t::count];
+    uint32_t                    attributeCount;
+    uint32_t                    strideInBytes;
+};
+
 struct software_rasterizer_context_t;
 
+//FK: Use std::thread::hardware_concurrency() - 1 worker threads
+constexpr uint32_t DefaultWorkerThreadCount = 0xFFFFFFFFu;
+
 struct software_rasterizer_context_init_parameters_t
 {
     uint32_t    backBufferWidth;
     uint32_t    backBufferHeight;
     uint32_t    colorBufferStride;
-    uint32_t    depthBufferStride;
+    uint32_t    depthBufferStride;          //FK: in pixels, has to be a multiple of 8 (depth buffers are read in 32 byte aligned spans)
     uint8_t     redShift;
     uint8_t     greenShift;
     uint8_t     blueShift;
     void*       pColorBuffers[3];
     void*       pDepthBuffers[3];
     uint8_t     colorBufferCount;
+    uint32_t    workerThreadCount;
+    uint64_t    workerThreadAffinityMask;   //FK: worker threads get pinned to the set bits of this mask (0 = no pinning)
+};
+
+//FK: workerIndex is 0 for the thread that created the context and 1..workerThreadCount for the worker threads
+typedef void(*job_fnc_t)(void* pJobData, uint32_t workerIndex);
+
+struct job_counter_t
+{
+    job_counter_t() : pendingJobCount(0u) {}
+
+    std::atomic<uint32_t> pendingJobCount;
+};
+
+struct frame_fence_t
+{
+    uint64_t frameNumber;
+};
+
+//FK: Result of the occlusion test of a draw call with bounds (see k15_set_draw_bounds).
+//    Gets written by k15_draw_frame before the geometry of the draw call would be processed.
+enum class occlusion_query_result_t : uint8_t
+{
+    pending = 0,
+    visible,
+    occluded
 };
 
-constexpr uint32_t PixelShaderTileSize     = 256u;
-constexpr uint32_t PixelShaderInputCount   = PixelShaderTileSize*PixelShaderTileSize;
-constexpr uint32_t VertexShaderInputCount  = 30u;
+constexpr uint32_t PixelShaderTileSize     = 32u;
 
-static_assert(( VertexShaderInputCount % 3u ) == 0);
+//FK: Max. number of pixels per pixel shader invocation, pixels of multiple triangles get batched until this is reached.
+//    Has to be at least PixelShaderTileSize * PixelShaderTileSize, the rasterizer reserves room for a whole tile at once.
+//    The per pixel buffers of a shading context take ~110 bytes per pixel, 2048 pixels keep a batch (~225 KB) in L2.
+constexpr uint32_t PixelShaderInputCount   = 2048u;
+
+//FK: Vertex attributes as separate streams (SoA), one element per vertex.
+//    Streams that are nullptr are not part of the vertex buffer (pPositions is required).
+struct vertex_streams_t
+{
+    const vector4f_t* pPositions;
+    const vector4f_t* pNormals;
+    const vector4f_t* pColors;
+    const vector2f_t* pTexcoords;
+};
 
+//FK: The vertex shader transforms the vertex streams in place.
+//    Every stream starts on a cache line and holds vertexCount elements.
 struct vertex_shader_input_t
 {
-    vector4f_t positions[VertexShaderInputCount];
-    vector4f_t normals[VertexShaderInputCount];
-    vector4f_t colors[VertexShaderInputCount];
-    vector2f_t texcoords[VertexShaderInputCount];
+    vector4f_t* positions;
+    vector4f_t* normals;
+    vector4f_t* colors;
+    vector2f_t* texcoords;
+
+    //FK: Only set for instanced draw calls, pInstanceData points to the data of instance instanceId
+    const void* pInstanceData;
+    uint32_t    instanceId;
 };
 
 struct vertex_t
@@ -114,16 +229,47 @@ struct vertex_t
 
 struct stack_allocator_t;
 
-struct pixel_shader_input_t
+//FK: Layout of the interpolated vertex attributes in pixel_shader_input_t.
+enum class pixel_shader_input_layout_t : uint8_t
 {
-    stack_allocator_t*  pStackAllocator;
-    vertex_t*           pVertexData;
-    float*              pDepth;
-    uint32_t*           pScreenspaceX;
-    uint32_t*           pScreenspaceY;
-    const void*         pUniformData;
+    vertex_data = 0,    //FK: pVertexData, one vertex_t per pixel
+    attribute_arrays    //FK: attributes, one array per component for pixel shaders that process 8 pixels at a time
+};
 
-    uint32_t            pixelCount;
+//FK: Interpolated vertex attributes with one array per component. The arrays are aligned to 32 bytes and padded
+//    to a multiple of 8 pixels so that the last pixels can be processed with full loads (the padding is undefined).
+struct pixel_shader_attributes_t
+{
+    float* pPositionX;
+    float* pPositionY;
+    float* pPositionZ;
+    float* pPositionW;
+    float* pNormalX;
+    float* pNormalY;
+    float* pNormalZ;
+    float* pNormalW;
+    float* pColorR;
+    float* pColorG;
+    float* pColorB;
+    float* pColorA;
+    float* pTexcoordU;
+    float* pTexcoordV;
+};
+
+//FK: Only the layout that the pixel shader has been created with contains the interpolated attributes.
+struct pixel_shader_input_t
+{
+    stack_allocator_t*          pStackAllocator;
+    vertex_t*                   pVertexData;
+    pixel_shader_attributes_t   attributes;
+    float*                      pDepth;
+    uint32_t*                   pScreenspaceX;
+    uint32_t*                   pScreenspaceY;
+    const uint32_t*             pHelperPixelMask;   //FK: 0xFFFFFFFF for helper pixels of a quad, nullptr if the pixels haven't been shaded as quads
+    const void*                 pUniformData;
+
+    uint32_t                    pixelCount;
+    pixel_shader_input_layout_t layout;
 };
 
 struct pixel_shader_output_t
@@ -151,31 +297,60 @@ struct pixel_t
 typedef void(*vertex_shader_fnc_t)(vertex_shader_input_t* pInOutVertices, uint32_t vertexCount, const void* pUniformData);
 typedef void(*pixel_shader_fnc_t)(const pixel_shader_input_t* pPixelShaderInput, pixel_shader_output_t* pPixelShaderOutput, uint32_t pixelCount, const void* pUniformData);
 
+//FK: Only the vertex attributes that a pixel shader declares get interpolated, the others are undefined
+//    in pixel_shader_input_t. The default desc declares all attributes and uses affine interpolation and pVertexData.
+//    Pixel shaders with quad shading get their pixels as 2x2 quads (top left, top right, bottom left, bottom right) so that
+//    they can call k15_calculate_derivatives. Uncovered pixels of a quad are helper pixels, their color doesn't get written.
+struct pixel_shader_desc_t
+{
+    pixel_shader_fnc_t          function;
+    interpolation_mode_t        interpolationMode;
+    pixel_shader_input_layout_t inputLayout;
+    bool                        quadShadingEnabled;
+    vertex_attribute_t          attributes[(uint32_t)vertex_attribute_t::count];
+    uint32_t                    attributeCount;
+};
+
 vertex_buffer_handle_t  k15_invalid_vertex_buffer_handle    = {nullptr};
+index_buffer_handle_t   k15_invalid_index_buffer_handle     = {nullptr};
+instance_buffer_handle_t k15_invalid_instance_buffer_handle = {nullptr};
 uniform_buffer_handle_t k15_invalid_uniform_buffer_handle   = {nullptr};
 texture_handle_t        k15_invalid_texture_handle          = {nullptr};
 vertex_shader_handle_t  k15_invalid_vertex_shader_handle    = {nullptr};
 pixel_shader_handle_t   k15_invalid_pixel_shader_handle     = {nullptr};
 
 software_rasterizer_context_init_parameters_t   k15_create_default_software_rasterizer_context_parameters();
+vertex_layout_t                                 k15_create_default_vertex_layout();
+pixel_shader_desc_t                             k15_create_default_pixel_shader_desc(pixel_shader_fnc_t pixelShaderFnc);
 
 bool                                            k15_create_software_rasterizer_context(software_rasterizer_context_t** pOutContextPtr, const software_rasterizer_context_init_parameters_t* pParameters);
+void                                            k15_destroy_software_rasterizer_context(software_rasterizer_context_t* pContext);
 
 void                                            k15_create_projection_matrix(matrix4x4f_t* pOutMatrix, uint32_t width, uint32_t height, float near, float far, float fov);
 void                                            k15_create_orthographic_matrix(matrix4x4f_t* pOutMatrix, uint32_t width, uint32_t height, float near, float far);
 void                                            k15_set_identity_matrix4x4f(matrix4x4f_t* pMatrix);
 
 void                                            k15_swap_color_buffers(software_rasterizer_context_t* pContext);
-void                                            k15_draw_frame(software_rasterizer_context_t* pContext);
+frame_fence_t                                   k15_draw_frame(software_rasterizer_context_t* pContext);
+void                                            k15_wait_frame(software_rasterizer_context_t* pContext, frame_fence_t frameFence);
+bool                                            k15_is_frame_complete(const software_rasterizer_context_t* pContext, frame_fence_t frameFence);
 
 void                                            k15_change_color_buffers(software_rasterizer_context_t* pContext, void* pColorBuffers[3], uint8_t colorBufferCount, uint32_t widthInPixels, uint32_t heightInPixels, uint32_t strideInBytes);
 
 bool                                            k15_is_valid_vertex_buffer(const vertex_buffer_handle_t vertexBuffer);
+bool                                            k15_is_valid_index_buffer(const index_buffer_handle_t indexBuffer);
+bool                                            k15_is_valid_instance_buffer(const instance_buffer_handle_t instanceBuffer);
 bool                                            k15_is_valid_texture(const texture_handle_t texture);
 
 vertex_shader_handle_t                          k15_create_vertex_shader(software_rasterizer_context_t* pContext, vertex_shader_fnc_t vertexShaderFnc);
 pixel_shader_handle_t                           k15_create_pixel_shader(software_rasterizer_context_t* pContext, pixel_shader_fnc_t vertexShaderFnc);
-vertex_buffer_handle_t                          k15_create_vertex_buffer(software_rasterizer_context_t* pContext, uint32_t vertexSizeInBytes, const vertex_t* pVertexData);
+pixel_shader_handle_t                           k15_create_pixel_shader_with_interpolation_mode(software_rasterizer_context_t* pContext, pixel_shader_fnc_t pixelShaderFnc, interpolation_mode_t interpolationMode);
+pixel_shader_handle_t                           k15_create_pixel_shader_from_desc(software_rasterizer_context_t* pContext, const pixel_shader_desc_t* pPixelShaderDesc);
+vertex_buffer_handle_t                          k15_create_vertex_buffer(software_rasterizer_context_t* pContext, const vertex_t* pVertexData, uint32_t vertexCount);
+vertex_buffer_handle_t                          k15_create_vertex_buffer_with_layout(software_rasterizer_context_t* pContext, const void* pVertexData, uint32_t vertexCount, const vertex_layout_t* pVertexLayout);
+vertex_buffer_handle_t                          k15_create_vertex_buffer_from_streams(software_rasterizer_context_t* pContext, const vertex_streams_t* pVertexStreams, uint32_t vertexCount);
+index_buffer_handle_t                           k15_create_index_buffer(software_rasterizer_context_t* pContext, const void* pIndexData, uint32_t indexCount, index_format_t indexFormat);
+instance_buffer_handle_t                        k15_create_instance_buffer(software_rasterizer_context_t* pContext, const void* pInstanceData, uint32_t instanceDataStrideInBytes, uint32_t instanceCount);
 uniform_buffer_handle_t                         k15_create_uniform_buffer(software_rasterizer_context_t* pContext, uint32_t uniformBufferSizeInBytes);
 texture_handle_t                                k15_create_texture(software_rasterizer_context_t* pContext, const char* pName, uint32_t width, uint32_t height, uint32_t stride, uint8_t componentCount, const void* pTextureData);
 
@@ -184,15 +359,28 @@ void                                            k15_set_uniform_buffer_data(unif
 void                                            k15_bind_vertex_shader(software_rasterizer_context_t* pContext, vertex_shader_handle_t vertexShaderHandle);
 void                                            k15_bind_pixel_shader(software_rasterizer_context_t* pContext, pixel_shader_handle_t pixelShaderHandle);
 void                                            k15_bind_vertex_buffer(software_rasterizer_context_t* pContext, vertex_buffer_handle_t vertexBuffer);
+void                                            k15_bind_index_buffer(software_rasterizer_context_t* pContext, index_buffer_handle_t indexBuffer);
+void                                            k15_bind_instance_buffer(software_rasterizer_context_t* pContext, instance_buffer_handle_t instanceBuffer);
 void                                            k15_bind_uniform_buffer(software_rasterizer_context_t* pContext, uniform_buffer_handle_t uniformBuffer);
 void                                            k15_bind_texture(software_rasterizer_context_t* pContext, texture_handle_t texture, uint32_t slot);
-bool                                            k15_draw(software_rasterizer_context_t* pContext, uint32_t vertexCount);
+bool                                            k15_draw(software_rasterizer_context_t* pContext, uint32_t vertexCount, uint32_t vertexOffset);
+bool                                            k15_draw_indexed(software_rasterizer_context_t* pContext, uint32_t indexCount, uint32_t indexOffset, uint32_t baseVertex);
+bool                                            k15_draw_instanced(software_rasterizer_context_t* pContext, uint32_t vertexCount, uint32_t instanceCount);
+bool                                            k15_draw_indexed_instanced(software_rasterizer_context_t* pContext, uint32_t indexCount, uint32_t indexOffset, uint32_t baseVertex, uint32_t instanceCount);
+void                                            k15_set_draw_bounds(software_rasterizer_context_t* pContext, const vector3f_t* pMin, const vector3f_t* pMax, const matrix4x4f_t* pClipSpaceTransform, occlusion_query_result_t* pOutQueryResult);
+void                                            k15_set_draw_bounding_sphere(software_rasterizer_context_t* pContext, const vector3f_t* pCenter, float radius, const matrix4x4f_t* pClipSpaceTransform, occlusion_query_result_t* pOutQueryResult);
 
 template<sample_addressing_mode_t ADDRESSING_MODE>
 texture_samples_t                               k15_sample_texture(texture_handle_t texture, const pixel_shader_input_t* pPixelShaderInput, uint32_t texcoordCount);
+void                                            k15_calculate_derivatives(const pixel_shader_input_t* pPixelShaderInput, const float* pValues, uint32_t valueStrideInFloats, float* pOutDdx, float* pOutDdy, uint32_t pixelCount);
 
 constexpr vertex_t                              k15_create_vertex(vector4f_t position, vector4f_t normal, vector4f_t color, vector2f_t texcoord);
 
+uint32_t                                        k15_get_worker_thread_count(const software_rasterizer_context_t* pContext);
+bool                                            k15_submit_jobs(software_rasterizer_context_t* pContext, job_fnc_t jobFunction, void* pJobData, uint32_t jobDataStrideInBytes, uint32_t jobCount, job_counter_t* pJobCounter);
+void                                            k15_wait_for_jobs(software_rasterizer_context_t* pContext, job_counter_t* pJobCounter);
+bool                                            k15_are_jobs_finished(const job_counter_t* pJobCounter);
+
 #ifdef K15_SOFTWARE_RASTERIZER_IMPLEMENTATION
 
 #ifdef _MSC_BUILD
@@ -235,6 +423,7 @@ constexpr vertex_t                              k15_create_vertex(vector4f_t pos
 #define internal static
 
 #include <limits.h>
+#include <float.h>
 #include <stddef.h>
 #include <stdarg.h>
 #include <string.h>
@@ -242,12 +431,78 @@ constexpr vertex_t                              k15_create_vertex(vector4f_t pos
 #include <malloc.h>
 #include <math.h>
 
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#if defined(_WIN32)
+#ifndef _WINDOWS_
+//FK: Avoid pulling in windows.h for a single function
+typedef void*               HANDLE;
+typedef unsigned __int64    DWORD_PTR;
+extern "C" __declspec(dllimport) DWORD_PTR __stdcall SetThreadAffinityMask(HANDLE hThread, DWORD_PTR dwThreadAffinityMask);
+#endif
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 constexpr uint32_t MaxColorBuffer                               = 3u;
 constexpr uint32_t DefaultTriangleBufferCapacity                = 1024u;
 constexpr uint32_t DefaultVertexBufferCapacity                  = 64u;
+constexpr uint32_t DefaultIndexBufferCapacity                   = 64u;
+constexpr uint32_t DefaultInstanceBufferCapacity                = 64u;
 constexpr uint32_t DefaultShaderCapacity                        = 32u;
 constexpr uint32_t DefaultTextureCapacity                       = 256u;
 constexpr uint32_t DefaultDrawCallCapacity                      = 512u;
+constexpr uint32_t DefaultJobCapacity                           = 256u;
+constexpr uint32_t InvalidWorkerIndex                           = 0xFFFFFFFFu;
+constexpr uint32_t MaxFramesInFlight                            = 2u;
+constexpr uint32_t DefaultScreenTileTriangleCapacity            = 256u;
+constexpr uint32_t GeometryJobTriangleCount                     = 512u;
+constexpr uint32_t GeometryJobIndexCount                        = GeometryJobTriangleCount * 3u;
+
+//FK: Open addressing hash table that maps vertex indices to post transform cache slots.
+//    Has to be a power of two and should be at least twice as big as GeometryJobIndexCount to keep probe chains short.
+constexpr uint32_t PostTransformCacheHashTableSize              = 4096u;
+constexpr uint32_t InvalidVertexIndex                           = 0xFFFFFFFFu;
+
+constexpr uint32_t ScreenTileSize                               = 64u;
+
+//FK: Size of the blocks that get classified as outside/partially/fully covered before testing individual pixels.
+//    Has to be a multiple of 8 (width of a raster span) and a divisor of PixelShaderTileSize.
+constexpr uint32_t RasterBlockSize                              = 8u;
+
+//FK: Screenspace vertex positions get snapped to 16.8 fixed point before rasterization.
+//    Edge setup and block classification are done in 64 bit, see raster_block_edges_t for the per pixel values.
+constexpr uint32_t SubPixelBits                                 = 8u;
+constexpr float    SubPixelScale                                = (float)(1u << SubPixelBits);
+
+//FK: Interpolated depth values are a convex combination of the triangle's vertex depths,
+//    the epsilon only has to cover float rounding of the interpolation.
+constexpr float    HiZDepthEpsilon                              = 1e-5f;
+
+//FK: Triangles that stay inside of the guard band don't get clipped against the screen edges, their bounding box gets clamped
+//    to the screen instead. The guard band spans GuardBandSizeInPixels in x and y (centered on the screen), the limit is the
+//    float precision of the screenspace positions which has to be below 1/256 pixel for the 16.8 fixed point snapping.
+constexpr float    GuardBandSizeInPixels                        = 16384.0f;
+
+//FK: Triangles that need clipping get clipped as a polygon against the guard band planes (x, y) and the near and far plane (z).
+//    Each plane adds at most one vertex to a convex polygon (9 vertices max), the rest is slack for numerically degenerate cases.
+constexpr uint32_t ClipPlaneCount                               = 6u;
+constexpr uint32_t ClipPolygonMaxVertexCount                    = 16u;
+
+//FK: Triangles whose bounding box is at most SmallTriangleMaxSize x SmallTriangleMaxSize pixels are set up 8 at a time
+//    and their pixels get shaded together. Has to be <= 8 (one raster span per row).
+constexpr uint32_t SmallTriangleMaxSize                         = 8u;
+constexpr uint32_t SmallTriangleBatchSize                       = 8u;
+
+constexpr uint32_t VertexAttributeMaskPosition                  = 1u << (uint32_t)vertex_attribute_t::position;
+constexpr uint32_t VertexAttributeMaskNormal                    = 1u << (uint32_t)vertex_attribute_t::normal;
+constexpr uint32_t VertexAttributeMaskColor                     = 1u << (uint32_t)vertex_attribute_t::color;
+constexpr uint32_t VertexAttributeMaskTexcoord                  = 1u << (uint32_t)vertex_attribute_t::texcoord;
+constexpr uint32_t VertexAttributeMaskAll                       = VertexAttributeMaskPosition | VertexAttributeMaskNormal | VertexAttributeMaskColor | VertexAttributeMaskTexcoord;
 
 constexpr uint32_t DrawCallMaxVertexBuffer                      = 4u;
 constexpr uint32_t DrawCallMaxTextures                          = 4u;
@@ -256,6 +511,11 @@ constexpr uint32_t DebugLineCapacity                            = 128u;
 
 constexpr uint32_t DefaultBlockCapacityInBytes                  = 1024u * 10u;
 constexpr uint32_t DefaultUniformDataStackAllocatorSizeInBytes  = 1024u * 1024u;
+//FK: Room for one texture sample per pixel of a full pixel batch, dispatches that sample more textures
+//    chain additional stacks (see stack_allocator_t).
+constexpr uint32_t ShadingContextStackAllocatorSizeInBytes      = PixelShaderInputCount * sizeof(vector4f_t);
+
+constexpr uint32_t CacheLineSizeInBytes                         = 64u;
 
 constexpr float pi = 3.141f;
 
@@ -334,8 +594,24 @@ enum vertex_id_t : uint32_t
 
 struct vertex_buffer_t
 {
-    const vertex_t* pData;
+    vertex_streams_t streams;
+    uint8_t* pMemory;   //FK: nullptr if the streams are owned by the user
     uint32_t vertexCount;
+    uint32_t attributeMask;
+};
+
+struct index_buffer_t
+{
+    const void* pData;
+    uint32_t indexCount;
+    index_format_t format;
+};
+
+struct instance_buffer_t
+{
+    const uint8_t* pData;
+    uint32_t instanceCount;
+    uint32_t strideInBytes;
 };
 
 struct uniform_buffer_t
@@ -361,22 +637,63 @@ struct vertex_shader_t
 
 struct pixel_shader_t
 {
-    pixel_shader_fnc_t  function;
+    pixel_shader_fnc_t          function;
+    interpolation_mode_t        interpolationMode;
+    pixel_shader_input_layout_t inputLayout;
+    bool                        quadShadingEnabled;
+    uint32_t                    attributeMask;      //FK: Attributes that the pixel shader reads
+};
+
+//FK: Normalized device coordinates of the bounds of a draw call.
+//    maxDepth is the nearest depth (1 - z) of the bounds.
+struct occlusion_bounds_t
+{
+    vector2f_t  min;
+    vector2f_t  max;
+    float       maxDepth;
+};
+
+enum class frustum_coverage_t : uint8_t
+{
+    outside = 0,
+    partial,    //FK: Also used for draw calls without bounds
+    inside
 };
 
 struct draw_call_t
 {
     vertex_buffer_t*    pVertexBuffer;
+    index_buffer_t*     pIndexBuffer;   //FK: nullptr for non-indexed draw calls
+    instance_buffer_t*  pInstanceBuffer;
     void*               pUniformBufferData;
     vertex_shader_fnc_t vertexShader;
     pixel_shader_fnc_t  pixelShader;
+    interpolation_mode_t interpolationMode;
+    pixel_shader_input_layout_t pixelShaderInputLayout;
+    bool                quadShadingEnabled;
     uint32_t            vertexCount;
-    uint32_t            vertexOffset;
+    uint32_t            vertexOffset;   //FK: first vertex for non-indexed, base vertex for indexed draw calls
+    uint32_t            indexCount;
+    uint32_t            indexOffset;
+    uint32_t            instanceCount;  //FK: 1 for non-instanced draw calls
+    uint32_t            attributeMask;  //FK: Attributes of the vertex buffer that the pixel shader reads (+ position)
+
+    occlusion_bounds_t          occlusionBounds;
+    occlusion_query_result_t*   pOcclusionQueryResult;
+    bool                        hasOcclusionBounds;
+    frustum_coverage_t          frustumCoverage;    //FK: Triangles of draw calls that are fully inside of the frustum don't need to be clipped
 };
 
-struct clipped_vertex_t : vertex_t
+struct raster_draw_call_t
 {
-    uint32_t triangleIndex;
+    pixel_shader_fnc_t  pixelShader;
+    interpolation_mode_t interpolationMode;
+    pixel_shader_input_layout_t pixelShaderInputLayout;
+    bool                quadShadingEnabled;
+    void*               pUniformData;
+    uint32_t            attributeMask;
+    uint32_t            screenspaceTriangleOffset;
+    uint32_t            screenspaceTriangleCount;
 };
 
 struct triangle_t
@@ -384,9 +701,24 @@ struct triangle_t
     vertex_t vertices[3];
 };
 
+//FK: vertex_t padded to 16 floats so that a vertex can be interpolated with two 8-wide lerps
+struct alignas(32) clip_vertex_t
+{
+    vertex_t    vertex;
+    float       padding[16u - sizeof(vertex_t) / sizeof(float)];
+};
+
+struct clip_polygon_t
+{
+    clip_vertex_t   vertices[ClipPolygonMaxVertexCount];
+    uint32_t        vertexCount;
+};
+
 struct screenspace_triangle_t
 {
                 vector3f_t      screenspaceVertexPositions[3];
+                vector2i_t      fixedPointVertexPositions[3];
+                float           oneOverW[3];    //FK: For perspective correct interpolation
     alignas(16) vertex_t        vertices[3];
                 bounding_box_t  boundingBox;
 };
@@ -431,6 +763,8 @@ struct software_rasterizer_settings_t
     uint8_t backFaceCullingEnabled  : 1;
     uint8_t drawWireframe           : 1;
     uint8_t drawDepthBuffer         : 1;
+    uint8_t asyncFrameSubmission    : 1;    //FK: k15_draw_frame returns without waiting for the frame's tiles to be shaded
+    uint8_t depthPrepassEnabled     : 1;    //FK: Rasterize the depth of all triangles of a tile first so that every visible pixel gets shaded only once
 };
 
 struct bitmap_font_t
@@ -446,6 +780,8 @@ struct draw_call_triangles_t
     vertex_shader_fnc_t     vertexShader;
     pixel_shader_fnc_t      pixelShader;
     void*                   pUniformData;
+    uint32_t                attributeMask;
+    pixel_shader_input_layout_t pixelShaderInputLayout;
     screenspace_triangle_t* pScreenspaceTriangles;
     triangle_t*             pTriangles;
     uint32_t                triangleCount;
@@ -468,9 +804,12 @@ struct block_allocator_t
     uint32_t sizeInBytes;
 };
 
+//FK: Allocations that don't fit anymore go to the next stack of the chain, which gets created on demand
+//    and is kept across resets. That way the memory grows with what gets actually allocated between resets.
 struct stack_allocator_t
 {
     uint8_t* pBasePointer;
+    stack_allocator_t* pNextStack;
     uint32_t capacityInBytes;
     uint32_t sizeInBytes;
 };
@@ -481,11 +820,185 @@ struct barycentric_coordinates_buffer_t
     float* pV;
 };
 
+struct job_t
+{
+    job_fnc_t       function;
+    void*           pJobData;
+    job_counter_t*  pJobCounter;
+};
+
+//FK: Every worker owns one of these. The owner pushes and pops at the back,
+//    other workers steal from the front.
+struct alignas(64) job_queue_t
+{
+    std::mutex              mutex;
+    dynamic_buffer_t<job_t> jobs;
+    uint32_t                firstJobIndex;
+};
+
+struct job_system_t
+{
+    std::mutex              signalMutex;
+    std::condition_variable jobSignal;
+    std::atomic<uint32_t>   queuedJobCount;
+    bool                    shutdownRequested;  //FK: Guarded by signalMutex, worker threads exit once this is set
+    std::thread::id         ownerThreadId;
+    uint32_t                workerThreadCount;
+    uint32_t                jobQueueCount;
+    job_queue_t*            pJobQueues;
+    std::thread*            pWorkerThreads;
+};
+
+//FK: Post transform vertex cache of an indexed geometry job.
+//    Every unique vertex index of a job gets a slot so that the vertex shader runs only once per unique vertex.
+struct post_transform_cache_t
+{
+    uint32_t*   pHashTableVertexIndices;    //FK: PostTransformCacheHashTableSize entries, InvalidVertexIndex = empty
+    uint32_t*   pHashTableSlots;            //FK: PostTransformCacheHashTableSize entries
+    uint32_t*   pIndexSlots;                //FK: GeometryJobIndexCount entries, cache slot of every index of the job
+    uint32_t*   pUniqueVertexIndices;       //FK: GeometryJobIndexCount entries, vertex index of every cache slot
+    uint8_t*    pMemory;
+};
+
+//FK: Consecutive pixels of a pixel batch that belong to the same triangle.
+struct pixel_batch_run_t
+{
+    const screenspace_triangle_t*   pTriangle;
+    uint32_t                        pixelCount;
+};
+
+//FK: Pixels of multiple triangles of the same draw call that get shaded by a single pixel shader invocation.
+struct pixel_batch_t
+{
+    const raster_draw_call_t*   pDrawCall;
+    pixel_batch_run_t*          pRuns;          //FK: Up to PixelShaderInputCount runs, pixels of a run are stored consecutively
+    uint32_t                    runCount;
+    uint32_t                    pixelCount;
+};
+
+//FK: Scratch memory that a single thread uses to shade pixels.
+//    Every worker owns one so that tiles can be shaded in parallel without sharing any state.
+struct alignas(64) shading_context_t
+{
+    vertex_shader_input_t               vertexShaderInput;  //FK: GeometryJobIndexCount vertices, the transformed vertices of the current geometry job
+    post_transform_cache_t              postTransformCache;
+    pixel_shader_input_t                pixelShaderInput;
+    pixel_shader_output_t               pixelShaderOutput;
+    barycentric_coordinates_buffer_t    barycentricCoordinates;
+    pixel_batch_t                       pixelBatch;
+    stack_allocator_t                   stackAllocator;
+    uint32_t*                           pHelperPixelMask;   //FK: Gets passed to pixel shaders with quad shading
+    uint8_t*                            pMemory;
+    uint8_t*                            pVertexShaderInputMemory;
+};
+
+//FK: Runs a range of a draw call's triangles through the geometry stages (vertex, cull, clip, project).
+//    Every job owns its intermediate buffers, they are kept alive between frames.
+struct geometry_job_t
+{
+    software_rasterizer_context_t*              pContext;
+    const draw_call_t*                          pDrawCall;
+    uint32_t                                    drawCallIndex;
+    uint32_t                                    firstTriangleIndex;
+    uint32_t                                    triangleCount;      //FK: per instance
+    uint32_t                                    firstInstanceIndex;
+    uint32_t                                    instanceCount;
+    bool                                        succeeded;
+
+    dynamic_buffer_t<triangle_t>                visibleTriangles;
+    dynamic_buffer_t<triangle_t>                clippedTriangles;
+    dynamic_buffer_t<screenspace_triangle_t>    screenspaceTriangles;
+};
+
+enum class raster_pass_t : uint8_t
+{
+    depth_and_color = 0,    //FK: Depth test (greater), depth write and shading
+    depth_only,             //FK: Depth test (greater) and depth write, no shading
+    color_equal_depth       //FK: Shading of pixels whose depth is equal to the depth buffer, no depth write
+};
+
+enum class raster_block_coverage_t : uint8_t
+{
+    outside = 0,
+    partial,
+    inside
+};
+
+//FK: Edge function in pixel units, value at pixel (x,y) = stepX * x + stepY * y + offset.
+//    Pixels with a value >= 0 are inside of the edge (fill rule is already part of offset).
+struct raster_edge_t
+{
+    int32_t stepX;
+    int32_t stepY;
+    int64_t offset;
+};
+
+//FK: Edge function values of the first row of a raster block (8 pixels). Values of edges that don't fit into 32 bit are
+//    stored relative to their value at the block origin (bias), these edges can't cross the block so they are left out of
+//    the inside test (insideTestMasks = 0).
+struct raster_block_edges_t
+{
+    __m256i rowValues[3];
+    __m256i insideTestMasks[3];
+    __m256  barycentricBiases[2];   //FK: bias * edgeToBarycentricScale of the edges that get turned into barycentric coordinates
+};
+
+struct tile_triangle_t
+{
+    uint32_t screenspaceTriangleIndex;
+    uint32_t drawCallIndex;
+};
+
+struct frame_t;
+
+struct screen_tile_t
+{
+    frame_t*                            pFrame;
+    bounding_box_t                      boundingBox;
+    dynamic_buffer_t<tile_triangle_t>   triangles;
+    bool                                binningFailed;
+};
+
+//FK: Depth range of a RasterBlockSize x RasterBlockSize block of the depth buffer.
+//    Depth values are stored as 1 - z, so minDepth is the farthest and maxDepth the nearest depth of the block.
+struct hi_z_entry_t
+{
+    float minDepth;
+    float maxDepth;
+};
+
+//FK: Everything a submitted frame needs until its tiles are shaded.
+//    Frames live in a ring so that the geometry of the next frame can be processed while the
+//    tiles of the previous frame are still being shaded.
+struct frame_t
+{
+    software_rasterizer_context_t*              pContext;
+    void*                                       pColorBuffer;
+    void*                                       pDepthBuffer;
+    software_rasterizer_settings_t              settings;
+    uint64_t                                    frameNumber;
+    job_counter_t                               jobCounter;
+
+    stack_allocator_t*                          pDrawCallDataAllocator;
+    uint32_t                                    screenTileCountX;
+    uint32_t                                    screenTileCountY;
+
+    hi_z_entry_t*                               pHiZBuffer;
+    uint32_t                                    hiZBufferStride;
+    uint32_t                                    hiZBufferHeight;
+    uint32_t                                    hiZBufferCapacity;
+    uint64_t                                    hiZFrameNumber;     //FK: Frame whose depth is in pHiZBuffer once the frame is complete, 0 if the content is invalid
+
+    dynamic_buffer_t<draw_call_t>               drawCalls;
+    dynamic_buffer_t<raster_draw_call_t>        rasterDrawCalls;
+    dynamic_buffer_t<screenspace_triangle_t>    screenspaceTriangles;
+    dynamic_buffer_t<screen_tile_t>             screenTiles;
+};
+
 struct software_rasterizer_context_t
 {
     software_rasterizer_settings_t              settings;
     bitmap_font_t                               font;
-    barycentric_coordinates_buffer_t            barycentricCoordinatesBuffer;
 
     uint8_t                                     colorBufferCount;
     uint8_t                                     currentColorBufferIndex;
@@ -505,30 +1018,43 @@ struct software_rasterizer_context_t
 
     uniform_buffer_t*                           pBoundUniformBuffer;
     vertex_buffer_t*                            pBoundVertexBuffer;
+    index_buffer_t*                             pBoundIndexBuffer;
+    instance_buffer_t*                          pBoundInstanceBuffer;
     texture_t*                                  boundTextures[DrawCallMaxTextures];
 
     vertex_shader_t*                            pBoundVertexShader;
     pixel_shader_t*                             pBoundPixelShader;
 
+    //FK: Set by k15_set_draw_bounds, only used by the next draw call
+    occlusion_bounds_t                          nextDrawCallOcclusionBounds;
+    occlusion_query_result_t*                   pNextDrawCallOcclusionQueryResult;
+    bool                                        nextDrawCallHasOcclusionBounds;
+    frustum_coverage_t                          nextDrawCallFrustumCoverage;
+
     block_allocator_t*                          pUniformDataAllocator;
     stack_allocator_t*                          pDrawCallDataAllocator;
 
-    pixel_shader_input_t                        bufferedPixelShaderInput;
-    pixel_shader_output_t                       bufferedPixelShaderOutput;
+    job_system_t*                               pJobSystem;
+
+    //FK: One shading context per worker thread + one for the thread calling k15_draw_frame (index 0)
+    shading_context_t*                          pShadingContexts;
+    uint32_t                                    shadingContextCount;
+
+    //FK: Ring of frames that are in flight, indexed by frameNumber % MaxFramesInFlight
+    frame_t*                                    pFrames;
+    uint64_t                                    frameNumber;
 
     dynamic_buffer_t<draw_call_t>               drawCalls;
+    dynamic_buffer_t<geometry_job_t>            geometryJobs;
 
     dynamic_buffer_t<uniform_buffer_t>          uniformBuffers;
     dynamic_buffer_t<vertex_buffer_t>           vertexBuffers;
+    dynamic_buffer_t<index_buffer_t>            indexBuffers;
+    dynamic_buffer_t<instance_buffer_t>         instanceBuffers;
     dynamic_buffer_t<texture_t>                 textures;  
 
     dynamic_buffer_t<vertex_shader_t>           vertexShaders;
     dynamic_buffer_t<pixel_shader_t>            pixelShaders;
-
-    dynamic_buffer_t<triangle_t>                triangles;
-    dynamic_buffer_t<triangle_t>                visibleTriangles;
-    dynamic_buffer_t<triangle_t>                clippedTriangles;
-    dynamic_buffer_t<screenspace_triangle_t>    screenspaceTriangles;
 };
 
 template<typename T>
@@ -736,25 +1262,24 @@ internal bool _k15_create_block_allocator(block_allocator_t** ppBlockAllocator)
     return true;
 }
 
-internal void* _k15_allocate_from_stack_allocator(stack_allocator_t* pStackAllocator, uint32_t sizeInBytes)
+internal uint32_t _k15_align_to_cache_line(uint32_t sizeInBytes)
 {
-    RuntimeAssert(pStackAllocator->sizeInBytes + sizeInBytes <= pStackAllocator->capacityInBytes);
-    void* pData = pStackAllocator->pBasePointer + pStackAllocator->sizeInBytes;
-    pStackAllocator->sizeInBytes += sizeInBytes;
-
-    return pData;
+    return ( sizeInBytes + CacheLineSizeInBytes - 1u ) & ~( CacheLineSizeInBytes - 1u );
 }
 
+//FK: The memory of a stack starts on the cache line after its header
 internal bool _k15_create_stack_allocator(stack_allocator_t** ppStackAllocator, uint32_t capacityInBytes)
 {
-    uint8_t* restrict_modifier pStackAllocatorMemory = (uint8_t*)malloc(capacityInBytes + sizeof(stack_allocator_t));
+    const uint32_t headerSizeInBytes = _k15_align_to_cache_line(sizeof(stack_allocator_t));
+    uint8_t* restrict_modifier pStackAllocatorMemory = (uint8_t*)_mm_malloc(headerSizeInBytes + capacityInBytes, CacheLineSizeInBytes);
     if( pStackAllocatorMemory == nullptr )
     {
         return false;
     }
 
     stack_allocator_t* pAllocator = (stack_allocator_t*)pStackAllocatorMemory;
-    pAllocator->pBasePointer = pStackAllocatorMemory + sizeof(stack_allocator_t);
+    pAllocator->pBasePointer = pStackAllocatorMemory + headerSizeInBytes;
+    pAllocator->pNextStack = nullptr;
     pAllocator->sizeInBytes = 0;
     pAllocator->capacityInBytes = capacityInBytes;
 
@@ -763,81 +1288,498 @@ internal bool _k15_create_stack_allocator(stack_allocator_t** ppStackAllocator,
     return true;
 }
 
-internal bool _k15_create_barycentric_coordinate_buffer(barycentric_coordinates_buffer_t* pBarycentricCoordinateBuffer, uint32_t coordinateCount)
+//FK: Only frees the chained stacks, the memory of pStackAllocator itself belongs to whoever created it.
+internal void _k15_destroy_chained_stack_allocators(stack_allocator_t* pStackAllocator)
+{
+    stack_allocator_t* pNextStack = pStackAllocator->pNextStack;
+    while( pNextStack != nullptr )
+    {
+        stack_allocator_t* pStack = pNextStack;
+        pNextStack = pStack->pNextStack;
+        _mm_free(pStack);
+    }
+
+    pStackAllocator->pNextStack = nullptr;
+}
+
+internal void _k15_destroy_stack_allocator(stack_allocator_t* pStackAllocator)
+{
+    if( pStackAllocator != nullptr )
+    {
+        _k15_destroy_chained_stack_allocators(pStackAllocator);
+        _mm_free(pStackAllocator);
+    }
+}
+
+//FK: Allocations are rounded up to 16 bytes so that vector4f_t arrays stay aligned.
+internal void* _k15_allocate_from_stack_allocator(stack_allocator_t* pStackAllocator, uint32_t sizeInBytes)
+{
+    sizeInBytes = ( sizeInBytes + 15u ) & ~15u;
+
+    stack_allocator_t* pStack = pStackAllocator;
+    while( pStack->sizeInBytes + sizeInBytes > pStack->capacityInBytes )
+    {
+        if( pStack->pNextStack == nullptr && !_k15_create_stack_allocator(&pStack->pNextStack, get_max(pStackAllocator->capacityInBytes, sizeInBytes)) )
+        {
+            return nullptr;
+        }
+
+        pStack = pStack->pNextStack;
+    }
+
+    void* pData = pStack->pBasePointer + pStack->sizeInBytes;
+    pStack->sizeInBytes += sizeInBytes;
+
+    return pData;
+}
+
+internal bool _k15_create_shading_context(shading_context_t* pShadingContext, uint32_t pixelCount, uint32_t stackAllocatorSizeInBytes)
+{
+    //FK: All buffers of a shading context share one allocation so that they stay close together in memory.
+    //    Each buffer starts on its own cache line.
+    //FK: pVertexData and the attribute arrays share their memory, a pixel shader only uses one of them.
+    //    Attribute arrays get 8 pixels of padding since each run of a pixel batch gets interpolated 8 pixels at a time.
+    constexpr uint32_t attributeComponentCount = sizeof(vertex_t) / sizeof(float);
+    const uint32_t attributeArraySizeInBytes = _k15_align_to_cache_line(( pixelCount + 8u ) * sizeof(float));
+    const uint32_t vertexDataSizeInBytes    = get_max(_k15_align_to_cache_line(pixelCount * sizeof(vertex_t)), attributeArraySizeInBytes * attributeComponentCount);
+    const uint32_t colorSizeInBytes         = _k15_align_to_cache_line(pixelCount * sizeof(vector4f_t));
+    const uint32_t floatSizeInBytes         = _k15_align_to_cache_line(pixelCount * sizeof(float));
+    const uint32_t uint32SizeInBytes        = _k15_align_to_cache_line(pixelCount * sizeof(uint32_t));
+    const uint32_t runSizeInBytes           = _k15_align_to_cache_line(pixelCount * sizeof(pixel_batch_run_t));
+    const uint32_t stackSizeInBytes         = _k15_align_to_cache_line(stackAllocatorSizeInBytes);
+    const uint32_t helperPixelMaskSizeInBytes = attributeArraySizeInBytes;
+    const uint32_t memorySizeInBytes        = vertexDataSizeInBytes + colorSizeInBytes + floatSizeInBytes * 3u + uint32SizeInBytes * 2u + helperPixelMaskSizeInBytes + runSizeInBytes + stackSizeInBytes;
+
+    uint8_t* pMemory = (uint8_t*)_mm_malloc(memorySizeInBytes, CacheLineSizeInBytes);
+    if( pMemory == nullptr )
+    {
+        return false;
+    }
+
+    uint8_t* pCurrentMemory = pMemory;
+    pShadingContext->pMemory                                = pMemory;
+    pShadingContext->pixelShaderInput.pVertexData           = (vertex_t*)pCurrentMemory;
+    float** ppAttributeArrays = (float**)&pShadingContext->pixelShaderInput.attributes;
+    for(uint32_t componentIndex = 0u; componentIndex < attributeComponentCount; ++componentIndex)
+    {
+        ppAttributeArrays[componentIndex] = (float*)( pCurrentMemory + componentIndex * attributeArraySizeInBytes );
+    }
+    pCurrentMemory += vertexDataSizeInBytes;
+    pShadingContext->pixelShaderOutput.pColor               = (vector4f_t*)pCurrentMemory;  pCurrentMemory += colorSizeInBytes;
+    pShadingContext->pixelShaderInput.pDepth                = (float*)pCurrentMemory;       pCurrentMemory += floatSizeInBytes;
+    pShadingContext->barycentricCoordinates.pU              = (float*)pCurrentMemory;       pCurrentMemory += floatSizeInBytes;
+    pShadingContext->barycentricCoordinates.pV              = (float*)pCurrentMemory;       pCurrentMemory += floatSizeInBytes;
+    pShadingContext->pixelShaderInput.pScreenspaceX         = (uint32_t*)pCurrentMemory;    pCurrentMemory += uint32SizeInBytes;
+    pShadingContext->pixelShaderInput.pScreenspaceY         = (uint32_t*)pCurrentMemory;    pCurrentMemory += uint32SizeInBytes;
+    pShadingContext->pHelperPixelMask                       = (uint32_t*)pCurrentMemory;    pCurrentMemory += helperPixelMaskSizeInBytes;
+    pShadingContext->pixelBatch.pRuns                       = (pixel_batch_run_t*)pCurrentMemory; pCurrentMemory += runSizeInBytes;
+    pShadingContext->stackAllocator.pBasePointer            = pCurrentMemory;               pCurrentMemory += stackSizeInBytes;
+    pShadingContext->stackAllocator.pNextStack              = nullptr;
+    pShadingContext->stackAllocator.capacityInBytes         = stackAllocatorSizeInBytes;
+    pShadingContext->stackAllocator.sizeInBytes             = 0u;
+    RuntimeAssert(pCurrentMemory == pMemory + memorySizeInBytes);
+
+    pShadingContext->pixelShaderInput.pStackAllocator       = &pShadingContext->stackAllocator;
+    pShadingContext->pixelShaderInput.pUniformData          = nullptr;
+    pShadingContext->pixelShaderInput.pixelCount            = 0u;
+    pShadingContext->pixelShaderInput.layout                = pixel_shader_input_layout_t::vertex_data;
+    pShadingContext->pixelShaderInput.pHelperPixelMask      = nullptr;
+    pShadingContext->pixelShaderOutput.pScreenspaceX        = pShadingContext->pixelShaderInput.pScreenspaceX;
+    pShadingContext->pixelShaderOutput.pScreenspaceY        = pShadingContext->pixelShaderInput.pScreenspaceY;
+    pShadingContext->pixelBatch.pDrawCall                   = nullptr;
+    pShadingContext->pixelBatch.runCount                    = 0u;
+    pShadingContext->pixelBatch.pixelCount                  = 0u;
+
+    return true;
+}
+
+internal bool _k15_create_post_transform_cache(post_transform_cache_t* pPostTransformCache)
+{
+    const uint32_t hashTableSizeInBytes         = _k15_align_to_cache_line(PostTransformCacheHashTableSize * sizeof(uint32_t));
+    const uint32_t indexSizeInBytes             = _k15_align_to_cache_line(GeometryJobIndexCount * sizeof(uint32_t));
+    const uint32_t memorySizeInBytes            = hashTableSizeInBytes * 2u + indexSizeInBytes * 2u;
+
+    uint8_t* pMemory = (uint8_t*)_mm_malloc(memorySizeInBytes, CacheLineSizeInBytes);
+    if( pMemory == nullptr )
+    {
+        return false;
+    }
+
+    uint8_t* pCurrentMemory = pMemory;
+    pPostTransformCache->pMemory                    = pMemory;
+    pPostTransformCache->pHashTableVertexIndices    = (uint32_t*)pCurrentMemory;    pCurrentMemory += hashTableSizeInBytes;
+    pPostTransformCache->pHashTableSlots            = (uint32_t*)pCurrentMemory;    pCurrentMemory += hashTableSizeInBytes;
+    pPostTransformCache->pIndexSlots                = (uint32_t*)pCurrentMemory;    pCurrentMemory += indexSizeInBytes;
+    pPostTransformCache->pUniqueVertexIndices       = (uint32_t*)pCurrentMemory;    pCurrentMemory += indexSizeInBytes;
+    RuntimeAssert(pCurrentMemory == pMemory + memorySizeInBytes);
+
+    return true;
+}
+
+internal bool _k15_create_vertex_shader_input(vertex_shader_input_t* pVertexShaderInput, uint8_t** ppOutMemory, uint32_t vertexCount)
 {
-    float* pUBuffer = (float*)_mm_malloc(coordinateCount * sizeof(float), 16);
-    float* pVBuffer = (float*)_mm_malloc(coordinateCount * sizeof(float), 16);
-    if( pUBuffer == nullptr || pVBuffer == nullptr)
+    const uint32_t vector4SizeInBytes   = _k15_align_to_cache_line(vertexCount * sizeof(vector4f_t));
+    const uint32_t vector2SizeInBytes   = _k15_align_to_cache_line(vertexCount * sizeof(vector2f_t));
+    const uint32_t memorySizeInBytes    = vector4SizeInBytes * 3u + vector2SizeInBytes;
+
+    uint8_t* pMemory = (uint8_t*)_mm_malloc(memorySizeInBytes, CacheLineSizeInBytes);
+    if( pMemory == nullptr )
     {
         return false;
     }
 
-    pBarycentricCoordinateBuffer->pU = pUBuffer;
-    pBarycentricCoordinateBuffer->pV = pVBuffer;
+    uint8_t* pCurrentMemory = pMemory;
+    pVertexShaderInput->positions       = (vector4f_t*)pCurrentMemory;  pCurrentMemory += vector4SizeInBytes;
+    pVertexShaderInput->normals         = (vector4f_t*)pCurrentMemory;  pCurrentMemory += vector4SizeInBytes;
+    pVertexShaderInput->colors          = (vector4f_t*)pCurrentMemory;  pCurrentMemory += vector4SizeInBytes;
+    pVertexShaderInput->texcoords       = (vector2f_t*)pCurrentMemory;  pCurrentMemory += vector2SizeInBytes;
+    pVertexShaderInput->pInstanceData   = nullptr;
+    pVertexShaderInput->instanceId      = 0u;
+    RuntimeAssert(pCurrentMemory == pMemory + memorySizeInBytes);
+
+    *ppOutMemory = pMemory;
     return true;
 }
 
 internal void _k15_reset_stack_allocator(stack_allocator_t* pStackAllocator)
 {
-    pStackAllocator->sizeInBytes = 0;
+    for( stack_allocator_t* pStack = pStackAllocator; pStack != nullptr; pStack = pStack->pNextStack )
+    {
+        pStack->sizeInBytes = 0;
+    }
 }
 
-//https://jsantell.com/3d-projection/
-void k15_create_projection_matrix(matrix4x4f_t* pOutMatrix, uint32_t width, uint32_t height, float near, float far, float fov)
+//FK: queuedJobCount gets changed under the queue lock together with the queue itself, so it never
+//    claims less jobs than there are queued (which would let workers go to sleep while work is pending).
+internal bool _k15_pop_job(job_system_t* pJobSystem, job_queue_t* pJobQueue, job_t* pOutJob)
 {
-    memset(pOutMatrix, 0, sizeof(matrix4x4f_t));
+    std::lock_guard<std::mutex> lock(pJobQueue->mutex);
+    if( pJobQueue->firstJobIndex == pJobQueue->jobs.count )
+    {
+        return false;
+    }
 
-    const float widthF = (float)width;
-    const float heightF = (float)height;
-    const float fovRad = fov/180.f * pi;
-    const float aspect = widthF / heightF;
-    const float e = 1.0f/tanf(fovRad/2.0f);
+    pJobSystem->queuedJobCount.fetch_sub(1u, std::memory_order_relaxed);
+    *pOutJob = pJobQueue->jobs.pData[--pJobQueue->jobs.count];
+    if( pJobQueue->firstJobIndex == pJobQueue->jobs.count )
+    {
+        pJobQueue->firstJobIndex = 0u;
+        pJobQueue->jobs.count = 0u;
+    }
 
-    pOutMatrix->m00 = e/aspect;
-    pOutMatrix->m11 = e;
-    pOutMatrix->m22 = -((far + near)/(far - near));
-    pOutMatrix->m23 = -((2.0f * far * near)/(far - near));
-    pOutMatrix->m32 = -1.0f;
+    return true;
 }
 
-void k15_create_orthographic_matrix(matrix4x4f_t* pOutMatrix, uint32_t width, uint32_t height, float near, float far)
+internal bool _k15_steal_job(job_system_t* pJobSystem, job_queue_t* pJobQueue, job_t* pOutJob)
 {
-    memset(pOutMatrix, 0, sizeof(matrix4x4f_t));
+    std::lock_guard<std::mutex> lock(pJobQueue->mutex);
+    if( pJobQueue->firstJobIndex == pJobQueue->jobs.count )
+    {
+        return false;
+    }
 
-    pOutMatrix->m00 = 1.0f / (float)width;
-    pOutMatrix->m11 = 1.0f / (float)height;
-    pOutMatrix->m22 = -2.0f / (far-near);
-    pOutMatrix->m23 = -((far+near)/(far-near));
-    pOutMatrix->m33 = 1.0f;
+    pJobSystem->queuedJobCount.fetch_sub(1u, std::memory_order_relaxed);
+    *pOutJob = pJobQueue->jobs.pData[pJobQueue->firstJobIndex++];
+    if( pJobQueue->firstJobIndex == pJobQueue->jobs.count )
+    {
+        pJobQueue->firstJobIndex = 0u;
+        pJobQueue->jobs.count = 0u;
+    }
+
+    return true;
 }
 
-void k15_set_identity_matrix4x4f(matrix4x4f_t* pMatrix)
+internal void _k15_execute_job(const job_t* pJob, uint32_t workerIndex)
 {
-    memcpy(pMatrix, IdentityMatrix4x4, sizeof(IdentityMatrix4x4));
+    pJob->function(pJob->pJobData, workerIndex);
+    pJob->pJobCounter->pendingJobCount.fetch_sub(1u, std::memory_order_release);
 }
 
-internal bool _k15_matrix4x4f_is_equal(const matrix4x4f_t* restrict_modifier pA, const matrix4x4f_t* restrict_modifier pB)
+internal bool _k15_try_execute_job(job_system_t* pJobSystem, uint32_t workerIndex)
 {
-    CompiletimeAssert(sizeof(matrix4x4f_t) == sizeof(float[16]));
-    return memcmp(pA, pB, sizeof(matrix4x4f_t)) == 0;
+    //FK: Work on our own queue first, only steal when it's empty
+    job_t job;
+    bool hasJob = _k15_pop_job(pJobSystem, pJobSystem->pJobQueues + workerIndex, &job);
+    for(uint32_t queueOffset = 1u; !hasJob && queueOffset < pJobSystem->jobQueueCount; ++queueOffset)
+    {
+        const uint32_t victimIndex = ( workerIndex + queueOffset ) % pJobSystem->jobQueueCount;
+        hasJob = _k15_steal_job(pJobSystem, pJobSystem->pJobQueues + victimIndex, &job);
+    }
+
+    if( !hasJob )
+    {
+        return false;
+    }
+
+    _k15_execute_job(&job, workerIndex);
+    return true;
 }
 
-void _k15_test_image_for_color_buffer(const software_rasterizer_context_t* pContext)
+internal void _k15_worker_thread(job_system_t* pJobSystem, uint32_t workerIndex)
 {
-    uint32_t* pBackBuffer = (uint32_t*)pContext->pColorBuffer[ pContext->currentColorBufferIndex ];
-    for(uint32_t y = 0; y < pContext->backBufferHeight; ++y)
+    while(true)
     {
-        if((y%4)==0)
+        if(_k15_try_execute_job(pJobSystem, workerIndex))
         {
-            for(uint32_t x = 0; x < pContext->backBufferWidth; ++x)
-            {
-                const uint32_t index = x + y * pContext->colorBufferStride;
-                pBackBuffer[index]=0xFF0000FF;
-            }
+            continue;
         }
-        else if((y%3)==0)
+
+        std::unique_lock<std::mutex> lock(pJobSystem->signalMutex);
+        pJobSystem->jobSignal.wait(lock, [pJobSystem]{ return pJobSystem->shutdownRequested || pJobSystem->queuedJobCount.load(std::memory_order_relaxed) > 0u; });
+        if( pJobSystem->shutdownRequested )
         {
-            for(uint32_t x = 0; x < pContext->backBufferWidth; ++x)
+            return;
+        }
+    }
+}
+
+internal void _k15_set_thread_affinity(std::thread* pThread, uint32_t logicalProcessorIndex)
+{
+#if defined(_WIN32)
+    SetThreadAffinityMask((HANDLE)pThread->native_handle(), (DWORD_PTR)1u << logicalProcessorIndex);
+#elif defined(__linux__)
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(logicalProcessorIndex, &cpuSet);
+    pthread_setaffinity_np(pThread->native_handle(), sizeof(cpu_set_t), &cpuSet);
+#else
+    UnusedVariable(pThread);
+    UnusedVariable(logicalProcessorIndex);
+#endif
+}
+
+internal void _k15_pin_worker_threads(job_system_t* pJobSystem, uint64_t affinityMask)
+{
+    if( affinityMask == 0u )
+    {
+        return;
+    }
+
+    //FK: Hand out the set bits of the mask round robin
+    uint32_t bitIndex = 0u;
+    for(uint32_t workerThreadIndex = 0u; workerThreadIndex < pJobSystem->workerThreadCount; ++workerThreadIndex)
+    {
+        while( ( affinityMask & ( 1ull << bitIndex ) ) == 0u )
+        {
+            bitIndex = ( bitIndex + 1u ) % 64u;
+        }
+
+        _k15_set_thread_affinity(pJobSystem->pWorkerThreads + workerThreadIndex, bitIndex);
+        bitIndex = ( bitIndex + 1u ) % 64u;
+    }
+}
+
+//FK: Stops and joins the worker threads. Jobs that are still queued don't get executed, wait for them first.
+//    Also used to clean up a partially created job system.
+internal void _k15_destroy_job_system(job_system_t* pJobSystem)
+{
+    if( pJobSystem->pWorkerThreads != nullptr )
+    {
+        {
+            std::lock_guard<std::mutex> lock(pJobSystem->signalMutex);
+            pJobSystem->shutdownRequested = true;
+        }
+
+        pJobSystem->jobSignal.notify_all();
+        for(uint32_t workerThreadIndex = 0u; workerThreadIndex < pJobSystem->workerThreadCount; ++workerThreadIndex)
+        {
+            if( pJobSystem->pWorkerThreads[workerThreadIndex].joinable() )
+            {
+                pJobSystem->pWorkerThreads[workerThreadIndex].join();
+            }
+        }
+
+        delete[] pJobSystem->pWorkerThreads;
+    }
+
+    for(uint32_t queueIndex = 0u; queueIndex < pJobSystem->jobQueueCount; ++queueIndex)
+    {
+        _k15_destroy_dynamic_buffer(&pJobSystem->pJobQueues[queueIndex].jobs);
+    }
+
+    delete[] pJobSystem->pJobQueues;
+    delete pJobSystem;
+}
+
+internal bool _k15_create_job_system(job_system_t** ppJobSystem, uint32_t workerThreadCount, uint64_t affinityMask)
+{
+    job_system_t* pJobSystem = new job_system_t;
+    pJobSystem->queuedJobCount      = 0u;
+    pJobSystem->shutdownRequested   = false;
+    pJobSystem->ownerThreadId       = std::this_thread::get_id();
+    pJobSystem->workerThreadCount   = workerThreadCount;
+    pJobSystem->pWorkerThreads      = nullptr;
+
+    //FK: One queue per worker thread + one for the owner thread (index 0).
+    //    Queues get zero initialized so that _k15_destroy_job_system can free the job buffers of a partially created job system.
+    pJobSystem->jobQueueCount       = workerThreadCount + 1u;
+    pJobSystem->pJobQueues          = new job_queue_t[pJobSystem->jobQueueCount]();
+
+    for(uint32_t queueIndex = 0u; queueIndex < pJobSystem->jobQueueCount; ++queueIndex)
+    {
+        pJobSystem->pJobQueues[queueIndex].firstJobIndex = 0u;
+        if(!_k15_create_dynamic_buffer(&pJobSystem->pJobQueues[queueIndex].jobs, DefaultJobCapacity))
+        {
+            _k15_destroy_job_system(pJobSystem);
+            return false;
+        }
+    }
+
+    if( workerThreadCount > 0u )
+    {
+        pJobSystem->pWorkerThreads = new std::thread[workerThreadCount];
+        for(uint32_t workerThreadIndex = 0u; workerThreadIndex < workerThreadCount; ++workerThreadIndex)
+        {
+            pJobSystem->pWorkerThreads[workerThreadIndex] = std::thread(_k15_worker_thread, pJobSystem, workerThreadIndex + 1u);
+        }
+
+        _k15_pin_worker_threads(pJobSystem, affinityMask);
+    }
+
+    *ppJobSystem = pJobSystem;
+    return true;
+}
+
+internal uint32_t _k15_get_current_worker_index(const job_system_t* pJobSystem)
+{
+    if( std::this_thread::get_id() == pJobSystem->ownerThreadId )
+    {
+        return 0u;
+    }
+
+    for(uint32_t workerThreadIndex = 0u; workerThreadIndex < pJobSystem->workerThreadCount; ++workerThreadIndex)
+    {
+        if( std::this_thread::get_id() == pJobSystem->pWorkerThreads[workerThreadIndex].get_id() )
+        {
+            return workerThreadIndex + 1u;
+        }
+    }
+
+    return InvalidWorkerIndex;
+}
+
+internal bool _k15_submit_jobs(job_system_t* pJobSystem, job_fnc_t function, void* pJobData, uint32_t jobDataStrideInBytes, uint32_t jobCount, job_counter_t* pJobCounter, uint32_t submittingWorkerIndex)
+{
+    if( jobCount == 0u )
+    {
+        return true;
+    }
+
+    //FK: Spread the jobs as contiguous ranges over all queues, starting with the queue of the submitting thread.
+    //    Neighbouring jobs tend to touch neighbouring memory, so this keeps each worker on its own part of the data.
+    const uint32_t firstQueueIndex = submittingWorkerIndex == InvalidWorkerIndex ? 0u : submittingWorkerIndex;
+    const uint32_t queueCount = get_min(jobCount, pJobSystem->jobQueueCount);
+
+    pJobCounter->pendingJobCount.fetch_add(jobCount, std::memory_order_relaxed);
+
+    uint32_t jobIndex = 0u;
+    for(uint32_t queueOffset = 0u; queueOffset < queueCount; ++queueOffset)
+    {
+        job_queue_t* pJobQueue = pJobSystem->pJobQueues + ( firstQueueIndex + queueOffset ) % pJobSystem->jobQueueCount;
+        const uint32_t lastJobIndex = ( jobCount * ( queueOffset + 1u ) ) / queueCount;
+        const uint32_t queueJobCount = lastJobIndex - jobIndex;
+
+        std::lock_guard<std::mutex> lock(pJobQueue->mutex);
+        job_t* pJobs = _k15_dynamic_buffer_push_back(&pJobQueue->jobs, queueJobCount);
+        if( pJobs == nullptr )
+        {
+            pJobCounter->pendingJobCount.fetch_sub(jobCount - jobIndex, std::memory_order_relaxed);
+            return false;
+        }
+
+        //FK: Jobs of this queue can't be popped before the lock gets released, see _k15_pop_job
+        pJobSystem->queuedJobCount.fetch_add(queueJobCount, std::memory_order_relaxed);
+
+        //FK: Jobs are popped from the back by the owner, push them in reverse so that they start with the first job of their range
+        for(uint32_t queueJobIndex = 0u; queueJobIndex < queueJobCount; ++queueJobIndex)
+        {
+            job_t* pJob = pJobs + queueJobCount - queueJobIndex - 1u;
+            pJob->function      = function;
+            pJob->pJobData      = (uint8_t*)pJobData + ( jobIndex + queueJobIndex ) * jobDataStrideInBytes;
+            pJob->pJobCounter   = pJobCounter;
+        }
+
+        jobIndex = lastJobIndex;
+    }
+
+    {
+        //FK: Taking the lock makes sure that no worker can miss the signal between checking queuedJobCount and going to sleep
+        std::lock_guard<std::mutex> lock(pJobSystem->signalMutex);
+    }
+
+    pJobSystem->jobSignal.notify_all();
+    return true;
+}
+
+internal void _k15_wait_for_jobs(job_system_t* pJobSystem, job_counter_t* pJobCounter, uint32_t workerIndex)
+{
+    //FK: Help out instead of idling while the jobs we're waiting for are still pending.
+    //    Threads that aren't known to the job system can't help since they don't own any per worker data.
+    while( pJobCounter->pendingJobCount.load(std::memory_order_acquire) > 0u )
+    {
+        if( workerIndex == InvalidWorkerIndex || !_k15_try_execute_job(pJobSystem, workerIndex) )
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+//https://jsantell.com/3d-projection/
+void k15_create_projection_matrix(matrix4x4f_t* pOutMatrix, uint32_t width, uint32_t height, float near, float far, float fov)
+{
+    memset(pOutMatrix, 0, sizeof(matrix4x4f_t));
+
+    const float widthF = (float)width;
+    const float heightF = (float)height;
+    const float fovRad = fov/180.f * pi;
+    const float aspect = widthF / heightF;
+    const float e = 1.0f/tanf(fovRad/2.0f);
+
+    pOutMatrix->m00 = e/aspect;
+    pOutMatrix->m11 = e;
+    pOutMatrix->m22 = -((far + near)/(far - near));
+    pOutMatrix->m23 = -((2.0f * far * near)/(far - near));
+    pOutMatrix->m32 = -1.0f;
+}
+
+void k15_create_orthographic_matrix(matrix4x4f_t* pOutMatrix, uint32_t width, uint32_t height, float near, float far)
+{
+    memset(pOutMatrix, 0, sizeof(matrix4x4f_t));
+
+    pOutMatrix->m00 = 1.0f / (float)width;
+    pOutMatrix->m11 = 1.0f / (float)height;
+    pOutMatrix->m22 = -2.0f / (far-near);
+    pOutMatrix->m23 = -((far+near)/(far-near));
+    pOutMatrix->m33 = 1.0f;
+}
+
+void k15_set_identity_matrix4x4f(matrix4x4f_t* pMatrix)
+{
+    memcpy(pMatrix, IdentityMatrix4x4, sizeof(IdentityMatrix4x4));
+}
+
+internal bool _k15_matrix4x4f_is_equal(const matrix4x4f_t* restrict_modifier pA, const matrix4x4f_t* restrict_modifier pB)
+{
+    CompiletimeAssert(sizeof(matrix4x4f_t) == sizeof(float[16]));
+    return memcmp(pA, pB, sizeof(matrix4x4f_t)) == 0;
+}
+
+void _k15_test_image_for_color_buffer(const software_rasterizer_context_t* pContext)
+{
+    uint32_t* pBackBuffer = (uint32_t*)pContext->pColorBuffer[ pContext->currentColorBufferIndex ];
+    for(uint32_t y = 0; y < pContext->backBufferHeight; ++y)
+    {
+        if((y%4)==0)
+        {
+            for(uint32_t x = 0; x < pContext->backBufferWidth; ++x)
+            {
+                const uint32_t index = x + y * pContext->colorBufferStride;
+                pBackBuffer[index]=0xFF0000FF;
+            }
+        }
+        else if((y%3)==0)
+        {
+            for(uint32_t x = 0; x < pContext->backBufferWidth; ++x)
             {
                 const uint32_t index = x + y * pContext->colorBufferStride;
                 pBackBuffer[index]=0xFFFF0000;
@@ -1112,14 +2054,15 @@ internal inline void _k15_repeat_texcoords(const vertex_t* pVertices, vector2f_t
 
     for( uint32_t texCoordIndex = texcoordCountSIMD; texCoordIndex < texcoordCount; ++texCoordIndex)
     {
-        if( pVertices[texCoordIndex].texcoord.x > 1.0f )
+        pTexcoords[texCoordIndex] = pVertices[texCoordIndex].texcoord;
+        if( pTexcoords[texCoordIndex].x > 1.0f )
         {
-            pTexcoords[texCoordIndex].x = (pVertices[texCoordIndex].texcoord.x - 1.0f);
+            pTexcoords[texCoordIndex].x -= 1.0f;
         }
 
-        if( pVertices[texCoordIndex].texcoord.y > 1.0f )
+        if( pTexcoords[texCoordIndex].y > 1.0f )
         {
-            pTexcoords[texCoordIndex].y = (pVertices[texCoordIndex].texcoord.y - 1.0f);
+            pTexcoords[texCoordIndex].y -= 1.0f;
         }
     }
 }
@@ -1195,6 +2138,47 @@ internal inline void _k15_mirror_texcoords(const vertex_t* pVertices, vector2f_t
     }
 }
 
+//FK: Same as _k15_repeat_texcoords, _k15_clamp_texcoords and _k15_mirror_texcoords for texcoords in attribute arrays.
+//    Writes texcoords up to the next multiple of 8, the attribute arrays are padded.
+template<sample_addressing_mode_t ADDRESSING_MODE>
+internal inline void _k15_address_texcoord_arrays(const float* pU, const float* pV, vector2f_t* pTexcoords, uint32_t texcoordCount)
+{
+    const __m256 zero   = _mm256_setzero_ps();
+    const __m256 one    = _mm256_set1_ps(1.0f);
+    for( uint32_t texcoordIndex = 0u; texcoordIndex < texcoordCount; texcoordIndex += 8u )
+    {
+        __m256 texcoords[2] = {
+            _mm256_load_ps(pU + texcoordIndex),
+            _mm256_load_ps(pV + texcoordIndex)
+        };
+
+        for( uint32_t componentIndex = 0u; componentIndex < 2u; ++componentIndex )
+        {
+            const __m256 texcoord = texcoords[componentIndex];
+            switch( ADDRESSING_MODE )
+            {
+                case sample_addressing_mode_t::repeat:
+                texcoords[componentIndex] = _mm256_sub_ps(texcoord, _mm256_and_ps(one, _mm256_cmp_ps(texcoord, one, _CMP_GT_OQ)));
+                break;
+
+                case sample_addressing_mode_t::clamp:
+                texcoords[componentIndex] = _mm256_min_ps(_mm256_max_ps(texcoord, zero), one);
+                break;
+
+                case sample_addressing_mode_t::mirror:
+                texcoords[componentIndex] = _mm256_sub_ps(one, _mm256_sub_ps(texcoord, _mm256_and_ps(one, _mm256_cmp_ps(texcoord, one, _CMP_GT_OQ))));
+                break;
+            }
+        }
+
+        //FK: Interleave u and v
+        const __m256 uv0 = _mm256_unpacklo_ps(texcoords[0], texcoords[1]);
+        const __m256 uv1 = _mm256_unpackhi_ps(texcoords[0], texcoords[1]);
+        _mm256_storeu_ps((float*)(pTexcoords + texcoordIndex + 0u), _mm256_permute2f128_ps(uv0, uv1, 0x20));
+        _mm256_storeu_ps((float*)(pTexcoords + texcoordIndex + 4u), _mm256_permute2f128_ps(uv0, uv1, 0x31));
+    }
+}
+
 template<int TEXTURE_COMPONENT_COUNT, sample_addressing_mode_t ADDRESSING_MODE>
 texture_samples_t _k15_sample_texture_components(const texture_t* restrict_modifier pTextureData, const pixel_shader_input_t* restrict_modifier pPixelShaderInput, uint32_t texcoordCount)
 {
@@ -1208,7 +2192,11 @@ texture_samples_t _k15_sample_texture_components(const texture_t* restrict_modif
     {
         uint32_t currentTexCoordBatchCount = get_min(texcoordCount - texcoordIndex, TexcoordBatchCount);
 
-        switch( ADDRESSING_MODE )
+        if( pPixelShaderInput->layout == pixel_shader_input_layout_t::attribute_arrays )
+        {
+            _k15_address_texcoord_arrays<ADDRESSING_MODE>(pPixelShaderInput->attributes.pTexcoordU + texcoordIndex, pPixelShaderInput->attributes.pTexcoordV + texcoordIndex, texCoords, currentTexCoordBatchCount);
+        }
+        else switch( ADDRESSING_MODE )
         {
             case sample_addressing_mode_t::repeat:
             _k15_repeat_texcoords(pPixelShaderInput->pVertexData + texcoordIndex, texCoords, currentTexCoordBatchCount);
@@ -1288,8 +2276,8 @@ texture_samples_t _k15_sample_texture_components(const texture_t* restrict_modif
         for( uint32_t singleTexcoordIndex = 0u; singleTexcoordIndex < currentTexcoordBatchRest; ++singleTexcoordIndex )
         {
             const uint32_t globalTexcoordIndex = currentTexCoordBatchCount + texcoordIndex + singleTexcoordIndex;
-            const uint32_t x = float_to_uint32(texCoords[singleTexcoordIndex].x * (float)width);
-            const uint32_t y = height - float_to_uint32(texCoords[singleTexcoordIndex].y * (float)height);
+            const uint32_t x = float_to_uint32(texCoords[currentTexCoordBatchCount + singleTexcoordIndex].x * (float)width);
+            const uint32_t y = height - float_to_uint32(texCoords[currentTexCoordBatchCount + singleTexcoordIndex].y * (float)height);
             const uint32_t texelIndex = x + y * stride;
 
             switch(TEXTURE_COMPONENT_COUNT)
@@ -1322,6 +2310,50 @@ texture_samples_t _k15_sample_texture_components(const texture_t* restrict_modif
     return samples;
 }
 
+//FK: Fine derivatives, the x derivative is the difference within the pixel's row of the quad
+//    and the y derivative the difference within the pixel's column of the quad.
+void k15_calculate_derivatives(const pixel_shader_input_t* pPixelShaderInput, const float* pValues, uint32_t valueStrideInFloats, float* pOutDdx, float* pOutDdy, uint32_t pixelCount)
+{
+    RuntimeAssert(pixelCount <= PixelShaderInputCount);
+    if( pPixelShaderInput->pHelperPixelMask == nullptr )
+    {
+        memset(pOutDdx, 0, pixelCount * sizeof(float));
+        memset(pOutDdy, 0, pixelCount * sizeof(float));
+        return;
+    }
+
+    RuntimeAssert(( pixelCount & 0x3u ) == 0u);
+
+    uint32_t pixelIndex = 0u;
+    if( valueStrideInFloats == 1u )
+    {
+        for( ; pixelIndex + 8u <= pixelCount; pixelIndex += 8u )
+        {
+            const __m256 values = _mm256_loadu_ps(pValues + pixelIndex);
+            _mm256_storeu_ps(pOutDdx + pixelIndex, _mm256_sub_ps(_mm256_permute_ps(values, _MM_SHUFFLE(3, 3, 1, 1)), _mm256_permute_ps(values, _MM_SHUFFLE(2, 2, 0, 0))));
+            _mm256_storeu_ps(pOutDdy + pixelIndex, _mm256_sub_ps(_mm256_permute_ps(values, _MM_SHUFFLE(3, 2, 3, 2)), _mm256_permute_ps(values, _MM_SHUFFLE(1, 0, 1, 0))));
+        }
+    }
+
+    for( ; pixelIndex < pixelCount; pixelIndex += 4u )
+    {
+        const float topLeft     = pValues[( pixelIndex + 0u ) * valueStrideInFloats];
+        const float topRight    = pValues[( pixelIndex + 1u ) * valueStrideInFloats];
+        const float bottomLeft  = pValues[( pixelIndex + 2u ) * valueStrideInFloats];
+        const float bottomRight = pValues[( pixelIndex + 3u ) * valueStrideInFloats];
+
+        pOutDdx[pixelIndex + 0u] = topRight - topLeft;
+        pOutDdx[pixelIndex + 1u] = topRight - topLeft;
+        pOutDdx[pixelIndex + 2u] = bottomRight - bottomLeft;
+        pOutDdx[pixelIndex + 3u] = bottomRight - bottomLeft;
+
+        pOutDdy[pixelIndex + 0u] = bottomLeft - topLeft;
+        pOutDdy[pixelIndex + 1u] = bottomRight - topRight;
+        pOutDdy[pixelIndex + 2u] = bottomLeft - topLeft;
+        pOutDdy[pixelIndex + 3u] = bottomRight - topRight;
+    }
+}
+
 template<sample_addressing_mode_t ADDRESSING_MODE>
 texture_samples_t k15_sample_texture(texture_handle_t texture, const pixel_shader_input_t* pPixelShaderInput, uint32_t texcoordCount)
 {
@@ -1365,7 +2397,7 @@ constexpr vertex_t k15_create_vertex(vector4f_t position, vector4f_t normal, vec
     return vertex;
 }
 
-internal void _k15_generate_barycentric_vertices(pixel_shader_input_t* pOutVertex, barycentric_coordinates_buffer_t barycentricCoordinates, uint32_t barycentricCoordinateCount, const vertex_t* pTriangleVertices)
+internal void _k15_generate_barycentric_vertices(pixel_shader_input_t* pOutVertex, barycentric_coordinates_buffer_t barycentricCoordinates, uint32_t barycentricCoordinateCount, const vertex_t* pTriangleVertices, uint32_t attributeMask)
 {
     float* restrict_modifier pOutputVertexAttributes = (float*)pOutVertex->pVertexData;
     const float* restrict_modifier pInputVertexAttributes[3] = {
@@ -1374,18 +2406,41 @@ internal void _k15_generate_barycentric_vertices(pixel_shader_input_t* pOutVerte
         (const float*)&pTriangleVertices[2]
     };
 
-    const uint32_t attributeCount = sizeof(vertex_t) / sizeof(float);
-    uint32_t globalAttributeIndex = 0u;
+    //FK: Only attributes that are part of the draw call's vertex layout and that the pixel shader reads get interpolated.
+    //    Position, normal and color are interpolated 4 floats at a time, texcoords are scalar.
+    constexpr uint32_t attributeCount           = sizeof(vertex_t) / sizeof(float);
+    constexpr uint32_t texcoordAttributeIndex   = offsetof(vertex_t, texcoord) / sizeof(float);
+
+    uint32_t simdAttributeIndices[3];
+    uint32_t simdAttributeIndexCount = 0u;
+    if( attributeMask & VertexAttributeMaskPosition )
+    {
+        simdAttributeIndices[simdAttributeIndexCount++] = offsetof(vertex_t, position) / sizeof(float);
+    }
+
+    if( attributeMask & VertexAttributeMaskNormal )
+    {
+        simdAttributeIndices[simdAttributeIndexCount++] = offsetof(vertex_t, normal) / sizeof(float);
+    }
+
+    if( attributeMask & VertexAttributeMaskColor )
+    {
+        simdAttributeIndices[simdAttributeIndexCount++] = offsetof(vertex_t, color) / sizeof(float);
+    }
+
+    const bool interpolateTexcoords = ( attributeMask & VertexAttributeMaskTexcoord ) != 0u;
+
     for( uint32_t baryIndex = 0u; baryIndex < barycentricCoordinateCount; ++baryIndex )
     {
+        float* restrict_modifier pOutputVertex = pOutputVertexAttributes + baryIndex * attributeCount;
+
         const __m128 uWide = _mm_broadcast_ss(barycentricCoordinates.pU + baryIndex);
         const __m128 vWide = _mm_broadcast_ss(barycentricCoordinates.pV + baryIndex);
         const __m128 wWide = _mm_sub_ps(_mm_set1_ps(1.0f), _mm_add_ps(uWide, vWide));
 
-        const uint32_t scalarAttributeCount = attributeCount & 0x3;
-        const uint32_t simdAttributeCount = attributeCount - scalarAttributeCount; 
-        for( uint32_t attributeIndex = 0u; attributeIndex < simdAttributeCount; attributeIndex += 4u )
+        for( uint32_t simdAttributeIndex = 0u; simdAttributeIndex < simdAttributeIndexCount; ++simdAttributeIndex )
         {
+            const uint32_t attributeIndex = simdAttributeIndices[simdAttributeIndex];
             const __m128 vertexAttributes[] = {
                 _mm_load_ps(pInputVertexAttributes[0] + attributeIndex),
                 _mm_load_ps(pInputVertexAttributes[1] + attributeIndex),
@@ -1396,11 +2451,19 @@ internal void _k15_generate_barycentric_vertices(pixel_shader_input_t* pOutVerte
             transformedVertexAttributes = _mm_fmadd_ps(vertexAttributes[1], wWide, transformedVertexAttributes);
             transformedVertexAttributes = _mm_fmadd_ps(vertexAttributes[0], vWide, transformedVertexAttributes);
             
-            _mm_store_ps(pOutputVertexAttributes + globalAttributeIndex, transformedVertexAttributes);
-            globalAttributeIndex += 4u;
+            _mm_store_ps(pOutputVertex + attributeIndex, transformedVertexAttributes);
+        }
+
+        if( !interpolateTexcoords )
+        {
+            continue;
         }
 
-        for( uint32_t attributeIndex = simdAttributeCount; attributeIndex < attributeCount; ++attributeIndex )
+        const float u = barycentricCoordinates.pU[baryIndex];
+        const float v = barycentricCoordinates.pV[baryIndex];
+        const float w = 1.0f - u - v;
+
+        for( uint32_t attributeIndex = texcoordAttributeIndex; attributeIndex < attributeCount; ++attributeIndex )
         {
             const float attributes[3] = {
                 pInputVertexAttributes[0][attributeIndex],
@@ -1408,13 +2471,85 @@ internal void _k15_generate_barycentric_vertices(pixel_shader_input_t* pOutVerte
                 pInputVertexAttributes[2][attributeIndex]
             };
 
-            const float u = barycentricCoordinates.pU[baryIndex];
-            const float v = barycentricCoordinates.pV[baryIndex];
-            const float w = 1.0f - u - v;
-
             const float transformedAttribute = attributes[0] * v + attributes[1] * w + attributes[2] * u;
-            pOutputVertexAttributes[globalAttributeIndex] = transformedAttribute;
-            ++globalAttributeIndex;
+            pOutputVertex[attributeIndex] = transformedAttribute;
+        }
+    }
+}
+
+//FK: Turns screenspace barycentric coordinates into perspective correct ones. Each vertex gets weighted by its 1/w,
+//    that costs one division per pixel. The weight of vertex 0 is v, of vertex 1 1-u-v and of vertex 2 u.
+internal void _k15_apply_perspective_correction(barycentric_coordinates_buffer_t barycentricCoordinates, uint32_t barycentricCoordinateCount, const float* pOneOverW)
+{
+    const __m256i laneIndices = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    const __m256 oneOverW0 = _mm256_set1_ps(pOneOverW[0]);
+    const __m256 oneOverW1 = _mm256_set1_ps(pOneOverW[1]);
+    const __m256 oneOverW2 = _mm256_set1_ps(pOneOverW[2]);
+
+    for( uint32_t baryIndex = 0u; baryIndex < barycentricCoordinateCount; baryIndex += 8u )
+    {
+        //FK: Masked loads and stores, the coordinates after this run belong to a different triangle
+        const __m256i laneMask = _mm256_cmpgt_epi32(_mm256_set1_epi32(barycentricCoordinateCount - baryIndex), laneIndices);
+
+        const __m256 u = _mm256_maskload_ps(barycentricCoordinates.pU + baryIndex, laneMask);
+        const __m256 v = _mm256_maskload_ps(barycentricCoordinates.pV + baryIndex, laneMask);
+        const __m256 w = _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_add_ps(u, v));
+
+        const __m256 weightedU = _mm256_mul_ps(u, oneOverW2);
+        const __m256 weightedV = _mm256_mul_ps(v, oneOverW0);
+        const __m256 oneOverWAtPixel = _mm256_fmadd_ps(w, oneOverW1, _mm256_add_ps(weightedU, weightedV));
+        const __m256 wAtPixel = _mm256_div_ps(_mm256_set1_ps(1.0f), oneOverWAtPixel);
+
+        _mm256_maskstore_ps(barycentricCoordinates.pU + baryIndex, laneMask, _mm256_mul_ps(weightedU, wAtPixel));
+        _mm256_maskstore_ps(barycentricCoordinates.pV + baryIndex, laneMask, _mm256_mul_ps(weightedV, wAtPixel));
+    }
+}
+
+//FK: Same as _k15_generate_barycentric_vertices for the attribute array layout, interpolates 8 pixels at a time.
+//    The last 8 pixels get stored in full, the values past the run get overwritten by the next run or end up in the padding.
+internal void _k15_generate_barycentric_attributes(pixel_shader_attributes_t* pAttributes, uint32_t pixelOffset, barycentric_coordinates_buffer_t barycentricCoordinates, uint32_t barycentricCoordinateCount, const vertex_t* pTriangleVertices, uint32_t attributeMask)
+{
+    constexpr uint32_t attributeComponentCount = sizeof(vertex_t) / sizeof(float);
+    float* const* ppAttributeArrays = (float* const*)pAttributes;
+    const float* restrict_modifier pInputVertexAttributes[3] = {
+        (const float*)&pTriangleVertices[0],
+        (const float*)&pTriangleVertices[1],
+        (const float*)&pTriangleVertices[2]
+    };
+
+    uint32_t componentIndices[attributeComponentCount];
+    uint32_t componentCount = 0u;
+    for( uint32_t attributeIndex = 0u; attributeIndex < (uint32_t)vertex_attribute_t::count; ++attributeIndex )
+    {
+        if( ( attributeMask & ( 1u << attributeIndex ) ) == 0u )
+        {
+            continue;
+        }
+
+        const uint32_t firstComponentIndex = attributeIndex * 4u;
+        const uint32_t lastComponentIndex = get_min(firstComponentIndex + 4u, attributeComponentCount);
+        for( uint32_t componentIndex = firstComponentIndex; componentIndex < lastComponentIndex; ++componentIndex )
+        {
+            componentIndices[componentCount++] = componentIndex;
+        }
+    }
+
+    const __m256i laneIndices = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    for( uint32_t baryIndex = 0u; baryIndex < barycentricCoordinateCount; baryIndex += 8u )
+    {
+        const __m256i laneMask = _mm256_cmpgt_epi32(_mm256_set1_epi32(barycentricCoordinateCount - baryIndex), laneIndices);
+        const __m256 u = _mm256_maskload_ps(barycentricCoordinates.pU + baryIndex, laneMask);
+        const __m256 v = _mm256_maskload_ps(barycentricCoordinates.pV + baryIndex, laneMask);
+        const __m256 w = _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_add_ps(u, v));
+
+        for( uint32_t componentIndex = 0u; componentIndex < componentCount; ++componentIndex )
+        {
+            const uint32_t attributeComponentIndex = componentIndices[componentIndex];
+            __m256 attribute = _mm256_mul_ps(_mm256_set1_ps(pInputVertexAttributes[2][attributeComponentIndex]), u);
+            attribute = _mm256_fmadd_ps(_mm256_set1_ps(pInputVertexAttributes[1][attributeComponentIndex]), w, attribute);
+            attribute = _mm256_fmadd_ps(_mm256_set1_ps(pInputVertexAttributes[0][attributeComponentIndex]), v, attribute);
+
+            _mm256_storeu_ps(ppAttributeArrays[attributeComponentIndex] + pixelOffset + baryIndex, attribute);
         }
     }
 }
@@ -1488,27 +2623,159 @@ internal void _k15_write_color_to_color_buffer(const pixel_shader_output_t* pPix
     }
 }
 
-template<bool DEPTH_WRITE_ENABLED = true>
-internal void _k15_draw_triangle_lines(draw_call_triangles_t* pDrawCallTriangles, pixel_shader_input_t pixelShaderInput, pixel_shader_output_t pixelShaderOutput, barycentric_coordinates_buffer_t barycentricCoordinates, void* pColorBuffer, void* pDepthBuffer, uint32_t colorBufferStride, uint32_t depthBufferStride, uint8_t redShift, uint8_t greenShift, uint8_t blueShift)
+//FK: Helper pixels only get shaded for the derivatives of their quad, removes them from the pixel shader output.
+//    Returns the number of remaining pixels.
+internal uint32_t _k15_remove_helper_pixels(shading_context_t* pShadingContext, uint32_t pixelCount)
 {
-    const void* restrict_modifier pUniformData = pDrawCallTriangles->pUniformData;
-    pixel_shader_fnc_t pixelShader = pDrawCallTriangles->pixelShader;
+    const uint32_t* restrict_modifier pHelperPixelMask = pShadingContext->pHelperPixelMask;
+    vector4f_t* restrict_modifier pColor = pShadingContext->pixelShaderOutput.pColor;
+    uint32_t* restrict_modifier pScreenspaceX = pShadingContext->pixelShaderInput.pScreenspaceX;
+    uint32_t* restrict_modifier pScreenspaceY = pShadingContext->pixelShaderInput.pScreenspaceY;
 
-    uint32_t pixelCount = 0;
-    uint32_t* restrict_modifier pColorBufferContent = (uint32_t* restrict_modifier)pColorBuffer;
-    float* restrict_modifier pDepthBufferContent = (float* restrict_modifier)pDepthBuffer;
-
-    for(uint32_t triangleIndex = 0; triangleIndex < pDrawCallTriangles->screenspaceTriangleCount; ++triangleIndex)
+    uint32_t outputPixelCount = 0u;
+    for( uint32_t pixelIndex = 0u; pixelIndex < pixelCount; ++pixelIndex )
     {
-        const screenspace_triangle_t* restrict_modifier pTriangle = pDrawCallTriangles->pScreenspaceTriangles + triangleIndex;
-
-        for(uint32_t triangleVertexIndex = 0; triangleVertexIndex < 3u; ++triangleVertexIndex)
+        if( pHelperPixelMask[pixelIndex] != 0u )
         {
-            const uint32_t nextTriangleVertexIndex = (triangleVertexIndex + 1) % 3;
-            const vector3f_t screenspaceVertexPositions[] = {
-                pTriangle->screenspaceVertexPositions[triangleVertexIndex],
-                pTriangle->screenspaceVertexPositions[nextTriangleVertexIndex]
-            };
+            continue;
+        }
+
+        pColor[outputPixelCount]        = pColor[pixelIndex];
+        pScreenspaceX[outputPixelCount] = pScreenspaceX[pixelIndex];
+        pScreenspaceY[outputPixelCount] = pScreenspaceY[pixelIndex];
+        ++outputPixelCount;
+    }
+
+    return outputPixelCount;
+}
+
+//FK: Shades pixels of multiple triangles with a single pixel shader invocation, pixels have to be sorted by run.
+internal void _k15_shade_pixel_runs(shading_context_t* pShadingContext, uint32_t pixelCount, const pixel_batch_run_t* pRuns, uint32_t runCount, uint32_t attributeMask, interpolation_mode_t interpolationMode, pixel_shader_input_layout_t inputLayout, bool quadShadingEnabled, pixel_shader_fnc_t pixelShader, const void* pUniformData, uint32_t* pColorBufferContent, uint32_t colorBufferStride, uint8_t redShift, uint8_t greenShift, uint8_t blueShift)
+{
+    pShadingContext->pixelShaderInput.layout = inputLayout;
+    pShadingContext->pixelShaderInput.pHelperPixelMask = quadShadingEnabled ? pShadingContext->pHelperPixelMask : nullptr;
+
+    pixel_shader_input_t runPixelShaderInput = pShadingContext->pixelShaderInput;
+    barycentric_coordinates_buffer_t runBarycentricCoordinates = pShadingContext->barycentricCoordinates;
+    uint32_t runPixelOffset = 0u;
+    for( uint32_t runIndex = 0u; runIndex < runCount; ++runIndex )
+    {
+        const pixel_batch_run_t* pRun = pRuns + runIndex;
+        if( interpolationMode == interpolation_mode_t::perspective_correct )
+        {
+            _k15_apply_perspective_correction(runBarycentricCoordinates, pRun->pixelCount, pRun->pTriangle->oneOverW);
+        }
+
+        if( inputLayout == pixel_shader_input_layout_t::attribute_arrays )
+        {
+            _k15_generate_barycentric_attributes(&pShadingContext->pixelShaderInput.attributes, runPixelOffset, runBarycentricCoordinates, pRun->pixelCount, pRun->pTriangle->vertices, attributeMask);
+        }
+        else
+        {
+            _k15_generate_barycentric_vertices(&runPixelShaderInput, runBarycentricCoordinates, pRun->pixelCount, pRun->pTriangle->vertices, attributeMask);
+        }
+
+        runPixelOffset                  += pRun->pixelCount;
+        runPixelShaderInput.pVertexData += pRun->pixelCount;
+        runBarycentricCoordinates.pU    += pRun->pixelCount;
+        runBarycentricCoordinates.pV    += pRun->pixelCount;
+    }
+
+    pixelShader(&pShadingContext->pixelShaderInput, &pShadingContext->pixelShaderOutput, pixelCount, pUniformData);
+    _k15_reset_stack_allocator(&pShadingContext->stackAllocator);
+
+    if( quadShadingEnabled )
+    {
+        pixelCount = _k15_remove_helper_pixels(pShadingContext, pixelCount);
+    }
+
+    _k15_write_color_to_color_buffer(&pShadingContext->pixelShaderOutput, pixelCount, pColorBufferContent, colorBufferStride, redShift, greenShift, blueShift);
+}
+
+//FK: Used for lines, their pixels only use the attributes of a single vertex so they don't need perspective correction
+//    and they don't get shaded as quads.
+internal void _k15_shade_pixels(shading_context_t* pShadingContext, uint32_t pixelCount, const screenspace_triangle_t* pTriangle, uint32_t attributeMask, pixel_shader_input_layout_t inputLayout, pixel_shader_fnc_t pixelShader, const void* pUniformData, uint32_t* pColorBufferContent, uint32_t colorBufferStride, uint8_t redShift, uint8_t greenShift, uint8_t blueShift)
+{
+    const pixel_batch_run_t run = { pTriangle, pixelCount };
+    _k15_shade_pixel_runs(pShadingContext, pixelCount, &run, 1u, attributeMask, interpolation_mode_t::affine, inputLayout, false, pixelShader, pUniformData, pColorBufferContent, colorBufferStride, redShift, greenShift, blueShift);
+}
+
+internal void _k15_flush_pixel_batch(shading_context_t* pShadingContext, uint32_t* pColorBufferContent, uint32_t colorBufferStride, uint8_t redShift, uint8_t greenShift, uint8_t blueShift)
+{
+    pixel_batch_t* pPixelBatch = &pShadingContext->pixelBatch;
+    if( pPixelBatch->pixelCount > 0u )
+    {
+        const raster_draw_call_t* pDrawCall = pPixelBatch->pDrawCall;
+        _k15_shade_pixel_runs(pShadingContext, pPixelBatch->pixelCount, pPixelBatch->pRuns, pPixelBatch->runCount, pDrawCall->attributeMask, pDrawCall->interpolationMode, pDrawCall->pixelShaderInputLayout, pDrawCall->quadShadingEnabled, pDrawCall->pixelShader, pDrawCall->pUniformData, pColorBufferContent, colorBufferStride, redShift, greenShift, blueShift);
+    }
+
+    pPixelBatch->runCount   = 0u;
+    pPixelBatch->pixelCount = 0u;
+}
+
+//FK: Makes room for pixelCount pixels of pDrawCall in the pixel batch.
+//    The batch gets shaded first if it belongs to a different draw call or if it's too full.
+internal void _k15_reserve_pixel_batch(shading_context_t* pShadingContext, const raster_draw_call_t* pDrawCall, uint32_t pixelCount, uint32_t* pColorBufferContent, uint32_t colorBufferStride, uint8_t redShift, uint8_t greenShift, uint8_t blueShift)
+{
+    RuntimeAssert(pixelCount <= PixelShaderInputCount);
+
+    pixel_batch_t* pPixelBatch = &pShadingContext->pixelBatch;
+    if( pPixelBatch->pDrawCall != pDrawCall || pPixelBatch->pixelCount + pixelCount > PixelShaderInputCount )
+    {
+        _k15_flush_pixel_batch(pShadingContext, pColorBufferContent, colorBufferStride, redShift, greenShift, blueShift);
+        pPixelBatch->pDrawCall = pDrawCall;
+    }
+}
+
+//FK: Pixels [pixelBatch.pixelCount, newPixelCount) have been appended for pTriangle.
+internal void _k15_commit_pixel_batch_run(pixel_batch_t* pPixelBatch, const screenspace_triangle_t* pTriangle, uint32_t newPixelCount)
+{
+    const uint32_t runPixelCount = newPixelCount - pPixelBatch->pixelCount;
+    if( runPixelCount == 0u )
+    {
+        return;
+    }
+
+    pPixelBatch->pixelCount = newPixelCount;
+
+    //FK: Merge with the previous run if the pixels belong to the same triangle (eg: neighbouring raster tiles)
+    if( pPixelBatch->runCount > 0u && pPixelBatch->pRuns[pPixelBatch->runCount - 1u].pTriangle == pTriangle )
+    {
+        pPixelBatch->pRuns[pPixelBatch->runCount - 1u].pixelCount += runPixelCount;
+        return;
+    }
+
+    pixel_batch_run_t* pRun = pPixelBatch->pRuns + pPixelBatch->runCount++;
+    pRun->pTriangle = pTriangle;
+    pRun->pixelCount        = runPixelCount;
+}
+
+template<bool DEPTH_WRITE_ENABLED = true>
+internal void _k15_draw_triangle_lines(draw_call_triangles_t* pDrawCallTriangles, shading_context_t* pShadingContext, void* pColorBuffer, void* pDepthBuffer, uint32_t backBufferWidth, uint32_t backBufferHeight, uint32_t colorBufferStride, uint32_t depthBufferStride, uint8_t redShift, uint8_t greenShift, uint8_t blueShift)
+{
+    const void* restrict_modifier pUniformData = pDrawCallTriangles->pUniformData;
+    pixel_shader_fnc_t pixelShader = pDrawCallTriangles->pixelShader;
+    const uint32_t attributeMask = pDrawCallTriangles->attributeMask;
+    const pixel_shader_input_layout_t pixelShaderInputLayout = pDrawCallTriangles->pixelShaderInputLayout;
+
+    uint32_t* restrict_modifier pColorBufferContent = (uint32_t* restrict_modifier)pColorBuffer;
+    float* restrict_modifier pDepthBufferContent = (float* restrict_modifier)pDepthBuffer;
+    const barycentric_coordinates_buffer_t barycentricCoordinates = pShadingContext->barycentricCoordinates;
+    uint32_t* restrict_modifier pScreenspaceX = pShadingContext->pixelShaderInput.pScreenspaceX;
+    uint32_t* restrict_modifier pScreenspaceY = pShadingContext->pixelShaderInput.pScreenspaceY;
+
+    for(uint32_t triangleIndex = 0; triangleIndex < pDrawCallTriangles->screenspaceTriangleCount; ++triangleIndex)
+    {
+        const screenspace_triangle_t* restrict_modifier pTriangle = pDrawCallTriangles->pScreenspaceTriangles + triangleIndex;
+        uint32_t pixelCount = 0;
+
+        for(uint32_t triangleVertexIndex = 0; triangleVertexIndex < 3u; ++triangleVertexIndex)
+        {
+            const uint32_t nextTriangleVertexIndex = (triangleVertexIndex + 1) % 3;
+            const vector3f_t screenspaceVertexPositions[] = {
+                pTriangle->screenspaceVertexPositions[triangleVertexIndex],
+                pTriangle->screenspaceVertexPositions[nextTriangleVertexIndex]
+            };
 
             int x = (int)screenspaceVertexPositions[0].x;
             int y = (int)screenspaceVertexPositions[0].y;
@@ -1537,11 +2804,20 @@ internal void _k15_draw_triangle_lines(draw_call_triangles_t* pDrawCallTriangles
                     for (int j=0x8000+(x<<16);y<=longLen;++y) {
                         const uint32_t localX = j >> 16;
                         const uint32_t localY = y;
-                        pixelShaderInput.pScreenspaceX[pixelCount] = localX;
-                        pixelShaderInput.pScreenspaceY[pixelCount] = localY;
-                        barycentricCoordinates.pU[pixelCount] = 0.0f;
-                        barycentricCoordinates.pV[pixelCount] = 0.0f;
-                        ++pixelCount;
+                        //FK: Vertices in the guard band can be outside of the screen
+                        if( localX < backBufferWidth && localY < backBufferHeight )
+                        {
+                            pScreenspaceX[pixelCount] = localX;
+                            pScreenspaceY[pixelCount] = localY;
+                            barycentricCoordinates.pU[pixelCount] = 0.0f;
+                            barycentricCoordinates.pV[pixelCount] = 0.0f;
+                            ++pixelCount;
+                            if( pixelCount == PixelShaderInputCount )
+                            {
+                                _k15_shade_pixels(pShadingContext, pixelCount, pTriangle, attributeMask, pixelShaderInputLayout, pixelShader, pUniformData, pColorBufferContent, colorBufferStride, redShift, greenShift, blueShift);
+                                pixelCount = 0;
+                            }
+                        }
                         j+=decInc;
                     }
                     continue;
@@ -1550,11 +2826,19 @@ internal void _k15_draw_triangle_lines(draw_call_triangles_t* pDrawCallTriangles
                 for (int j=0x8000+(x<<16);y>=longLen;--y) {
                     const uint32_t localX = j >> 16;
                     const uint32_t localY = y;
-                    pixelShaderInput.pScreenspaceX[pixelCount] = localX;
-                    pixelShaderInput.pScreenspaceY[pixelCount] = localY;
-                    barycentricCoordinates.pU[pixelCount] = 0.0f;
-                    barycentricCoordinates.pV[pixelCount] = 0.0f;
-                    ++pixelCount;
+                    if( localX < backBufferWidth && localY < backBufferHeight )
+                    {
+                        pScreenspaceX[pixelCount] = localX;
+                        pScreenspaceY[pixelCount] = localY;
+                        barycentricCoordinates.pU[pixelCount] = 0.0f;
+                        barycentricCoordinates.pV[pixelCount] = 0.0f;
+                        ++pixelCount;
+                        if( pixelCount == PixelShaderInputCount )
+                        {
+                            _k15_shade_pixels(pShadingContext, pixelCount, pTriangle, attributeMask, pixelShaderInputLayout, pixelShader, pUniformData, pColorBufferContent, colorBufferStride, redShift, greenShift, blueShift);
+                            pixelCount = 0;
+                        }
+                    }
                     j-=decInc;
                 }
                 continue;	
@@ -1565,11 +2849,19 @@ internal void _k15_draw_triangle_lines(draw_call_triangles_t* pDrawCallTriangles
                 for (int j=0x8000+(y<<16);x<=longLen;++x) {
                     const uint32_t localX = x;
                     const uint32_t localY = j >> 16;
-                    pixelShaderInput.pScreenspaceX[pixelCount] = localX;
-                    pixelShaderInput.pScreenspaceY[pixelCount] = localY;
-                    barycentricCoordinates.pU[pixelCount] = 0.0f;
-                    barycentricCoordinates.pV[pixelCount] = 0.0f;
-                    ++pixelCount;
+                    if( localX < backBufferWidth && localY < backBufferHeight )
+                    {
+                        pScreenspaceX[pixelCount] = localX;
+                        pScreenspaceY[pixelCount] = localY;
+                        barycentricCoordinates.pU[pixelCount] = 0.0f;
+                        barycentricCoordinates.pV[pixelCount] = 0.0f;
+                        ++pixelCount;
+                        if( pixelCount == PixelShaderInputCount )
+                        {
+                            _k15_shade_pixels(pShadingContext, pixelCount, pTriangle, attributeMask, pixelShaderInputLayout, pixelShader, pUniformData, pColorBufferContent, colorBufferStride, redShift, greenShift, blueShift);
+                            pixelCount = 0;
+                        }
+                    }
                     j+=decInc;
                 }
                 continue;
@@ -1578,1131 +2870,2775 @@ internal void _k15_draw_triangle_lines(draw_call_triangles_t* pDrawCallTriangles
             for (int j=0x8000+(y<<16);x>=longLen;--x) {
                 const uint32_t localX = x;
                 const uint32_t localY = j >> 16;
-                pixelShaderInput.pScreenspaceX[pixelCount] = localX;
-                pixelShaderInput.pScreenspaceY[pixelCount] = localY;
-                barycentricCoordinates.pU[pixelCount] = 0.0f;
-                barycentricCoordinates.pV[pixelCount] = 0.0f;
-                ++pixelCount;
+                if( localX < backBufferWidth && localY < backBufferHeight )
+                {
+                    pScreenspaceX[pixelCount] = localX;
+                    pScreenspaceY[pixelCount] = localY;
+                    barycentricCoordinates.pU[pixelCount] = 0.0f;
+                    barycentricCoordinates.pV[pixelCount] = 0.0f;
+                    ++pixelCount;
+                    if( pixelCount == PixelShaderInputCount )
+                    {
+                        _k15_shade_pixels(pShadingContext, pixelCount, pTriangle, attributeMask, pixelShaderInputLayout, pixelShader, pUniformData, pColorBufferContent, colorBufferStride, redShift, greenShift, blueShift);
+                        pixelCount = 0;
+                    }
+                }
                 j-=decInc;
             }
         }
 
-        _k15_generate_barycentric_vertices(&pixelShaderInput, barycentricCoordinates, pixelCount, pTriangle->vertices);
-        pixelShader(&pixelShaderInput, &pixelShaderOutput, pixelCount, pUniformData);
-        _k15_reset_stack_allocator(pixelShaderInput.pStackAllocator);
-        _k15_write_color_to_color_buffer(&pixelShaderOutput, pixelCount, pColorBufferContent, colorBufferStride, redShift, greenShift, blueShift);
+        if( pixelCount > 0u )
+        {
+            _k15_shade_pixels(pShadingContext, pixelCount, pTriangle, attributeMask, pixelShaderInputLayout, pixelShader, pUniformData, pColorBufferContent, colorBufferStride, redShift, greenShift, blueShift);
+        }
     }
 }
 
-template<bool DEPTH_WRITE_ENABLED = true>
-internal void _k15_draw_triangles_8_step(draw_call_triangles_t* pDrawCallTriangles, pixel_shader_input_t pixelShaderInput, pixel_shader_output_t pixelShaderOutput, barycentric_coordinates_buffer_t barycentricCoordinates, void* pColorBuffer, void* pDepthBuffer, uint32_t colorBufferStride, uint32_t depthBufferStride, uint8_t redShift, uint8_t greenShift, uint8_t blueShift)
+//FK: Returns the permutation (for _mm256_permutevar8x32_*) that moves the lanes whose bit is set in bitMask to the front.
+internal inline __m256i _k15_get_left_pack_permutation(uint32_t bitMask)
 {
-    const void* restrict_modifier pUniformData = pDrawCallTriangles->pUniformData;
-    pixel_shader_fnc_t pixelShader = pDrawCallTriangles->pixelShader;
+    RuntimeAssert(bitMask < 256);
 
-    uint32_t* restrict_modifier pColorBufferContent = (uint32_t* restrict_modifier)pColorBuffer;
-    float* restrict_modifier pDepthBufferContent = (float* restrict_modifier)pDepthBuffer;
+    const uint32_t shuffleBitMask = ShuffleBitMaskLUT8x[bitMask];
+    const __m256i shuffleBitMaskShift = _mm256_set_epi32( 0, 3, 6, 9, 12, 15, 18, 21 );
+    return _mm256_and_si256(_mm256_srav_epi32(_mm256_set1_epi32(shuffleBitMask), shuffleBitMaskShift), _mm256_set1_epi32(0b111));
+}
 
-    for(uint32_t triangleIndex = 0; triangleIndex < pDrawCallTriangles->screenspaceTriangleCount; ++triangleIndex)
-    {
-        const screenspace_triangle_t* restrict_modifier pTriangle = pDrawCallTriangles->pScreenspaceTriangles + triangleIndex;
+//FK: Appends the pixels of a span that are set in pixelMask to the shading context's pixel shader input.
+//    Returns the number of appended pixels.
+internal inline uint32_t _k15_append_pixels(shading_context_t* pShadingContext, uint32_t pixelIndex, __m256i depthBufferMask, __m256 uWide, __m256 vWide, __m256i pixelCoordinatesXWide, uint32_t tileY)
+{
+    const barycentric_coordinates_buffer_t barycentricCoordinates = pShadingContext->barycentricCoordinates;
+    uint32_t* restrict_modifier pScreenspaceX = pShadingContext->pixelShaderInput.pScreenspaceX;
+    uint32_t* restrict_modifier pScreenspaceY = pShadingContext->pixelShaderInput.pScreenspaceY;
 
-        const vector3f_t v0 = pTriangle->screenspaceVertexPositions[0];
-        const vector3f_t v1 = pTriangle->screenspaceVertexPositions[1];
-        const vector3f_t v2 = pTriangle->screenspaceVertexPositions[2];
-        const float triangleArea = _k15_edge_function(v2, v1, v0);
-        const float oneOverTriangleArea = 1.0f / triangleArea;
+    //FK: Extract 4-bit bit mask from depthBufferMask
+    __m256i pixelBits = _mm256_srlv_epi32(depthBufferMask, _mm256_set1_epi32(31));
+    pixelBits = _mm256_sllv_epi32(pixelBits, _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0));
 
-        const float edge0Term0 = v0.x - v1.x;
-        const float edge0Term2 = v0.y - v1.y;
-        const float edge1Term0 = v1.x - v2.x;
-        const float edge1Term2 = v1.y - v2.y;
+    pixelBits = _mm256_hadd_epi32(pixelBits, _mm256_setzero_si256());
+    pixelBits = _mm256_hadd_epi32(pixelBits, _mm256_setzero_si256());
+    const int outputBitMask = _mm256_extract_epi32(pixelBits, 0) + _mm256_extract_epi32(pixelBits, 4);
+    RuntimeAssert(outputBitMask < 256);
 
-        for(uint32_t y = pTriangle->boundingBox.y1; y < pTriangle->boundingBox.y2; y += PixelShaderTileSize)
-        {
-            MemoryPrefetchNTA(pDepthBufferContent + pTriangle->boundingBox.x1 + y * depthBufferStride);
+    const int outputBitMaskPopCnt = __popcnt(outputBitMask);
+    const int outputMaskLUTIndex = outputBitMaskPopCnt;
+    RuntimeAssert(outputMaskLUTIndex < 9);
 
-            const uint32_t yDelta = (pTriangle->boundingBox.y2 - y);
-            const uint32_t yStep = get_min(PixelShaderTileSize, yDelta);
-            const uint32_t tileYEnd = y + yStep;
+    const __m256i outputMask = _mm256_load_si256((const __m256i*)(OutputBitMaskLUT8x[outputMaskLUTIndex]));
+    const __m256i blendMaskWide = _k15_get_left_pack_permutation(outputBitMask);
 
-            for(uint32_t x = pTriangle->boundingBox.x1; x < pTriangle->boundingBox.x2; x += PixelShaderTileSize)
-            {   
-                const uint32_t xDelta = (pTriangle->boundingBox.x2 - x);
-                const uint32_t xStep = get_min(PixelShaderTileSize, xDelta);
-                const uint32_t tileXEnd = x + xStep;
+    const __m256 uWideShuffled = _mm256_permutevar8x32_ps(uWide, blendMaskWide);
+    const __m256 vWideShuffled = _mm256_permutevar8x32_ps(vWide, blendMaskWide);
+    const __m256i pixelCoordinatesXShuffled = _mm256_permutevar8x32_epi32(pixelCoordinatesXWide, blendMaskWide);
 
-                uint32_t pixelIndex = 0;
-                for( uint32_t tileY = y; tileY < tileYEnd; ++tileY)
-                {
-                    for( uint32_t tileX = x; tileX < tileXEnd; tileX += 8u)
-                    {
-                        const uint32_t depthBufferOffset = tileX + tileY * depthBufferStride;
-                        const float tileXF = (float)tileX;
+    _mm256_maskstore_epi32((int*)(pScreenspaceX + pixelIndex), outputMask, pixelCoordinatesXShuffled);
+    _mm256_maskstore_epi32((int*)(pScreenspaceY + pixelIndex), outputMask, _mm256_set1_epi32(tileY));
+    _mm256_maskstore_ps((barycentricCoordinates.pU + pixelIndex), outputMask, uWideShuffled);
+    _mm256_maskstore_ps((barycentricCoordinates.pV + pixelIndex), outputMask, vWideShuffled);
+
+    return outputBitMaskPopCnt;
+}
 
-                        //const __m256 pixelCoordinatesXWide = _mm256_add_ps(_mm256_broadcast_ss(&tileXF), _mm256_set_ps( 7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f));
-                        const __m256 pixelCoordinatesXWide = _mm256_add_ps(_mm256_set1_ps(tileXF), _mm256_set_ps( 7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f));
+//FK: Stores the values of two span rows as 4 consecutive 2x2 quads (top left, top right, bottom left, bottom right).
+internal inline void _k15_store_quads(float* pOutQuads, __m256 row0, __m256 row1)
+{
+    const __m256 quads02 = _mm256_castpd_ps(_mm256_unpacklo_pd(_mm256_castps_pd(row0), _mm256_castps_pd(row1)));
+    const __m256 quads13 = _mm256_castpd_ps(_mm256_unpackhi_pd(_mm256_castps_pd(row0), _mm256_castps_pd(row1)));
+    _mm256_store_ps(pOutQuads + 0u, _mm256_permute2f128_ps(quads02, quads13, 0x20));
+    _mm256_store_ps(pOutQuads + 8u, _mm256_permute2f128_ps(quads02, quads13, 0x31));
+}
 
-                        const float edge0Term1      = tileY - v1.y;
-                        const float edge1Term1      = tileY - v2.y;
-                        const __m256 edge0Term3Wide = _mm256_sub_ps(pixelCoordinatesXWide, _mm256_broadcast_ss(&v1.x));
-                        const __m256 edge1Term3Wide = _mm256_sub_ps(pixelCoordinatesXWide, _mm256_broadcast_ss(&v2.x));
-                        
-                        const __m256 w0Wide     = _mm256_fmsub_ps(_mm256_broadcast_ss(&edge0Term0), _mm256_broadcast_ss(&edge0Term1), _mm256_mul_ps(_mm256_broadcast_ss(&edge0Term2), edge0Term3Wide));
-                        const __m256i w0Mask    = _mm256_castps_si256(_mm256_cmp_ps(w0Wide, _mm256_setzero_ps(), _CMP_GT_OQ));
+//FK: Appends the 2x2 pixel quads of two span rows that contain at least one pixel set in pRowMasks to the shading context's
+//    pixel shader input. The pixels of a quad that are not set get appended as helper pixels.
+//    Returns the number of appended pixels.
+internal inline uint32_t _k15_append_quads(shading_context_t* pShadingContext, uint32_t pixelIndex, const __m256i* pRowMasks, const __m256* pRowU, const __m256* pRowV, __m256i pixelCoordinatesXWide, uint32_t tileY)
+{
+    const uint32_t pixelBits = (uint32_t)( _mm256_movemask_ps(_mm256_castsi256_ps(pRowMasks[0])) | _mm256_movemask_ps(_mm256_castsi256_ps(pRowMasks[1])) );
+    if( pixelBits == 0u )
+    {
+        return 0u;
+    }
 
-                        const __m256 w1Wide     = _mm256_fmsub_ps(_mm256_broadcast_ss(&edge1Term0), _mm256_broadcast_ss(&edge1Term1), _mm256_mul_ps(_mm256_broadcast_ss(&edge1Term2), edge1Term3Wide));
-                        const __m256i w1Mask    = _mm256_castps_si256(_mm256_cmp_ps(w1Wide,  _mm256_setzero_ps(), _CMP_GT_OQ));
+    alignas(32) float quadU[16u];
+    alignas(32) float quadV[16u];
+    alignas(32) float quadX[16u];
+    alignas(32) float quadY[16u];
+    alignas(32) float quadHelperPixelMask[16u];
+
+    const __m256i allBits = _mm256_set1_epi32(-1);
+    _k15_store_quads(quadU, pRowU[0], pRowU[1]);
+    _k15_store_quads(quadV, pRowV[0], pRowV[1]);
+    _k15_store_quads(quadX, _mm256_castsi256_ps(pixelCoordinatesXWide), _mm256_castsi256_ps(pixelCoordinatesXWide));
+    _k15_store_quads(quadY, _mm256_castsi256_ps(_mm256_set1_epi32(tileY)), _mm256_castsi256_ps(_mm256_set1_epi32(tileY + 1u)));
+    _k15_store_quads(quadHelperPixelMask, _mm256_castsi256_ps(_mm256_andnot_si256(pRowMasks[0], allBits)), _mm256_castsi256_ps(_mm256_andnot_si256(pRowMasks[1], allBits)));
+
+    const barycentric_coordinates_buffer_t barycentricCoordinates = pShadingContext->barycentricCoordinates;
+    uint32_t* restrict_modifier pScreenspaceX = pShadingContext->pixelShaderInput.pScreenspaceX;
+    uint32_t* restrict_modifier pScreenspaceY = pShadingContext->pixelShaderInput.pScreenspaceY;
+    uint32_t* restrict_modifier pHelperPixelMask = pShadingContext->pHelperPixelMask;
+
+    uint32_t appendedPixelCount = 0u;
+    for( uint32_t quadIndex = 0u; quadIndex < 4u; ++quadIndex )
+    {
+        if( ( ( pixelBits >> ( quadIndex * 2u ) ) & 0x3u ) == 0u )
+        {
+            continue;
+        }
 
-                        const __m256 w2Wide     = _mm256_sub_ps(_mm256_broadcast_ss(&triangleArea), _mm256_add_ps(w0Wide, w1Wide));
-                        const __m256i w2Mask    = _mm256_castps_si256(_mm256_cmp_ps(w2Wide,  _mm256_setzero_ps(), _CMP_GT_OQ));
+        const uint32_t quadOffset = quadIndex * 4u;
+        const uint32_t outputIndex = pixelIndex + appendedPixelCount;
+        _mm_storeu_ps(barycentricCoordinates.pU + outputIndex, _mm_load_ps(quadU + quadOffset));
+        _mm_storeu_ps(barycentricCoordinates.pV + outputIndex, _mm_load_ps(quadV + quadOffset));
+        _mm_storeu_ps((float*)(pScreenspaceX + outputIndex), _mm_load_ps(quadX + quadOffset));
+        _mm_storeu_ps((float*)(pScreenspaceY + outputIndex), _mm_load_ps(quadY + quadOffset));
+        _mm_storeu_ps((float*)(pHelperPixelMask + outputIndex), _mm_load_ps(quadHelperPixelMask + quadOffset));
+        appendedPixelCount += 4u;
+    }
 
-                        const __m256i pixelMask = _mm256_and_si256(_mm256_and_si256(w0Mask, w1Mask), w2Mask);
-                        if( _mm256_movemask_epi8(pixelMask) == 0 )
-                        {
-                            continue;
-                        }
+    return appendedPixelCount;
+}
 
-                        const __m256 uWide = _mm256_mul_ps(w0Wide, _mm256_broadcast_ss(&oneOverTriangleArea));
-                        const __m256 vWide = _mm256_mul_ps(w1Wide, _mm256_broadcast_ss(&oneOverTriangleArea));
-                        const __m256 wWide = _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_add_ps(uWide, vWide));
+internal inline vector2i_t _k15_snap_to_sub_pixel(vector3f_t screenspacePosition)
+{
+    vector2i_t fixedPointPosition;
+    fixedPointPosition.x = _mm_cvtss_si32(_mm_set_ss(screenspacePosition.x * SubPixelScale));
+    fixedPointPosition.y = _mm_cvtss_si32(_mm_set_ss(screenspacePosition.y * SubPixelScale));
 
-                        const __m256 newDepthBufferZ = _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_fmadd_ps(_mm256_broadcast_ss(&v0.z), uWide, _mm256_fmadd_ps(_mm256_broadcast_ss(&v1.z), vWide, _mm256_mul_ps(_mm256_broadcast_ss(&v2.z), wWide))));
-                        const __m256 oldDepthBufferZ = _mm256_load_ps(pDepthBufferContent + depthBufferOffset);
+    return fixedPointPosition;
+}
 
-                        __m256i depthBufferMask = _mm256_castps_si256(_mm256_cmp_ps(newDepthBufferZ, oldDepthBufferZ, _CMP_GT_OQ));
-                        depthBufferMask = _mm256_and_si256(depthBufferMask, pixelMask);
-                        if( _mm256_movemask_epi8(depthBufferMask) == 0 )
-                        {
-                            continue;
-                        }
+//FK: Sets up the 3 edge functions of a triangle from its fixed point vertex positions and returns
+//    twice the triangle area in sub pixel units (<= 0 for triangles that don't cover anything).
+//    Pixels are sampled at integer coordinates, the edge function of the edge p->q at sample (x,y) is
+//    E = (q.x - p.x) * (y * 256 - p.y) - (q.y - p.y) * (x * 256 - p.x).
+//    Since the sample positions are multiples of 256, E / 256 can be evaluated without the lower 8 bits
+//    of the constant term.
+//    Top-left rule: Pixels exactly on an edge only belong to the triangle if the edge is a top or left edge,
+//    so pixels on an edge shared by two triangles get shaded exactly once.
+internal int64_t _k15_setup_raster_edges(raster_edge_t* pOutEdges, const vector2i_t* pFixedPointVertexPositions)
+{
+    constexpr uint32_t edgeVertexIndices[3][2] = {
+        {1u, 0u}, {2u, 1u}, {0u, 2u}
+    };
 
-                        if( DEPTH_WRITE_ENABLED )
-                        {
-                            _mm256_maskstore_ps(pDepthBufferContent + depthBufferOffset, depthBufferMask, newDepthBufferZ);
-                        }
+    for( uint32_t edgeIndex = 0u; edgeIndex < 3u; ++edgeIndex )
+    {
+        const vector2i_t p = pFixedPointVertexPositions[edgeVertexIndices[edgeIndex][0]];
+        const vector2i_t q = pFixedPointVertexPositions[edgeVertexIndices[edgeIndex][1]];
+        const int64_t dx = (int64_t)q.x - p.x;
+        const int64_t dy = (int64_t)q.y - p.y;
 
-                        //FK: Extract 4-bit bit mask from depthBufferMask
-                        __m256i pixelBits = _mm256_srlv_epi32(depthBufferMask, _mm256_set1_epi32(31));
-                        pixelBits = _mm256_sllv_epi32(pixelBits, _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+        const bool isTopLeftEdge = dy < 0 || ( dy == 0 && dx > 0 );
+        const int64_t bias = isTopLeftEdge ? 0 : -1;
 
-                        pixelBits = _mm256_hadd_epi32(pixelBits, _mm256_setzero_si256());
-                        pixelBits = _mm256_hadd_epi32(pixelBits, _mm256_setzero_si256());
-                        const int outputBitMask = _mm256_extract_epi32(pixelBits, 0) + _mm256_extract_epi32(pixelBits, 4);
-                        RuntimeAssert(outputBitMask < 256);
+        pOutEdges[edgeIndex].stepX  = (int32_t)-dy;
+        pOutEdges[edgeIndex].stepY  = (int32_t)dx;
+        pOutEdges[edgeIndex].offset = ( dy * p.x - dx * p.y + bias ) >> SubPixelBits;
+    }
 
-                        const int outputBitMaskPopCnt = __popcnt(outputBitMask);
-                        const int outputMaskLUTIndex = outputBitMaskPopCnt;
-                        const int shuffleBitMaskLUTIndex = outputBitMask;
-                        RuntimeAssert(outputMaskLUTIndex < 9);
-                        RuntimeAssert(shuffleBitMaskLUTIndex < 256);
+    const vector2i_t v0 = pFixedPointVertexPositions[0];
+    const vector2i_t v1 = pFixedPointVertexPositions[1];
+    const vector2i_t v2 = pFixedPointVertexPositions[2];
+    return ((int64_t)v1.x - v2.x) * ((int64_t)v0.y - v2.y) - ((int64_t)v1.y - v2.y) * ((int64_t)v0.x - v2.x);
+}
 
-                        const __m256i outputMask = _mm256_load_si256((const __m256i*)(OutputBitMaskLUT8x[outputMaskLUTIndex]));
-                        const uint32_t blendMask = ShuffleBitMaskLUT8x[shuffleBitMaskLUTIndex];
+internal inline int64_t _k15_evaluate_raster_edge(const raster_edge_t* pEdge, uint32_t x, uint32_t y)
+{
+    return (int64_t)pEdge->stepX * x + (int64_t)pEdge->stepY * y + pEdge->offset;
+}
 
-                        const __m256i blendMaskShift = _mm256_set_epi32( 0, 3, 6, 9, 12, 15, 18, 21 );
-                        const __m256i blendMaskWide = _mm256_and_si256(_mm256_srav_epi32(_mm256_set1_epi32(blendMask), blendMaskShift), _mm256_set1_epi32(0b111));
+//FK: Evaluates the edge functions for the first row of the raster block at (blockX, blockY).
+//    Blocks of triangles that span large parts of the guard band can have edge function values that don't fit into 32 bit.
+//    An edge that crosses the block has values close to 0 (within 16 steps), so only edges that are outside (the block
+//    gets rejected by _k15_classify_raster_block) or inside of the whole block can be that large.
+internal void _k15_setup_raster_block_edges(raster_block_edges_t* pOutBlockEdges, const raster_edge_t* pEdges, const __m256i* pEdgeLaneOffsetsWide, uint32_t blockX, uint32_t blockY, float edgeToBarycentricScale)
+{
+    int64_t edgeBiases[3];
+    for( uint32_t edgeIndex = 0u; edgeIndex < 3u; ++edgeIndex )
+    {
+        //FK: Quads rasterize one row past the block, RasterBlockSize + 1 rows are covered.
+        const raster_edge_t* pEdge = pEdges + edgeIndex;
+        const int64_t originValue   = _k15_evaluate_raster_edge(pEdge, blockX, blockY);
+        const int64_t deltaX        = (int64_t)pEdge->stepX * ( RasterBlockSize - 1u );
+        const int64_t deltaY        = (int64_t)pEdge->stepY * RasterBlockSize;
+        const int64_t minValue      = originValue + (get_min(deltaX, 0)) + (get_min(deltaY, 0));
+        const int64_t maxValue      = originValue + (get_max(deltaX, 0)) + (get_max(deltaY, 0));
+
+        edgeBiases[edgeIndex] = 0;
+        if( minValue < INT_MIN || maxValue > INT_MAX )
+        {
+            RuntimeAssert(minValue >= 0);
+            edgeBiases[edgeIndex] = originValue;
+        }
 
-                        const __m256 uWideShuffled = _mm256_permutevar8x32_ps(uWide, blendMaskWide);
-                        const __m256 vWideShuffled = _mm256_permutevar8x32_ps(vWide, blendMaskWide);
-                        const __m256i pixelCoordinatesXShuffled = _mm256_cvtps_epi32(_mm256_permutevar8x32_ps(pixelCoordinatesXWide, blendMaskWide));
+        pOutBlockEdges->rowValues[edgeIndex]        = _mm256_add_epi32(_mm256_set1_epi32((int32_t)( originValue - edgeBiases[edgeIndex] )), pEdgeLaneOffsetsWide[edgeIndex]);
+        pOutBlockEdges->insideTestMasks[edgeIndex]  = _mm256_set1_epi32(edgeBiases[edgeIndex] == 0 ? -1 : 0);
+    }
 
-                        _mm256_maskstore_epi32((int*)(pixelShaderInput.pScreenspaceX + pixelIndex), outputMask, pixelCoordinatesXShuffled);
-                        _mm256_maskstore_epi32((int*)(pixelShaderInput.pScreenspaceY + pixelIndex), outputMask, _mm256_set1_epi32(tileY));
-                        _mm256_maskstore_ps((barycentricCoordinates.pU + pixelIndex), outputMask, uWideShuffled);
-                        _mm256_maskstore_ps((barycentricCoordinates.pV + pixelIndex), outputMask, vWideShuffled);
+    pOutBlockEdges->barycentricBiases[0] = _mm256_set1_ps((float)( (double)edgeBiases[0] * edgeToBarycentricScale ));
+    pOutBlockEdges->barycentricBiases[1] = _mm256_set1_ps((float)( (double)edgeBiases[1] * edgeToBarycentricScale ));
+}
 
-                        const uint32_t pixelAddedThisIteration = outputBitMaskPopCnt;
-                        pixelIndex += pixelAddedThisIteration;
-                    }
-                }
+//FK: As the edge functions are linear, the extrema of each edge function within the block (x1,y1) - (x2,y2) (inclusive)
+//    are at its corners. The block is fully outside if all corners are outside of one edge and fully inside
+//    if all corners are inside of all edges.
+internal raster_block_coverage_t _k15_classify_raster_block(const raster_edge_t* pEdges, uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2)
+{
+    int64_t minValues[3];
+    int64_t maxValues[3];
 
-                const uint32_t pixelCount = pixelIndex;
-                pixelIndex = 0;
+    for( uint32_t edgeIndex = 0u; edgeIndex < 3u; ++edgeIndex )
+    {
+        const raster_edge_t* pEdge = pEdges + edgeIndex;
+        const int64_t originValue   = _k15_evaluate_raster_edge(pEdge, x1, y1);
+        const int64_t deltaX        = (int64_t)pEdge->stepX * (x2 - x1);
+        const int64_t deltaY        = (int64_t)pEdge->stepY * (y2 - y1);
 
-                if( pixelCount == 0u )
-                {
-                    continue;
-                }
+        minValues[edgeIndex] = originValue + (get_min(deltaX, 0)) + (get_min(deltaY, 0));
+        maxValues[edgeIndex] = originValue + (get_max(deltaX, 0)) + (get_max(deltaY, 0));
 
-                _k15_generate_barycentric_vertices(&pixelShaderInput, barycentricCoordinates, pixelCount, pTriangle->vertices);
-                pixelShader(&pixelShaderInput, &pixelShaderOutput, pixelCount, pUniformData);
-                _k15_reset_stack_allocator(pixelShaderInput.pStackAllocator);
-                _k15_write_color_to_color_buffer(&pixelShaderOutput, pixelCount, pColorBufferContent, colorBufferStride, redShift, greenShift, blueShift);
-            }
+        if( maxValues[edgeIndex] < 0 )
+        {
+            return raster_block_coverage_t::outside;
         }
     }
+
+    if( minValues[0] >= 0 && minValues[1] >= 0 && minValues[2] >= 0 )
+    {
+        return raster_block_coverage_t::inside;
+    }
+
+    return raster_block_coverage_t::partial;
 }
 
-internal void _k15_convert_depth_buffer_to_color_buffer(const void* pDepthBuffer, void* pColorBuffer, uint32_t backbufferWidth, uint32_t backbufferHeight, uint32_t colorBufferStride, uint32_t depthBufferStride, uint8_t redShift, uint8_t greenShift, uint8_t blueShift)
+//FK: Farthest depth of all hi-z blocks that overlap the pixels (x1,y1) - (x2,y2) (exclusive).
+internal float _k15_get_hi_z_min_depth(const hi_z_entry_t* pHiZBuffer, uint32_t hiZBufferStride, uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2)
 {
-    uint32_t* restrict_modifier pColorBufferContent = (uint32_t* restrict_modifier)pColorBuffer;
-    const float* restrict_modifier pDepthBufferContent = (const float* restrict_modifier)pDepthBuffer;
-
-    const __m256i redShiftWide   = _mm256_set1_epi32(redShift);
-    const __m256i greenShiftWide = _mm256_set1_epi32(greenShift);
-    const __m256i blueShiftWide  = _mm256_set1_epi32(blueShift);
+    const uint32_t blockX1 = x1 / RasterBlockSize;
+    const uint32_t blockY1 = y1 / RasterBlockSize;
+    const uint32_t blockX2 = ( x2 - 1u ) / RasterBlockSize;
+    const uint32_t blockY2 = ( y2 - 1u ) / RasterBlockSize;
 
-    for(uint32_t y = 0u; y < backbufferHeight; ++y)
+    float minDepth = pHiZBuffer[blockX1 + blockY1 * hiZBufferStride].minDepth;
+    for( uint32_t blockY = blockY1; blockY <= blockY2; ++blockY )
     {
-        for(uint32_t x = 0u; x < backbufferWidth; x += 8u)
+        for( uint32_t blockX = blockX1; blockX <= blockX2; ++blockX )
         {
-            const __m256 depth = _mm256_mul_ps(_mm256_load_ps(pDepthBufferContent + x + y * depthBufferStride),  _mm256_set1_ps(255.f));
-            const __m256i depthInteger = _mm256_cvtps_epi32(depth);
-
-            __m256i colorDepth = _mm256_or_si256(depthInteger, _mm256_sllv_epi32(depthInteger, redShiftWide));
-            colorDepth = _mm256_or_si256(colorDepth, _mm256_sllv_epi32(depthInteger, greenShiftWide));
-            colorDepth = _mm256_or_si256(colorDepth, _mm256_sllv_epi32(depthInteger, blueShiftWide));
-
-            _mm256_store_si256((__m256i*)(pColorBufferContent + x + y * colorBufferStride), colorDepth);
+            minDepth = get_min(minDepth, pHiZBuffer[blockX + blockY * hiZBufferStride].minDepth);
         }
     }
+
+    return minDepth;
 }
 
-//https://graphics.stanford.edu/~seander/bithacks.html#DetermineIfPowerOf2
-internal inline bool _k15_is_pow2(uint32_t value)
+//FK: A triangle can't pass the depth test anywhere in a block if even its nearest depth is behind the block's farthest depth.
+//    Equal depth is not occluded to keep the depth test of the color pass after a depth prepass intact.
+internal inline bool _k15_is_occluded_by_hi_z(float triangleMaxDepth, float hiZMinDepth)
 {
-    return (value & (value - 1)) == 0;
+    return triangleMaxDepth + HiZDepthEpsilon < hiZMinDepth;
 }
 
-//https://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2
-internal inline uint32_t _k15_get_next_pow2(uint32_t value)
+//FK: Recalculates the depth range of the hi-z block starting at pDepthBufferBlock, has to be called after depth values of the block got written.
+//    rowCount/columnCount are less than RasterBlockSize for blocks at the bottom/right edge of the back buffer. Columns past the
+//    right edge don't get loaded, they could be padding or belong to memory the caller placed after the depth buffer rows.
+internal void _k15_update_hi_z_entry(hi_z_entry_t* pHiZEntry, const float* pDepthBufferBlock, uint32_t depthBufferStride, uint32_t rowCount, uint32_t columnCount)
 {
-    if(_k15_is_pow2(value))
+    static_assert(RasterBlockSize == 8u, "Hi-z update expects one raster span per block row");
+
+    const __m256i columnMask = _mm256_cmpgt_epi32(_mm256_set1_epi32((int32_t)columnCount), _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+
+    //FK: Masked out columns get neutral values so that they don't change the min/max depth
+    __m256 minDepthWide = _mm256_set1_ps(FLT_MAX);
+    __m256 maxDepthWide = _mm256_set1_ps(-FLT_MAX);
+    for( uint32_t rowIndex = 0u; rowIndex < rowCount; ++rowIndex )
     {
-        ++value;
+        const float* pDepthBufferRow = pDepthBufferBlock + rowIndex * depthBufferStride;
+        if( columnCount == RasterBlockSize )
+        {
+            const __m256 depthWide = _mm256_load_ps(pDepthBufferRow);
+            minDepthWide = _mm256_min_ps(minDepthWide, depthWide);
+            maxDepthWide = _mm256_max_ps(maxDepthWide, depthWide);
+        }
+        else
+        {
+            const __m256 depthWide = _mm256_maskload_ps(pDepthBufferRow, columnMask);
+            minDepthWide = _mm256_min_ps(minDepthWide, _mm256_blendv_ps(_mm256_set1_ps(FLT_MAX), depthWide, _mm256_castsi256_ps(columnMask)));
+            maxDepthWide = _mm256_max_ps(maxDepthWide, _mm256_blendv_ps(_mm256_set1_ps(-FLT_MAX), depthWide, _mm256_castsi256_ps(columnMask)));
+        }
     }
 
-    value--;
-    value |= value >> 1;
-    value |= value >> 2;
-    value |= value >> 4;
-    value |= value >> 8;
-    value |= value >> 16;
-    value++;
+    __m128 minDepth = _mm_min_ps(_mm256_castps256_ps128(minDepthWide), _mm256_extractf128_ps(minDepthWide, 1));
+    __m128 maxDepth = _mm_max_ps(_mm256_castps256_ps128(maxDepthWide), _mm256_extractf128_ps(maxDepthWide, 1));
+    minDepth = _mm_min_ps(minDepth, _mm_movehl_ps(minDepth, minDepth));
+    maxDepth = _mm_max_ps(maxDepth, _mm_movehl_ps(maxDepth, maxDepth));
+    minDepth = _mm_min_ss(minDepth, _mm_shuffle_ps(minDepth, minDepth, 1));
+    maxDepth = _mm_max_ss(maxDepth, _mm_shuffle_ps(maxDepth, maxDepth, 1));
 
-    return value;
+    pHiZEntry->minDepth = _mm_cvtss_f32(minDepth);
+    pHiZEntry->maxDepth = _mm_cvtss_f32(maxDepth);
 }
 
-bool _k15_create_font(bitmap_font_t* pOutFont)
+//FK: Nearest depth value the triangle can produce.
+internal inline float _k15_get_triangle_max_depth(const screenspace_triangle_t* pTriangle)
 {
-    const size_t bitmapSizeInBytes = imageSizeX * imageSizeY * imageChannelCount;
-    pOutFont->pRGBPixels = pImageData;
-    pOutFont->height = imageSizeX;
-    pOutFont->width = imageSizeY;
-    pOutFont->channels = imageChannelCount;
-    return true;
+    const float minZ = get_min(pTriangle->screenspaceVertexPositions[0].z, (get_min(pTriangle->screenspaceVertexPositions[1].z, pTriangle->screenspaceVertexPositions[2].z)));
+    return 1.0f - minZ;
 }
 
-software_rasterizer_context_init_parameters_t k15_create_default_software_rasterizer_context_parameters(uint32_t screenWidth, uint32_t screenHeight, void** pColorBuffers, void** pDepthBuffers, uint32_t colorBufferCount)
+//FK: Farthest depth value the triangle can produce.
+internal inline float _k15_get_triangle_min_depth(const screenspace_triangle_t* pTriangle)
 {
-    software_rasterizer_context_init_parameters_t defaultParameters = {};
-    defaultParameters.backBufferHeight  = screenHeight;
-    defaultParameters.backBufferWidth   = screenWidth;
-    defaultParameters.colorBufferStride = screenWidth;
-    defaultParameters.depthBufferStride = screenWidth;
-    defaultParameters.blueShift         = 16;
-    defaultParameters.greenShift        = 8;
-    defaultParameters.redShift          = 0;
-    defaultParameters.pColorBuffers[0]  = pColorBuffers[0];
-    defaultParameters.pDepthBuffers[0]  = pDepthBuffers[0];
-    defaultParameters.pColorBuffers[1]  = pColorBuffers[1];
-    defaultParameters.pDepthBuffers[1]  = pDepthBuffers[1];
-    defaultParameters.pColorBuffers[2]  = pColorBuffers[2];
-    defaultParameters.pDepthBuffers[2]  = pDepthBuffers[2];
-    defaultParameters.colorBufferCount  = colorBufferCount;
-
-    return defaultParameters;
+    const float maxZ = get_max(pTriangle->screenspaceVertexPositions[0].z, (get_max(pTriangle->screenspaceVertexPositions[1].z, pTriangle->screenspaceVertexPositions[2].z)));
+    return 1.0f - maxZ;
 }
 
-bool _k15_create_pixel_shader_output_buffers(pixel_shader_output_t* pPixelShaderOutput, uint32_t outputCount)
+//FK: The bounding box of triangles in the guard band got clamped to the screen, it can be small even though the triangle isn't.
+internal inline bool _k15_has_small_triangle_extent(const screenspace_triangle_t* pTriangle)
 {
-    pPixelShaderOutput->pColor = (vector4f_t*)malloc(outputCount * sizeof(vector4f_t));
-    if( pPixelShaderOutput->pColor == nullptr )
-    {
-        return false;
-    }
-
-    return true;
+    const vector2i_t* pPositions = pTriangle->fixedPointVertexPositions;
+    const int32_t width = get_max(pPositions[0].x, (get_max(pPositions[1].x, pPositions[2].x))) - get_min(pPositions[0].x, (get_min(pPositions[1].x, pPositions[2].x)));
+    const int32_t height = get_max(pPositions[0].y, (get_max(pPositions[1].y, pPositions[2].y))) - get_min(pPositions[0].y, (get_min(pPositions[1].y, pPositions[2].y)));
+    return width <= (int32_t)( SmallTriangleMaxSize << SubPixelBits ) && height <= (int32_t)( SmallTriangleMaxSize << SubPixelBits );
 }
 
-bool _k15_create_pixel_shader_input_buffers(pixel_shader_input_t* pPixelShaderInput, uint32_t inputCount)
+//FK: Rasterizes up to SmallTriangleBatchSize triangles of the same draw call whose bounding boxes fit into
+//    SmallTriangleMaxSize x SmallTriangleMaxSize pixels. Edge setup is done for all triangles at once (one triangle per lane),
+//    covered pixels get appended to the shading context's pixel batch so that they share one pixel shader invocation.
+//    Results are identical to _k15_draw_triangles_8_step.
+template<raster_pass_t RASTER_PASS = raster_pass_t::depth_and_color>
+internal void _k15_draw_small_triangles(const screen_tile_t* pScreenTile, const screenspace_triangle_t* pScreenspaceTriangles, const raster_draw_call_t* pDrawCall, const uint32_t* pTriangleIndices, uint32_t triangleCount, shading_context_t* pShadingContext, void* pColorBuffer, void* pDepthBuffer, hi_z_entry_t* pHiZBuffer, uint32_t colorBufferStride, uint32_t depthBufferStride, uint32_t hiZBufferStride, uint8_t redShift, uint8_t greenShift, uint8_t blueShift)
 {
-    pPixelShaderInput->pDepth = (float*)malloc(inputCount * sizeof(float));
-    if( pPixelShaderInput->pDepth == nullptr )
-    {
-        return false;
-    }
+    RuntimeAssert(triangleCount <= SmallTriangleBatchSize);
 
-    pPixelShaderInput->pScreenspaceX = (uint32_t*)malloc(inputCount * sizeof(uint32_t));
-    if( pPixelShaderInput->pScreenspaceX == nullptr )
-    {
-        return false;
-    }
+    uint32_t* restrict_modifier pColorBufferContent = (uint32_t* restrict_modifier)pColorBuffer;
+    float* restrict_modifier pDepthBufferContent = (float* restrict_modifier)pDepthBuffer;
+    pixel_batch_t* pPixelBatch = &pShadingContext->pixelBatch;
 
-    pPixelShaderInput->pScreenspaceY = (uint32_t*)malloc(inputCount * sizeof(uint32_t));
-    if( pPixelShaderInput->pScreenspaceY == nullptr )
-    {
-        return false;
-    }
+    //FK: After a depth prepass only the pixels that ended up in the depth buffer pass the depth test.
+    constexpr int depthCompareOperation = RASTER_PASS == raster_pass_t::color_equal_depth ? _CMP_EQ_OQ : _CMP_GT_OQ;
 
-    pPixelShaderInput->pVertexData = (vertex_t*)malloc(inputCount * sizeof(vertex_t));
-    if( pPixelShaderInput->pVertexData == nullptr )
+    //FK: Vertex positions are relative to the bounding box origin of their triangle so that all edge setup values fit into 32 bit.
+    //    Unused lanes get degenerated triangles.
+    alignas(32) int32_t vertexPositionsX[3][SmallTriangleBatchSize] = {};
+    alignas(32) int32_t vertexPositionsY[3][SmallTriangleBatchSize] = {};
+    for( uint32_t triangleIndex = 0u; triangleIndex < triangleCount; ++triangleIndex )
+    {
+        const screenspace_triangle_t* pTriangle = pScreenspaceTriangles + pTriangleIndices[triangleIndex];
+        const int32_t originX = (int32_t)( pTriangle->boundingBox.x1 << SubPixelBits );
+        const int32_t originY = (int32_t)( pTriangle->boundingBox.y1 << SubPixelBits );
+        for( uint32_t vertexIndex = 0u; vertexIndex < 3u; ++vertexIndex )
+        {
+            vertexPositionsX[vertexIndex][triangleIndex] = pTriangle->fixedPointVertexPositions[vertexIndex].x - originX;
+            vertexPositionsY[vertexIndex][triangleIndex] = pTriangle->fixedPointVertexPositions[vertexIndex].y - originY;
+        }
+    }
+
+    const __m256i vertexPositionsXWide[3] = {
+        _mm256_load_si256((const __m256i*)vertexPositionsX[0]),
+        _mm256_load_si256((const __m256i*)vertexPositionsX[1]),
+        _mm256_load_si256((const __m256i*)vertexPositionsX[2])
+    };
+
+    const __m256i vertexPositionsYWide[3] = {
+        _mm256_load_si256((const __m256i*)vertexPositionsY[0]),
+        _mm256_load_si256((const __m256i*)vertexPositionsY[1]),
+        _mm256_load_si256((const __m256i*)vertexPositionsY[2])
+    };
+
+    //FK: Same setup as _k15_setup_raster_edges, the origin value is the edge function value at the bounding box origin.
+    constexpr uint32_t edgeVertexIndices[3][2] = {
+        {1u, 0u}, {2u, 1u}, {0u, 2u}
+    };
+
+    alignas(32) int32_t edgeStepX[3][SmallTriangleBatchSize];
+    alignas(32) int32_t edgeStepY[3][SmallTriangleBatchSize];
+    alignas(32) int32_t edgeOriginValues[3][SmallTriangleBatchSize];
+
+    for( uint32_t edgeIndex = 0u; edgeIndex < 3u; ++edgeIndex )
+    {
+        const __m256i px = vertexPositionsXWide[edgeVertexIndices[edgeIndex][0]];
+        const __m256i py = vertexPositionsYWide[edgeVertexIndices[edgeIndex][0]];
+        const __m256i dx = _mm256_sub_epi32(vertexPositionsXWide[edgeVertexIndices[edgeIndex][1]], px);
+        const __m256i dy = _mm256_sub_epi32(vertexPositionsYWide[edgeVertexIndices[edgeIndex][1]], py);
+
+        const __m256i isTopLeftEdge = _mm256_or_si256(_mm256_cmpgt_epi32(_mm256_setzero_si256(), dy), _mm256_and_si256(_mm256_cmpeq_epi32(dy, _mm256_setzero_si256()), _mm256_cmpgt_epi32(dx, _mm256_setzero_si256())));
+        const __m256i bias = _mm256_andnot_si256(isTopLeftEdge, _mm256_set1_epi32(-1));
+        const __m256i c = _mm256_add_epi32(_mm256_sub_epi32(_mm256_mullo_epi32(dy, px), _mm256_mullo_epi32(dx, py)), bias);
+
+        _mm256_store_si256((__m256i*)edgeStepX[edgeIndex], _mm256_sub_epi32(_mm256_setzero_si256(), dy));
+        _mm256_store_si256((__m256i*)edgeStepY[edgeIndex], dx);
+        _mm256_store_si256((__m256i*)edgeOriginValues[edgeIndex], _mm256_srai_epi32(c, SubPixelBits));
+    }
+
+    const __m256i triangleAreaWide = _mm256_sub_epi32(
+        _mm256_mullo_epi32(_mm256_sub_epi32(vertexPositionsXWide[1], vertexPositionsXWide[2]), _mm256_sub_epi32(vertexPositionsYWide[0], vertexPositionsYWide[2])),
+        _mm256_mullo_epi32(_mm256_sub_epi32(vertexPositionsYWide[1], vertexPositionsYWide[2]), _mm256_sub_epi32(vertexPositionsXWide[0], vertexPositionsXWide[2])));
+
+    alignas(32) int32_t triangleAreas[SmallTriangleBatchSize];
+    alignas(32) float edgeToBarycentricScales[SmallTriangleBatchSize];
+    _mm256_store_si256((__m256i*)triangleAreas, triangleAreaWide);
+    _mm256_store_ps(edgeToBarycentricScales, _mm256_div_ps(_mm256_set1_ps(SubPixelScale), _mm256_cvtepi32_ps(triangleAreaWide)));
+
+    const __m256i laneIndices = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+
+    for( uint32_t triangleIndex = 0u; triangleIndex < triangleCount; ++triangleIndex )
+    {
+        if( triangleAreas[triangleIndex] <= 0 )
+        {
+            continue;
+        }
+
+        const screenspace_triangle_t* pTriangle = pScreenspaceTriangles + pTriangleIndices[triangleIndex];
+        const bounding_box_t triangleBoundingBox = pTriangle->boundingBox;
+
+        //FK: Triangles can overlap multiple screen tiles, only the part inside this tile gets rasterized.
+        const uint32_t x1 = get_max(triangleBoundingBox.x1, pScreenTile->boundingBox.x1);
+        const uint32_t x2 = get_min(triangleBoundingBox.x2, pScreenTile->boundingBox.x2);
+        const uint32_t y1 = get_max(triangleBoundingBox.y1, pScreenTile->boundingBox.y1);
+        const uint32_t y2 = get_min(triangleBoundingBox.y2, pScreenTile->boundingBox.y2);
+        if( x1 >= x2 || y1 >= y2 )
+        {
+            continue;
+        }
+
+        if( _k15_is_occluded_by_hi_z(_k15_get_triangle_max_depth(pTriangle), _k15_get_hi_z_min_depth(pHiZBuffer, hiZBufferStride, x1, y1, x2, y2)) )
+        {
+            continue;
+        }
+
+        if( RASTER_PASS != raster_pass_t::depth_only )
+        {
+            _k15_reserve_pixel_batch(pShadingContext, pDrawCall, SmallTriangleMaxSize * SmallTriangleMaxSize, pColorBufferContent, colorBufferStride, redShift, greenShift, blueShift);
+        }
+
+        const __m256i pixelCoordinatesXWide = _mm256_add_epi32(_mm256_set1_epi32(triangleBoundingBox.x1), laneIndices);
+        const __m256i laneMask = _mm256_and_si256(_mm256_cmpgt_epi32(pixelCoordinatesXWide, _mm256_set1_epi32(x1 - 1)), _mm256_cmpgt_epi32(_mm256_set1_epi32(x2), pixelCoordinatesXWide));
+
+        const uint32_t rowOffset = y1 - triangleBoundingBox.y1;
+        __m256i edgeRowWide[3];
+        __m256i edgeRowStepWide[3];
+        for( uint32_t edgeIndex = 0u; edgeIndex < 3u; ++edgeIndex )
+        {
+            const int32_t stepX = edgeStepX[edgeIndex][triangleIndex];
+            const int32_t stepY = edgeStepY[edgeIndex][triangleIndex];
+            const int32_t rowStartValue = edgeOriginValues[edgeIndex][triangleIndex] + stepY * (int32_t)rowOffset;
+            edgeRowWide[edgeIndex]      = _mm256_add_epi32(_mm256_set1_epi32(rowStartValue), _mm256_mullo_epi32(_mm256_set1_epi32(stepX), laneIndices));
+            edgeRowStepWide[edgeIndex]  = _mm256_set1_epi32(stepY);
+        }
+
+        const float edgeToBarycentricScale = edgeToBarycentricScales[triangleIndex];
+        const vector3f_t v0 = pTriangle->screenspaceVertexPositions[0];
+        const vector3f_t v1 = pTriangle->screenspaceVertexPositions[1];
+        const vector3f_t v2 = pTriangle->screenspaceVertexPositions[2];
+
+        uint32_t pixelIndex = pPixelBatch->pixelCount;
+        bool depthWritten = false;
+        for( uint32_t y = y1; y < y2; ++y )
+        {
+            const __m256i w0Wide = edgeRowWide[0];
+            const __m256i w1Wide = edgeRowWide[1];
+            const __m256i w2Wide = edgeRowWide[2];
+            edgeRowWide[0] = _mm256_add_epi32(edgeRowWide[0], edgeRowStepWide[0]);
+            edgeRowWide[1] = _mm256_add_epi32(edgeRowWide[1], edgeRowStepWide[1]);
+            edgeRowWide[2] = _mm256_add_epi32(edgeRowWide[2], edgeRowStepWide[2]);
+
+            const __m256i edgeSigns = _mm256_or_si256(_mm256_or_si256(w0Wide, w1Wide), w2Wide);
+            const __m256i pixelMask = _mm256_and_si256(laneMask, _mm256_cmpgt_epi32(edgeSigns, _mm256_set1_epi32(-1)));
+            if( _mm256_movemask_epi8(pixelMask) == 0 )
+            {
+                continue;
+            }
+
+            const __m256 uWide = _mm256_mul_ps(_mm256_cvtepi32_ps(w0Wide), _mm256_broadcast_ss(&edgeToBarycentricScale));
+            const __m256 vWide = _mm256_mul_ps(_mm256_cvtepi32_ps(w1Wide), _mm256_broadcast_ss(&edgeToBarycentricScale));
+            const __m256 wWide = _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_add_ps(uWide, vWide));
+
+            //FK: Spans of small triangles aren't aligned, masked loads make sure not to read outside of the depth buffer.
+            float* pDepthBufferSpan = pDepthBufferContent + triangleBoundingBox.x1 + y * depthBufferStride;
+            const __m256 newDepthBufferZ = _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_fmadd_ps(_mm256_broadcast_ss(&v0.z), uWide, _mm256_fmadd_ps(_mm256_broadcast_ss(&v1.z), vWide, _mm256_mul_ps(_mm256_broadcast_ss(&v2.z), wWide))));
+            const __m256 oldDepthBufferZ = _mm256_maskload_ps(pDepthBufferSpan, pixelMask);
+
+            __m256i depthBufferMask = _mm256_castps_si256(_mm256_cmp_ps(newDepthBufferZ, oldDepthBufferZ, depthCompareOperation));
+            depthBufferMask = _mm256_and_si256(depthBufferMask, pixelMask);
+            if( _mm256_movemask_epi8(depthBufferMask) == 0 )
+            {
+                continue;
+            }
+
+            if( RASTER_PASS != raster_pass_t::color_equal_depth )
+            {
+                _mm256_maskstore_ps(pDepthBufferSpan, depthBufferMask, newDepthBufferZ);
+                depthWritten = true;
+            }
+
+            if( RASTER_PASS == raster_pass_t::depth_only )
+            {
+                continue;
+            }
+
+            pixelIndex += _k15_append_pixels(pShadingContext, pixelIndex, depthBufferMask, uWide, vWide, pixelCoordinatesXWide, y);
+        }
+
+        if( depthWritten )
+        {
+            //FK: Small triangles touch at most 2x2 hi-z blocks
+            for( uint32_t blockY = y1 & ~0x7u; blockY < y2; blockY += RasterBlockSize )
+            {
+                const uint32_t rowCount = get_min(RasterBlockSize, pScreenTile->boundingBox.y2 - blockY);
+                for( uint32_t blockX = x1 & ~0x7u; blockX < x2; blockX += RasterBlockSize )
+                {
+                    const uint32_t columnCount = get_min(RasterBlockSize, pScreenTile->boundingBox.x2 - blockX);
+                    hi_z_entry_t* pHiZEntry = pHiZBuffer + blockX / RasterBlockSize + ( blockY / RasterBlockSize ) * hiZBufferStride;
+                    _k15_update_hi_z_entry(pHiZEntry, pDepthBufferContent + blockX + blockY * depthBufferStride, depthBufferStride, rowCount, columnCount);
+                }
+            }
+        }
+
+        if( RASTER_PASS != raster_pass_t::depth_only )
+        {
+            _k15_commit_pixel_batch_run(pPixelBatch, pTriangle, pixelIndex);
+        }
+    }
+}
+
+//FK: Quad shading version of the span loop of _k15_draw_triangles_8_step. Rows of the raster block get rasterized in pairs
+//    so that covered pixels can be appended as 2x2 quads, the pixels of a quad that are not covered or fail the depth test
+//    get appended as helper pixels. Returns the new pixel index of the pixel batch.
+template<raster_pass_t RASTER_PASS>
+internal uint32_t _k15_draw_raster_block_quads(shading_context_t* pShadingContext, uint32_t pixelIndex, const raster_block_edges_t* pBlockEdges, const __m256i* pEdgeRowStepWide, uint32_t blockX, uint32_t blockY, uint32_t blockYEnd, __m256i blockColumnMask, bool blockFullyCovered, bool blockDepthTestPasses, float edgeToBarycentricScale, const vector3f_t* pVertexPositions, float* pDepthBufferContent, uint32_t depthBufferStride, bool* pOutDepthWritten)
+{
+    static_assert(RasterBlockSize == 8u, "Quad shading expects one raster span per block row");
+
+    //FK: After a depth prepass only the pixels that ended up in the depth buffer pass the depth test.
+    constexpr int depthCompareOperation = RASTER_PASS == raster_pass_t::color_equal_depth ? _CMP_EQ_OQ : _CMP_GT_OQ;
+
+    const __m256i pixelCoordinatesXWide = _mm256_add_epi32(_mm256_set1_epi32(blockX), _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+    __m256i edgeRowWide[3] = { pBlockEdges->rowValues[0], pBlockEdges->rowValues[1], pBlockEdges->rowValues[2] };
+
+    for( uint32_t tileY = blockY; tileY < blockYEnd; tileY += 2u )
+    {
+        __m256i rowMasks[2];
+        __m256 rowU[2];
+        __m256 rowV[2];
+        for( uint32_t rowIndex = 0u; rowIndex < 2u; ++rowIndex )
+        {
+            const uint32_t rowY = tileY + rowIndex;
+            const __m256i w0Wide = edgeRowWide[0];
+            const __m256i w1Wide = edgeRowWide[1];
+            const __m256i w2Wide = edgeRowWide[2];
+            edgeRowWide[0] = _mm256_add_epi32(edgeRowWide[0], pEdgeRowStepWide[0]);
+            edgeRowWide[1] = _mm256_add_epi32(edgeRowWide[1], pEdgeRowStepWide[1]);
+            edgeRowWide[2] = _mm256_add_epi32(edgeRowWide[2], pEdgeRowStepWide[2]);
+
+            //FK: Barycentric coordinates of uncovered pixels are needed as well, helper pixels get extrapolated attributes.
+            rowU[rowIndex] = _mm256_fmadd_ps(_mm256_cvtepi32_ps(w0Wide), _mm256_broadcast_ss(&edgeToBarycentricScale), pBlockEdges->barycentricBiases[0]);
+            rowV[rowIndex] = _mm256_fmadd_ps(_mm256_cvtepi32_ps(w1Wide), _mm256_broadcast_ss(&edgeToBarycentricScale), pBlockEdges->barycentricBiases[1]);
+            rowMasks[rowIndex] = _mm256_setzero_si256();
+
+            //FK: The second row of the last quad can be below the block (odd block height)
+            if( rowY >= blockYEnd )
+            {
+                continue;
+            }
+
+            __m256i pixelMask = _mm256_set1_epi32(-1);
+            if( !blockFullyCovered )
+            {
+                const __m256i edgeSigns = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(w0Wide, pBlockEdges->insideTestMasks[0]), _mm256_and_si256(w1Wide, pBlockEdges->insideTestMasks[1])), _mm256_and_si256(w2Wide, pBlockEdges->insideTestMasks[2]));
+                pixelMask = _mm256_and_si256(blockColumnMask, _mm256_cmpgt_epi32(edgeSigns, _mm256_set1_epi32(-1)));
+                if( _mm256_movemask_epi8(pixelMask) == 0 )
+                {
+                    continue;
+                }
+            }
+
+            const __m256 uWide = rowU[rowIndex];
+            const __m256 vWide = rowV[rowIndex];
+            const __m256 wWide = _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_add_ps(uWide, vWide));
+            const __m256 newDepthBufferZ = _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_fmadd_ps(_mm256_broadcast_ss(&pVertexPositions[0].z), uWide, _mm256_fmadd_ps(_mm256_broadcast_ss(&pVertexPositions[1].z), vWide, _mm256_mul_ps(_mm256_broadcast_ss(&pVertexPositions[2].z), wWide))));
+
+            const uint32_t depthBufferOffset = blockX + rowY * depthBufferStride;
+            __m256i depthBufferMask = pixelMask;
+            if( !blockDepthTestPasses )
+            {
+                const __m256 oldDepthBufferZ = blockFullyCovered ? _mm256_load_ps(pDepthBufferContent + depthBufferOffset) : _mm256_maskload_ps(pDepthBufferContent + depthBufferOffset, pixelMask);
+                depthBufferMask = _mm256_castps_si256(_mm256_cmp_ps(newDepthBufferZ, oldDepthBufferZ, depthCompareOperation));
+                depthBufferMask = _mm256_and_si256(depthBufferMask, pixelMask);
+                if( _mm256_movemask_epi8(depthBufferMask) == 0 )
+                {
+                    continue;
+                }
+            }
+
+            if( RASTER_PASS != raster_pass_t::color_equal_depth )
+            {
+                _mm256_maskstore_ps(pDepthBufferContent + depthBufferOffset, depthBufferMask, newDepthBufferZ);
+                *pOutDepthWritten = true;
+            }
+
+            rowMasks[rowIndex] = depthBufferMask;
+        }
+
+        pixelIndex += _k15_append_quads(pShadingContext, pixelIndex, rowMasks, rowU, rowV, pixelCoordinatesXWide, tileY);
+    }
+
+    return pixelIndex;
+}
+
+template<raster_pass_t RASTER_PASS = raster_pass_t::depth_and_color>
+internal void _k15_draw_triangles_8_step(const screen_tile_t* pScreenTile, const screenspace_triangle_t* pScreenspaceTriangles, const raster_draw_call_t* pDrawCalls, shading_context_t* pShadingContext, void* pColorBuffer, void* pDepthBuffer, hi_z_entry_t* pHiZBuffer, uint32_t colorBufferStride, uint32_t depthBufferStride, uint32_t hiZBufferStride, uint8_t redShift, uint8_t greenShift, uint8_t blueShift)
+{
+    uint32_t* restrict_modifier pColorBufferContent = (uint32_t* restrict_modifier)pColorBuffer;
+    float* restrict_modifier pDepthBufferContent = (float* restrict_modifier)pDepthBuffer;
+
+    const __m256i laneIndices = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+
+    pixel_batch_t* pPixelBatch = &pShadingContext->pixelBatch;
+
+    //FK: After a depth prepass only the pixels that ended up in the depth buffer pass the depth test.
+    constexpr int depthCompareOperation = RASTER_PASS == raster_pass_t::color_equal_depth ? _CMP_EQ_OQ : _CMP_GT_OQ;
+
+    //FK: Small triangles get collected and rasterized together, all covered pixels go to the
+    //    pixel batch which gets shaded once it's full, the draw call changes or the screen tile is done.
+    uint32_t smallTriangleIndices[SmallTriangleBatchSize];
+    uint32_t smallTriangleCount = 0u;
+    const raster_draw_call_t* pSmallTriangleDrawCall = nullptr;
+
+    for(uint32_t tileTriangleIndex = 0; tileTriangleIndex < pScreenTile->triangles.count; ++tileTriangleIndex)
+    {
+        const tile_triangle_t tileTriangle = pScreenTile->triangles.pData[tileTriangleIndex];
+        const screenspace_triangle_t* restrict_modifier pTriangle = pScreenspaceTriangles + tileTriangle.screenspaceTriangleIndex;
+        const raster_draw_call_t* pDrawCall = pDrawCalls + tileTriangle.drawCallIndex;
+
+        //FK: Quads have to start at even pixel coordinates, small triangles start their spans at their bounding box.
+        const bool shadeQuads = RASTER_PASS != raster_pass_t::depth_only && pDrawCall->quadShadingEnabled;
+
+        const bool isSmallTriangle = ( pTriangle->boundingBox.x2 - pTriangle->boundingBox.x1 ) <= SmallTriangleMaxSize && 
+                                     ( pTriangle->boundingBox.y2 - pTriangle->boundingBox.y1 ) <= SmallTriangleMaxSize &&
+                                     _k15_has_small_triangle_extent(pTriangle) && !shadeQuads;
+
+        if( smallTriangleCount > 0u && ( !isSmallTriangle || pDrawCall != pSmallTriangleDrawCall || smallTriangleCount == SmallTriangleBatchSize ) )
+        {
+            _k15_draw_small_triangles<RASTER_PASS>(pScreenTile, pScreenspaceTriangles, pSmallTriangleDrawCall, smallTriangleIndices, smallTriangleCount, pShadingContext, pColorBuffer, pDepthBuffer, pHiZBuffer, colorBufferStride, depthBufferStride, hiZBufferStride, redShift, greenShift, blueShift);
+            smallTriangleCount = 0u;
+        }
+
+        if( isSmallTriangle )
+        {
+            smallTriangleIndices[smallTriangleCount++] = tileTriangle.screenspaceTriangleIndex;
+            pSmallTriangleDrawCall = pDrawCall;
+            continue;
+        }
+
+        raster_edge_t edges[3];
+        const int64_t triangleArea = _k15_setup_raster_edges(edges, pTriangle->fixedPointVertexPositions);
+        if( triangleArea <= 0 )
+        {
+            continue;
+        }
+
+        //FK: Edge function values are in 1/256th of the triangle area's unit
+        const float edgeToBarycentricScale = SubPixelScale / (float)triangleArea;
+
+        //FK: Only rasterize the part of the triangle that is inside this tile.
+        //    Start x is aligned to 8 pixels so that spans never cross into the neighbouring tile,
+        //    start y is aligned as well so that raster blocks line up with the hi-z blocks.
+        bounding_box_t boundingBox;
+        boundingBox.x1 = (get_max(pTriangle->boundingBox.x1, pScreenTile->boundingBox.x1)) & ~0x7u;
+        boundingBox.y1 = (get_max(pTriangle->boundingBox.y1, pScreenTile->boundingBox.y1)) & ~0x7u;
+        boundingBox.x2 = get_min(pTriangle->boundingBox.x2, pScreenTile->boundingBox.x2);
+        boundingBox.y2 = get_min(pTriangle->boundingBox.y2, pScreenTile->boundingBox.y2);
+
+        const vector3f_t v0 = pTriangle->screenspaceVertexPositions[0];
+        const vector3f_t v1 = pTriangle->screenspaceVertexPositions[1];
+        const vector3f_t v2 = pTriangle->screenspaceVertexPositions[2];
+
+        const float triangleMinDepth = _k15_get_triangle_min_depth(pTriangle);
+        const float triangleMaxDepth = _k15_get_triangle_max_depth(pTriangle);
+
+        //FK: Stepping the edge functions from pixel to pixel is just an integer add.
+        const __m256i edgeLaneOffsetsWide[3] = {
+            _mm256_mullo_epi32(_mm256_set1_epi32(edges[0].stepX), laneIndices),
+            _mm256_mullo_epi32(_mm256_set1_epi32(edges[1].stepX), laneIndices),
+            _mm256_mullo_epi32(_mm256_set1_epi32(edges[2].stepX), laneIndices)
+        };
+
+        const __m256i edgeSpanStepWide[3] = {
+            _mm256_set1_epi32(edges[0].stepX * 8),
+            _mm256_set1_epi32(edges[1].stepX * 8),
+            _mm256_set1_epi32(edges[2].stepX * 8)
+        };
+
+        const __m256i edgeRowStepWide[3] = {
+            _mm256_set1_epi32(edges[0].stepY),
+            _mm256_set1_epi32(edges[1].stepY),
+            _mm256_set1_epi32(edges[2].stepY)
+        };
+
+        for(uint32_t y = boundingBox.y1; y < boundingBox.y2; y += PixelShaderTileSize)
+        {
+            MemoryPrefetchNTA(pDepthBufferContent + boundingBox.x1 + y * depthBufferStride);
+
+            const uint32_t yDelta = (boundingBox.y2 - y);
+            const uint32_t yStep = get_min(PixelShaderTileSize, yDelta);
+            const uint32_t tileYEnd = y + yStep;
+
+            for(uint32_t x = boundingBox.x1; x < boundingBox.x2; x += PixelShaderTileSize)
+            {   
+                const uint32_t xDelta = (boundingBox.x2 - x);
+                const uint32_t xStep = get_min(PixelShaderTileSize, xDelta);
+
+                //FK: Spans always cover 8 pixels, even if the bounding box ends in the middle of a span.
+                const uint32_t tileXSampleEnd = x + ( ( xStep + 7u ) & ~0x7u );
+
+                const raster_block_coverage_t tileCoverage = _k15_classify_raster_block(edges, x, y, tileXSampleEnd - 1u, tileYEnd - 1u);
+                if( tileCoverage == raster_block_coverage_t::outside )
+                {
+                    continue;
+                }
+
+                if( _k15_is_occluded_by_hi_z(triangleMaxDepth, _k15_get_hi_z_min_depth(pHiZBuffer, hiZBufferStride, x, y, tileXSampleEnd, tileYEnd)) )
+                {
+                    continue;
+                }
+
+                if( RASTER_PASS != raster_pass_t::depth_only )
+                {
+                    _k15_reserve_pixel_batch(pShadingContext, pDrawCall, PixelShaderTileSize * PixelShaderTileSize, pColorBufferContent, colorBufferStride, redShift, greenShift, blueShift);
+                }
+
+                uint32_t pixelIndex = pPixelBatch->pixelCount;
+                for( uint32_t blockY = y; blockY < tileYEnd; blockY += RasterBlockSize )
+                {
+                    const uint32_t blockYEnd = get_min(blockY + RasterBlockSize, tileYEnd);
+                    for( uint32_t blockX = x; blockX < tileXSampleEnd; blockX += RasterBlockSize )
+                    {
+                        const uint32_t blockXEnd = get_min(blockX + RasterBlockSize, tileXSampleEnd);
+
+                        hi_z_entry_t* pHiZEntry = pHiZBuffer + blockX / RasterBlockSize + ( blockY / RasterBlockSize ) * hiZBufferStride;
+                        if( _k15_is_occluded_by_hi_z(triangleMaxDepth, pHiZEntry->minDepth) )
+                        {
+                            continue;
+                        }
+
+                        //FK: Sub blocks of a fully covered tile are fully covered as well.
+                        raster_block_coverage_t blockCoverage = tileCoverage;
+                        if( blockCoverage == raster_block_coverage_t::partial )
+                        {
+                            blockCoverage = _k15_classify_raster_block(edges, blockX, blockY, blockXEnd - 1u, blockYEnd - 1u);
+                        }
+
+                        if( blockCoverage == raster_block_coverage_t::outside )
+                        {
+                            continue;
+                        }
+
+                        //FK: Triangles don't get clipped to the screen (guard band), the last block of a row can reach past
+                        //    the right edge of the back buffer if its width isn't a multiple of 8.
+                        const __m256i blockColumnMask = _mm256_cmpgt_epi32(_mm256_set1_epi32((int32_t)( pScreenTile->boundingBox.x2 - blockX )), laneIndices);
+                        const bool blockInsideScreen = blockX + RasterBlockSize <= pScreenTile->boundingBox.x2;
+                        const bool blockFullyCovered = blockCoverage == raster_block_coverage_t::inside && blockInsideScreen;
+
+                        //FK: If even the farthest depth of the triangle is in front of the block's nearest depth, every pixel passes the depth test.
+                        const bool blockDepthTestPasses = RASTER_PASS != raster_pass_t::color_equal_depth && triangleMinDepth - HiZDepthEpsilon > pHiZEntry->maxDepth;
+                        bool depthWritten = false;
+
+                        raster_block_edges_t blockEdges;
+                        _k15_setup_raster_block_edges(&blockEdges, edges, edgeLaneOffsetsWide, blockX, blockY, edgeToBarycentricScale);
+
+                        __m256i edgeRowWide[3] = { blockEdges.rowValues[0], blockEdges.rowValues[1], blockEdges.rowValues[2] };
+
+                        if( shadeQuads )
+                        {
+                            pixelIndex = _k15_draw_raster_block_quads<RASTER_PASS>(pShadingContext, pixelIndex, &blockEdges, edgeRowStepWide, blockX, blockY, blockYEnd, blockColumnMask, blockFullyCovered, blockDepthTestPasses, edgeToBarycentricScale, pTriangle->screenspaceVertexPositions, pDepthBufferContent, depthBufferStride, &depthWritten);
+                        }
+                        else for( uint32_t tileY = blockY; tileY < blockYEnd; ++tileY)
+                        {
+                            __m256i edgeSpanWide[3] = { edgeRowWide[0], edgeRowWide[1], edgeRowWide[2] };
+                            edgeRowWide[0] = _mm256_add_epi32(edgeRowWide[0], edgeRowStepWide[0]);
+                            edgeRowWide[1] = _mm256_add_epi32(edgeRowWide[1], edgeRowStepWide[1]);
+                            edgeRowWide[2] = _mm256_add_epi32(edgeRowWide[2], edgeRowStepWide[2]);
+
+                            for( uint32_t tileX = blockX; tileX < blockXEnd; tileX += 8u)
+                            {
+                                const __m256i w0Wide = edgeSpanWide[0];
+                                const __m256i w1Wide = edgeSpanWide[1];
+                                const __m256i w2Wide = edgeSpanWide[2];
+                                edgeSpanWide[0] = _mm256_add_epi32(edgeSpanWide[0], edgeSpanStepWide[0]);
+                                edgeSpanWide[1] = _mm256_add_epi32(edgeSpanWide[1], edgeSpanStepWide[1]);
+                                edgeSpanWide[2] = _mm256_add_epi32(edgeSpanWide[2], edgeSpanStepWide[2]);
+
+                                const uint32_t depthBufferOffset = tileX + tileY * depthBufferStride;
+
+                                __m256i pixelMask = _mm256_set1_epi32(-1);
+                                if( !blockFullyCovered )
+                                {
+                                    //FK: A pixel is inside if none of the edge function values is negative (sign bit not set)
+                                    const __m256i edgeSigns = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(w0Wide, blockEdges.insideTestMasks[0]), _mm256_and_si256(w1Wide, blockEdges.insideTestMasks[1])), _mm256_and_si256(w2Wide, blockEdges.insideTestMasks[2]));
+                                    pixelMask = _mm256_and_si256(blockColumnMask, _mm256_cmpgt_epi32(edgeSigns, _mm256_set1_epi32(-1)));
+                                    if( _mm256_movemask_epi8(pixelMask) == 0 )
+                                    {
+                                        continue;
+                                    }
+                                }
+
+                                const __m256i pixelCoordinatesXWide = _mm256_add_epi32(_mm256_set1_epi32(tileX), laneIndices);
+
+                                const __m256 uWide = _mm256_fmadd_ps(_mm256_cvtepi32_ps(w0Wide), _mm256_broadcast_ss(&edgeToBarycentricScale), blockEdges.barycentricBiases[0]);
+                                const __m256 vWide = _mm256_fmadd_ps(_mm256_cvtepi32_ps(w1Wide), _mm256_broadcast_ss(&edgeToBarycentricScale), blockEdges.barycentricBiases[1]);
+                                const __m256 wWide = _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_add_ps(uWide, vWide));
+
+                                const __m256 newDepthBufferZ = _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_fmadd_ps(_mm256_broadcast_ss(&v0.z), uWide, _mm256_fmadd_ps(_mm256_broadcast_ss(&v1.z), vWide, _mm256_mul_ps(_mm256_broadcast_ss(&v2.z), wWide))));
+
+                                __m256i depthBufferMask = pixelMask;
+                                if( !blockDepthTestPasses )
+                                {
+                                    //FK: Partially covered blocks only load the covered pixels since they can reach past the back buffer.
+                                    const __m256 oldDepthBufferZ = blockFullyCovered ? _mm256_load_ps(pDepthBufferContent + depthBufferOffset) : _mm256_maskload_ps(pDepthBufferContent + depthBufferOffset, pixelMask);
+                                    depthBufferMask = _mm256_castps_si256(_mm256_cmp_ps(newDepthBufferZ, oldDepthBufferZ, depthCompareOperation));
+                                    depthBufferMask = _mm256_and_si256(depthBufferMask, pixelMask);
+                                    if( _mm256_movemask_epi8(depthBufferMask) == 0 )
+                                    {
+                                        continue;
+                                    }
+                                }
+
+                                if( RASTER_PASS != raster_pass_t::color_equal_depth )
+                                {
+                                    _mm256_maskstore_ps(pDepthBufferContent + depthBufferOffset, depthBufferMask, newDepthBufferZ);
+                                    depthWritten = true;
+                                }
+
+                                if( RASTER_PASS == raster_pass_t::depth_only )
+                                {
+                                    continue;
+                                }
+
+                                pixelIndex += _k15_append_pixels(pShadingContext, pixelIndex, depthBufferMask, uWide, vWide, pixelCoordinatesXWide, tileY);
+                            }
+                        }
+
+                        if( depthWritten )
+                        {
+                            const uint32_t rowCount = get_min(RasterBlockSize, pScreenTile->boundingBox.y2 - blockY);
+                            const uint32_t columnCount = get_min(RasterBlockSize, pScreenTile->boundingBox.x2 - blockX);
+                            _k15_update_hi_z_entry(pHiZEntry, pDepthBufferContent + blockX + blockY * depthBufferStride, depthBufferStride, rowCount, columnCount);
+                        }
+                    }
+                }
+
+                if( RASTER_PASS != raster_pass_t::depth_only )
+                {
+                    _k15_commit_pixel_batch_run(pPixelBatch, pTriangle, pixelIndex);
+                }
+            }
+        }
+    }
+
+    if( smallTriangleCount > 0u )
+    {
+        _k15_draw_small_triangles<RASTER_PASS>(pScreenTile, pScreenspaceTriangles, pSmallTriangleDrawCall, smallTriangleIndices, smallTriangleCount, pShadingContext, pColorBuffer, pDepthBuffer, pHiZBuffer, colorBufferStride, depthBufferStride, hiZBufferStride, redShift, greenShift, blueShift);
+    }
+
+    _k15_flush_pixel_batch(pShadingContext, pColorBufferContent, colorBufferStride, redShift, greenShift, blueShift);
+}
+
+internal void _k15_convert_depth_buffer_to_color_buffer(const void* pDepthBuffer, void* pColorBuffer, uint32_t backbufferWidth, uint32_t backbufferHeight, uint32_t colorBufferStride, uint32_t depthBufferStride, uint8_t redShift, uint8_t greenShift, uint8_t blueShift)
+{
+    uint32_t* restrict_modifier pColorBufferContent = (uint32_t* restrict_modifier)pColorBuffer;
+    const float* restrict_modifier pDepthBufferContent = (const float* restrict_modifier)pDepthBuffer;
+
+    const __m256i redShiftWide   = _mm256_set1_epi32(redShift);
+    const __m256i greenShiftWide = _mm256_set1_epi32(greenShift);
+    const __m256i blueShiftWide  = _mm256_set1_epi32(blueShift);
+
+    for(uint32_t y = 0u; y < backbufferHeight; ++y)
+    {
+        for(uint32_t x = 0u; x < backbufferWidth; x += 8u)
+        {
+            const __m256 depth = _mm256_mul_ps(_mm256_load_ps(pDepthBufferContent + x + y * depthBufferStride),  _mm256_set1_ps(255.f));
+            const __m256i depthInteger = _mm256_cvtps_epi32(depth);
+
+            __m256i colorDepth = _mm256_or_si256(depthInteger, _mm256_sllv_epi32(depthInteger, redShiftWide));
+            colorDepth = _mm256_or_si256(colorDepth, _mm256_sllv_epi32(depthInteger, greenShiftWide));
+            colorDepth = _mm256_or_si256(colorDepth, _mm256_sllv_epi32(depthInteger, blueShiftWide));
+
+            _mm256_store_si256((__m256i*)(pColorBufferContent + x + y * colorBufferStride), colorDepth);
+        }
+    }
+}
+
+//https://graphics.stanford.edu/~seander/bithacks.html#DetermineIfPowerOf2
+internal inline bool _k15_is_pow2(uint32_t value)
+{
+    return (value & (value - 1)) == 0;
+}
+
+//https://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2
+internal inline uint32_t _k15_get_next_pow2(uint32_t value)
+{
+    if(_k15_is_pow2(value))
+    {
+        ++value;
+    }
+
+    value--;
+    value |= value >> 1;
+    value |= value >> 2;
+    value |= value >> 4;
+    value |= value >> 8;
+    value |= value >> 16;
+    value++;
+
+    return value;
+}
+
+bool _k15_create_font(bitmap_font_t* pOutFont)
+{
+    const size_t bitmapSizeInBytes = imageSizeX * imageSizeY * imageChannelCount;
+    pOutFont->pRGBPixels = pImageData;
+    pOutFont->height = imageSizeX;
+    pOutFont->width = imageSizeY;
+    pOutFont->channels = imageChannelCount;
+    return true;
+}
+
+software_rasterizer_context_init_parameters_t k15_create_default_software_rasterizer_context_parameters(uint32_t screenWidth, uint32_t screenHeight, void** pColorBuffers, void** pDepthBuffers, uint32_t colorBufferCount)
+{
+    software_rasterizer_context_init_parameters_t defaultParameters = {};
+    defaultParameters.backBufferHeight  = screenHeight;
+    defaultParameters.backBufferWidth   = screenWidth;
+    defaultParameters.colorBufferStride = screenWidth;
+    defaultParameters.depthBufferStride = screenWidth;
+    defaultParameters.blueShift         = 16;
+    defaultParameters.greenShift        = 8;
+    defaultParameters.redShift          = 0;
+    defaultParameters.pColorBuffers[0]  = pColorBuffers[0];
+    defaultParameters.pDepthBuffers[0]  = pDepthBuffers[0];
+    defaultParameters.pColorBuffers[1]  = pColorBuffers[1];
+    defaultParameters.pDepthBuffers[1]  = pDepthBuffers[1];
+    defaultParameters.pColorBuffers[2]  = pColorBuffers[2];
+    defaultParameters.pDepthBuffers[2]  = pDepthBuffers[2];
+    defaultParameters.colorBufferCount  = colorBufferCount;
+    defaultParameters.workerThreadCount = DefaultWorkerThreadCount;
+    defaultParameters.workerThreadAffinityMask = 0u;
+
+    return defaultParameters;
+}
+
+vertex_layout_t k15_create_default_vertex_layout()
+{
+    vertex_layout_t defaultLayout = {};
+    defaultLayout.attributes[0]     = { vertex_attribute_t::position, vertex_attribute_format_t::float4, offsetof(vertex_t, position) };
+    defaultLayout.attributes[1]     = { vertex_attribute_t::normal,   vertex_attribute_format_t::float4, offsetof(vertex_t, normal) };
+    defaultLayout.attributes[2]     = { vertex_attribute_t::color,    vertex_attribute_format_t::float4, offsetof(vertex_t, color) };
+    defaultLayout.attributes[3]     = { vertex_attribute_t::texcoord, vertex_attribute_format_t::float2, offsetof(vertex_t, texcoord) };
+    defaultLayout.attributeCount    = 4u;
+    defaultLayout.strideInBytes     = sizeof(vertex_t);
+
+    return defaultLayout;
+}
+
+pixel_shader_desc_t k15_create_default_pixel_shader_desc(pixel_shader_fnc_t pixelShaderFnc)
+{
+    pixel_shader_desc_t defaultDesc = {};
+    defaultDesc.function            = pixelShaderFnc;
+    defaultDesc.interpolationMode   = interpolation_mode_t::affine;
+    defaultDesc.inputLayout         = pixel_shader_input_layout_t::vertex_data;
+    defaultDesc.quadShadingEnabled  = false;
+    defaultDesc.attributes[0]       = vertex_attribute_t::position;
+    defaultDesc.attributes[1]       = vertex_attribute_t::normal;
+    defaultDesc.attributes[2]       = vertex_attribute_t::color;
+    defaultDesc.attributes[3]       = vertex_attribute_t::texcoord;
+    defaultDesc.attributeCount      = 4u;
+
+    return defaultDesc;
+}
+
+internal bool _k15_create_frame(frame_t* pFrame, software_rasterizer_context_t* pContext)
+{
+    pFrame->pContext            = pContext;
+    pFrame->pColorBuffer        = nullptr;
+    pFrame->pDepthBuffer        = nullptr;
+    pFrame->settings            = pContext->settings;
+    pFrame->frameNumber         = 0u;
+    pFrame->screenTileCountX    = 0u;
+    pFrame->screenTileCountY    = 0u;
+    pFrame->pHiZBuffer          = nullptr;
+    pFrame->hiZBufferStride     = 0u;
+    pFrame->hiZBufferHeight     = 0u;
+    pFrame->hiZBufferCapacity   = 0u;
+    pFrame->hiZFrameNumber      = 0u;
+
+    if(!_k15_create_stack_allocator(&pFrame->pDrawCallDataAllocator, DefaultUniformDataStackAllocatorSizeInBytes))
+    {
+        return false;
+    }
+
+    if(!_k15_create_dynamic_buffer<draw_call_t>(&pFrame->drawCalls, DefaultDrawCallCapacity))
+    {
+        return false;
+    }
+
+    if(!_k15_create_dynamic_buffer<raster_draw_call_t>(&pFrame->rasterDrawCalls, DefaultDrawCallCapacity))
+    {
+        return false;
+    }
+
+    if(!_k15_create_dynamic_buffer<screenspace_triangle_t>(&pFrame->screenspaceTriangles, DefaultTriangleBufferCapacity))
+    {
+        return false;
+    }
+
+    if(!_k15_create_dynamic_buffer<screen_tile_t>(&pFrame->screenTiles, DefaultDrawCallCapacity))
+    {
+        return false;
+    }
+
+    return true;
+}
+
+internal void _k15_destroy_frame(frame_t* pFrame)
+{
+    for(uint32_t screenTileIndex = 0u; screenTileIndex < pFrame->screenTiles.count; ++screenTileIndex)
+    {
+        _k15_destroy_dynamic_buffer(&pFrame->screenTiles.pData[screenTileIndex].triangles);
+    }
+
+    _k15_destroy_stack_allocator(pFrame->pDrawCallDataAllocator);
+    _mm_free(pFrame->pHiZBuffer);
+    _k15_destroy_dynamic_buffer(&pFrame->drawCalls);
+    _k15_destroy_dynamic_buffer(&pFrame->rasterDrawCalls);
+    _k15_destroy_dynamic_buffer(&pFrame->screenspaceTriangles);
+    _k15_destroy_dynamic_buffer(&pFrame->screenTiles);
+}
+
+internal void _k15_destroy_block_allocator(block_allocator_t* pBlockAllocator)
+{
+    while( pBlockAllocator != nullptr )
+    {
+        block_allocator_t* pNextBlock = (block_allocator_t*)pBlockAllocator->pNextBlock;
+        free(pBlockAllocator);
+        pBlockAllocator = pNextBlock;
+    }
+}
+
+//FK: The context gets zero initialized before any of its members get created, k15_destroy_software_rasterizer_context
+//    only frees what has been created so far if this fails halfway.
+internal bool _k15_init_software_rasterizer_context(software_rasterizer_context_t* pContext, const software_rasterizer_context_init_parameters_t* pParameters)
+{
+    pContext->backBufferHeight              = pParameters->backBufferHeight;
+    pContext->backBufferWidth               = pParameters->backBufferWidth;
+    pContext->colorBufferStride             = pParameters->colorBufferStride;
+    pContext->depthBufferStride             = pParameters->depthBufferStride;
+    pContext->redShift                      = pParameters->redShift;
+    pContext->greenShift                    = pParameters->greenShift;
+    pContext->blueShift                     = pParameters->blueShift;
+    pContext->currentColorBufferIndex       = 0;
+    pContext->currentTriangleVertexIndex    = 0;
+    pContext->pBoundVertexBuffer            = nullptr;
+    pContext->pBoundIndexBuffer             = nullptr;
+    pContext->pBoundInstanceBuffer          = nullptr;
+    pContext->pBoundUniformBuffer           = nullptr;
+    pContext->pBoundVertexShader            = nullptr;
+    pContext->pBoundPixelShader             = nullptr;
+    pContext->pNextDrawCallOcclusionQueryResult = nullptr;
+    pContext->nextDrawCallHasOcclusionBounds    = false;
+    pContext->nextDrawCallFrustumCoverage       = frustum_coverage_t::partial;
+    pContext->frameNumber                   = 0;
+
+    if(!_k15_create_font(&pContext->font))
+    {
+        return false;
+    }
+
+    memset(&pContext->settings, 0, sizeof(pContext->settings));
+    pContext->settings.backFaceCullingEnabled = 1;
+    for(uint8_t colorBufferIndex = 0; colorBufferIndex < pParameters->colorBufferCount; ++colorBufferIndex)
+    {
+        pContext->pColorBuffer[colorBufferIndex] = pParameters->pColorBuffers[colorBufferIndex];
+    }
+
+    //FK: Depth buffer rows get accessed with aligned 8 wide loads
+    RuntimeAssert(( pParameters->depthBufferStride % 8u ) == 0u);
+    for(uint8_t colorBufferIndex = 0; colorBufferIndex < pParameters->colorBufferCount; ++colorBufferIndex)
+    {
+        RuntimeAssert(( (uintptr_t)pParameters->pDepthBuffers[colorBufferIndex] & 31u ) == 0u);
+        pContext->pDepthBuffer[colorBufferIndex] = pParameters->pDepthBuffers[colorBufferIndex];
+    }
+
+    pContext->colorBufferCount = pParameters->colorBufferCount;
+
+    if(!_k15_create_dynamic_buffer<vertex_buffer_t>(&pContext->vertexBuffers, DefaultVertexBufferCapacity))
+    {
+        return false;
+    }
+
+    if(!_k15_create_dynamic_buffer<index_buffer_t>(&pContext->indexBuffers, DefaultIndexBufferCapacity))
+    {
+        return false;
+    }
+
+    if(!_k15_create_dynamic_buffer<instance_buffer_t>(&pContext->instanceBuffers, DefaultInstanceBufferCapacity))
+    {
+        return false;
+    }
+
+    if(!_k15_create_dynamic_buffer<texture_t>(&pContext->textures, DefaultTextureCapacity))
+    {
+        return false;
+    }
+
+    if(!_k15_create_dynamic_buffer<draw_call_t>(&pContext->drawCalls, DefaultDrawCallCapacity))
+    {
+        return false;
+    }
+
+    if(!_k15_create_dynamic_buffer<vertex_shader_t>(&pContext->vertexShaders, DefaultShaderCapacity))
+    {
+        return false;
+    }
+
+    if(!_k15_create_dynamic_buffer<pixel_shader_t>(&pContext->pixelShaders, DefaultShaderCapacity))
+    {
+        return false;
+    }
+
+    if(!_k15_create_dynamic_buffer<uniform_buffer_t>(&pContext->uniformBuffers, DefaultVertexBufferCapacity))
+    {
+        return false;
+    }
+
+    if(!_k15_create_block_allocator(&pContext->pUniformDataAllocator))
+    {
+        return false;
+    }
+
+    if(!_k15_create_stack_allocator(&pContext->pDrawCallDataAllocator, DefaultUniformDataStackAllocatorSizeInBytes))
+    {
+        return false;
+    }
+
+    pContext->pFrames = new frame_t[MaxFramesInFlight]();
+    for(uint32_t frameIndex = 0u; frameIndex < MaxFramesInFlight; ++frameIndex)
+    {
+        if(!_k15_create_frame(pContext->pFrames + frameIndex, pContext))
+        {
+            return false;
+        }
+    }
+
+    if(!_k15_create_dynamic_buffer<geometry_job_t>(&pContext->geometryJobs, DefaultJobCapacity))
+    {
+        return false;
+    }
+
+    uint32_t workerThreadCount = pParameters->workerThreadCount;
+    if( workerThreadCount == DefaultWorkerThreadCount )
+    {
+        const uint32_t hardwareThreadCount = std::thread::hardware_concurrency();
+        workerThreadCount = hardwareThreadCount > 1u ? hardwareThreadCount - 1u : 0u;
+    }
+
+    if(!_k15_create_job_system(&pContext->pJobSystem, workerThreadCount, pParameters->workerThreadAffinityMask))
+    {
+        return false;
+    }
+
+    pContext->shadingContextCount   = workerThreadCount + 1u;
+    pContext->pShadingContexts      = (shading_context_t*)_mm_malloc(sizeof(shading_context_t) * pContext->shadingContextCount, CacheLineSizeInBytes);
+    if( pContext->pShadingContexts == nullptr )
+    {
+        return false;
+    }
+
+    memset(pContext->pShadingContexts, 0, sizeof(shading_context_t) * pContext->shadingContextCount);
+
+    for(uint32_t shadingContextIndex = 0u; shadingContextIndex < pContext->shadingContextCount; ++shadingContextIndex)
+    {
+        if(!_k15_create_shading_context(pContext->pShadingContexts + shadingContextIndex, PixelShaderInputCount, ShadingContextStackAllocatorSizeInBytes))
+        {
+            return false;
+        }
+
+        if(!_k15_create_post_transform_cache(&pContext->pShadingContexts[shadingContextIndex].postTransformCache))
+        {
+            return false;
+        }
+
+        shading_context_t* pShadingContext = pContext->pShadingContexts + shadingContextIndex;
+        if(!_k15_create_vertex_shader_input(&pShadingContext->vertexShaderInput, &pShadingContext->pVertexShaderInputMemory, GeometryJobIndexCount))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool k15_create_software_rasterizer_context(software_rasterizer_context_t** pOutContextPtr, const software_rasterizer_context_init_parameters_t* pParameters)
+{
+    software_rasterizer_context_t* pContext = (software_rasterizer_context_t*)malloc(sizeof(software_rasterizer_context_t));
+    if( pContext == nullptr )
+    {
+        return false;
+    }
+
+    memset(pContext, 0, sizeof(software_rasterizer_context_t));
+    if(!_k15_init_software_rasterizer_context(pContext, pParameters))
+    {
+        k15_destroy_software_rasterizer_context(pContext);
+        return false;
+    }
+
+    *pOutContextPtr = pContext;
+    return true;
+}
+
+void k15_destroy_software_rasterizer_context(software_rasterizer_context_t* pContext)
+{
+    RuntimeAssert(pContext != nullptr);
+
+    if( pContext->pJobSystem != nullptr )
+    {
+        //FK: Frames that are still in flight use the frames and shading contexts
+        job_system_t* pJobSystem = pContext->pJobSystem;
+        for(uint32_t frameIndex = 0u; pContext->pFrames != nullptr && frameIndex < MaxFramesInFlight; ++frameIndex)
+        {
+            _k15_wait_for_jobs(pJobSystem, &pContext->pFrames[frameIndex].jobCounter, _k15_get_current_worker_index(pJobSystem));
+        }
+
+        _k15_destroy_job_system(pJobSystem);
+    }
+
+    if( pContext->pShadingContexts != nullptr )
+    {
+        for(uint32_t shadingContextIndex = 0u; shadingContextIndex < pContext->shadingContextCount; ++shadingContextIndex)
+        {
+            shading_context_t* pShadingContext = pContext->pShadingContexts + shadingContextIndex;
+            _k15_destroy_chained_stack_allocators(&pShadingContext->stackAllocator);
+            _mm_free(pShadingContext->pMemory);
+            _mm_free(pShadingContext->postTransformCache.pMemory);
+            _mm_free(pShadingContext->pVertexShaderInputMemory);
+        }
+
+        _mm_free(pContext->pShadingContexts);
+    }
+
+    if( pContext->pFrames != nullptr )
+    {
+        for(uint32_t frameIndex = 0u; frameIndex < MaxFramesInFlight; ++frameIndex)
+        {
+            _k15_destroy_frame(pContext->pFrames + frameIndex);
+        }
+
+        delete[] pContext->pFrames;
+    }
+
+    for(uint32_t geometryJobIndex = 0u; geometryJobIndex < pContext->geometryJobs.count; ++geometryJobIndex)
+    {
+        geometry_job_t* pGeometryJob = pContext->geometryJobs.pData + geometryJobIndex;
+        _k15_destroy_dynamic_buffer(&pGeometryJob->visibleTriangles);
+        _k15_destroy_dynamic_buffer(&pGeometryJob->clippedTriangles);
+        _k15_destroy_dynamic_buffer(&pGeometryJob->screenspaceTriangles);
+    }
+
+    //FK: Vertex buffers own their vertex streams unless they were created from user owned streams
+    for(uint32_t vertexBufferIndex = 0u; vertexBufferIndex < pContext->vertexBuffers.count; ++vertexBufferIndex)
+    {
+        _mm_free(pContext->vertexBuffers.pData[vertexBufferIndex].pMemory);
+    }
+
+    _k15_destroy_block_allocator(pContext->pUniformDataAllocator);
+    _k15_destroy_stack_allocator(pContext->pDrawCallDataAllocator);
+
+    _k15_destroy_dynamic_buffer(&pContext->geometryJobs);
+    _k15_destroy_dynamic_buffer(&pContext->drawCalls);
+    _k15_destroy_dynamic_buffer(&pContext->uniformBuffers);
+    _k15_destroy_dynamic_buffer(&pContext->vertexBuffers);
+    _k15_destroy_dynamic_buffer(&pContext->indexBuffers);
+    _k15_destroy_dynamic_buffer(&pContext->instanceBuffers);
+    _k15_destroy_dynamic_buffer(&pContext->textures);
+    _k15_destroy_dynamic_buffer(&pContext->vertexShaders);
+    _k15_destroy_dynamic_buffer(&pContext->pixelShaders);
+
+    free(pContext);
+}
+
+void k15_swap_color_buffers(software_rasterizer_context_t* pContext)
+{
+    if(pContext->colorBufferCount == 1u)
+    {
+        return;
+    }
+
+    const uint8_t newColorBufferIndex = ++pContext->currentColorBufferIndex % pContext->colorBufferCount;
+    pContext->currentColorBufferIndex = newColorBufferIndex;
+}
+
+matrix4x4f_t _k15_mul_matrix4x4f(const matrix4x4f_t* restrict_modifier pMatA, const matrix4x4f_t* restrict_modifier pMatB)
+{
+    matrix4x4f_t mat = {};
+    mat.m00 = pMatA->m00 * pMatB->m00 + pMatA->m01 * pMatB->m10 + pMatA->m02 * pMatB->m20 + pMatA->m03 * pMatB->m30;
+    mat.m01 = pMatA->m00 * pMatB->m01 + pMatA->m01 * pMatB->m11 + pMatA->m02 * pMatB->m21 + pMatA->m03 * pMatB->m31;
+    mat.m02 = pMatA->m00 * pMatB->m02 + pMatA->m01 * pMatB->m12 + pMatA->m02 * pMatB->m22 + pMatA->m03 * pMatB->m32;
+    mat.m03 = pMatA->m00 * pMatB->m03 + pMatA->m01 * pMatB->m13 + pMatA->m02 * pMatB->m23 + pMatA->m03 * pMatB->m33;
+
+    mat.m10 = pMatA->m10 * pMatB->m00 + pMatA->m11 * pMatB->m10 + pMatA->m12 * pMatB->m20 + pMatA->m13 * pMatB->m30;
+    mat.m11 = pMatA->m10 * pMatB->m01 + pMatA->m11 * pMatB->m11 + pMatA->m12 * pMatB->m21 + pMatA->m13 * pMatB->m31;
+    mat.m12 = pMatA->m10 * pMatB->m02 + pMatA->m11 * pMatB->m12 + pMatA->m12 * pMatB->m22 + pMatA->m13 * pMatB->m32;
+    mat.m13 = pMatA->m10 * pMatB->m03 + pMatA->m11 * pMatB->m13 + pMatA->m12 * pMatB->m23 + pMatA->m13 * pMatB->m33;
+
+    mat.m20 = pMatA->m20 * pMatB->m00 + pMatA->m21 * pMatB->m10 + pMatA->m22 * pMatB->m20 + pMatA->m23 * pMatB->m30;
+    mat.m21 = pMatA->m20 * pMatB->m01 + pMatA->m21 * pMatB->m11 + pMatA->m22 * pMatB->m21 + pMatA->m23 * pMatB->m31;
+    mat.m22 = pMatA->m20 * pMatB->m02 + pMatA->m21 * pMatB->m12 + pMatA->m22 * pMatB->m22 + pMatA->m23 * pMatB->m32;
+    mat.m23 = pMatA->m20 * pMatB->m03 + pMatA->m21 * pMatB->m13 + pMatA->m22 * pMatB->m23 + pMatA->m23 * pMatB->m33;
+
+    mat.m30 = pMatA->m30 * pMatB->m00 + pMatA->m31 * pMatB->m10 + pMatA->m32 * pMatB->m20 + pMatA->m33 * pMatB->m30;
+    mat.m31 = pMatA->m30 * pMatB->m01 + pMatA->m31 * pMatB->m11 + pMatA->m32 * pMatB->m21 + pMatA->m33 * pMatB->m31;
+    mat.m32 = pMatA->m30 * pMatB->m02 + pMatA->m31 * pMatB->m12 + pMatA->m32 * pMatB->m22 + pMatA->m33 * pMatB->m32;
+    mat.m33 = pMatA->m30 * pMatB->m03 + pMatA->m31 * pMatB->m13 + pMatA->m32 * pMatB->m23 + pMatA->m33 * pMatB->m33;
+
+    return mat;
+}
+
+//FK: Streams that are not part of the source vertex buffer are skipped
+internal void _k15_copy_vertex_streams(vertex_shader_input_t* pTarget, uint32_t targetOffset, const vertex_streams_t* pSource, uint32_t sourceOffset, uint32_t vertexCount)
+{
+    memcpy(pTarget->positions + targetOffset, pSource->pPositions + sourceOffset, sizeof(vector4f_t) * vertexCount);
+
+    if( pSource->pNormals != nullptr )
+    {
+        memcpy(pTarget->normals + targetOffset, pSource->pNormals + sourceOffset, sizeof(vector4f_t) * vertexCount);
+    }
+
+    if( pSource->pColors != nullptr )
+    {
+        memcpy(pTarget->colors + targetOffset, pSource->pColors + sourceOffset, sizeof(vector4f_t) * vertexCount);
+    }
+
+    if( pSource->pTexcoords != nullptr )
+    {
+        memcpy(pTarget->texcoords + targetOffset, pSource->pTexcoords + sourceOffset, sizeof(vector2f_t) * vertexCount);
+    }
+}
+
+template<typename T>
+internal void _k15_gather_vertex_stream(T* restrict_modifier pTarget, const T* restrict_modifier pSource, uint32_t sourceOffset, const uint32_t* pVertexIndices, uint32_t vertexCount)
+{
+    if( pSource == nullptr )
+    {
+        return;
+    }
+
+    pSource += sourceOffset;
+    for( uint32_t vertexIndex = 0; vertexIndex < vertexCount; ++vertexIndex )
+    {
+        pTarget[vertexIndex] = pSource[pVertexIndices[vertexIndex]];
+    }
+}
+
+internal void _k15_gather_vertex_streams(vertex_shader_input_t* pTarget, const vertex_streams_t* pSource, uint32_t sourceOffset, const uint32_t* pVertexIndices, uint32_t vertexCount)
+{
+    _k15_gather_vertex_stream(pTarget->positions, pSource->pPositions, sourceOffset, pVertexIndices, vertexCount);
+    _k15_gather_vertex_stream(pTarget->normals, pSource->pNormals, sourceOffset, pVertexIndices, vertexCount);
+    _k15_gather_vertex_stream(pTarget->colors, pSource->pColors, sourceOffset, pVertexIndices, vertexCount);
+    _k15_gather_vertex_stream(pTarget->texcoords, pSource->pTexcoords, sourceOffset, pVertexIndices, vertexCount);
+}
+
+internal void _k15_gather_triangle_vertices(triangle_t* pTriangle, const vertex_shader_input_t* pVertices, uint32_t attributeMask, uint32_t vertexIndexA, uint32_t vertexIndexB, uint32_t vertexIndexC)
+{
+    const uint32_t vertexIndices[3] = {vertexIndexA, vertexIndexB, vertexIndexC};
+    for( uint32_t triangleVertexIndex = 0; triangleVertexIndex < 3u; ++triangleVertexIndex )
+    {
+        vertex_t* pVertex = pTriangle->vertices + triangleVertexIndex;
+        const uint32_t vertexIndex = vertexIndices[triangleVertexIndex];
+        pVertex->position = pVertices->positions[vertexIndex];
+
+        if( attributeMask & VertexAttributeMaskNormal )
+        {
+            pVertex->normal = pVertices->normals[vertexIndex];
+        }
+
+        if( attributeMask & VertexAttributeMaskColor )
+        {
+            pVertex->color = pVertices->colors[vertexIndex];
+        }
+
+        if( attributeMask & VertexAttributeMaskTexcoord )
+        {
+            pVertex->texcoord = pVertices->texcoords[vertexIndex];
+        }
+    }
+}
+
+inline vector4f_t k15_vector4f_div(vector4f_t vector, float div)
+{
+    vector4f_t divVector = vector;
+    divVector.x = vector.x / div;
+    divVector.y = vector.y / div;
+    divVector.z = vector.z / div;
+    divVector.w = vector.w / div;
+
+    return divVector;
+}
+
+inline vector3f_t k15_vector3f_normalize(vector3f_t vector)
+{
+    vector3f_t normalizedVector = {};
+    float vectorLength = sqrtf(vector.x * vector.x + vector.y * vector.y + vector.z * vector.z);
+    normalizedVector.x = vector.x / vectorLength;
+    normalizedVector.y = vector.y / vectorLength;
+    normalizedVector.z = vector.z / vectorLength;
+
+    return normalizedVector;
+}
+
+inline vector4f_t k15_vector4f_normalize(vector4f_t vector)
+{
+    vector4f_t normalizedVector = {};
+    float vectorLength = sqrtf(vector.x * vector.x + vector.y * vector.y + vector.z * vector.z + vector.w * vector.w);
+    normalizedVector.x = vector.x / vectorLength;
+    normalizedVector.y = vector.y / vectorLength;
+    normalizedVector.z = vector.z / vectorLength;
+    normalizedVector.w = vector.w / vectorLength;
+
+    return normalizedVector;
+}
+
+inline vector3f_t k15_vector3f_cross(vector3f_t a, vector3f_t b)
+{
+    vector3f_t crossVector = {};
+    crossVector.x = a.y * b.z - a.z * b.y;
+    crossVector.y = a.z * b.x - a.x * b.z;
+    crossVector.z = a.x * b.y - a.y * b.x;
+
+    return crossVector;
+}
+
+inline vector4f_t k15_vector4f_cross(vector4f_t a, vector4f_t b)
+{
+    vector4f_t crossVector = {};
+    crossVector.x = a.y * b.z - a.z * b.y;
+    crossVector.y = a.z * b.x - a.x * b.z;
+    crossVector.z = a.x * b.y - a.y * b.x;
+    crossVector.w = 0.0f; //TODO
+
+    return crossVector;
+}
+
+float k15_vector4f_dot(vector4f_t a, vector4f_t b)
+{
+    const float dot = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+    return dot;
+}
+
+vector4f_t k15_vector4f_sub(vector4f_t a, vector4f_t b)
+{
+    vector4f_t v = {};
+    v.x = a.x - b.x;
+    v.y = a.y - b.y;
+    v.z = a.z - b.z;
+    v.w = a.w - b.w;
+
+    return v;
+}
+
+//FK: Gathers component componentIndex of the positions of 8 vertices.
+internal inline __m256 _k15_gather_position_component(const vector4f_t* pPositions, __m256i vertexIndices, uint32_t componentIndex)
+{
+    const __m256i componentIndices = _mm256_add_epi32(_mm256_slli_epi32(vertexIndices, 2), _mm256_set1_epi32(componentIndex));
+    return _mm256_i32gather_ps((const float*)pPositions, componentIndices, 4);
+}
+
+//FK: A vertex is outside if it is outside of any of the clip planes (-w <= x,y,z <= w).
+internal inline __m256 _k15_get_outside_frustum_mask(__m256 x, __m256 y, __m256 z, __m256 w)
+{
+    const __m256 negW = _mm256_sub_ps(_mm256_setzero_ps(), w);
+    const __m256 outsideX = _mm256_or_ps(_mm256_cmp_ps(x, negW, _CMP_LT_OQ), _mm256_cmp_ps(x, w, _CMP_GT_OQ));
+    const __m256 outsideY = _mm256_or_ps(_mm256_cmp_ps(y, negW, _CMP_LT_OQ), _mm256_cmp_ps(y, w, _CMP_GT_OQ));
+    const __m256 outsideZ = _mm256_or_ps(_mm256_cmp_ps(z, negW, _CMP_LT_OQ), _mm256_cmp_ps(z, w, _CMP_GT_OQ));
+    return _mm256_or_ps(_mm256_or_ps(outsideX, outsideY), outsideZ);
+}
+
+//FK: Culling only needs the transformed positions, only the vertices of visible triangles get gathered into pVisibleTriangleBuffer.
+//    pVertexIndices is nullptr for non-indexed geometry (vertices are already in triangle order).
+//    Triangles are tested 8 at a time, the indices of the visible triangles get left-packed so that only they get gathered.
+template<bool APPLY_BACKFACE_CULLING>
+bool k15_cull_outside_frustum_triangles(const vertex_shader_input_t* pVertices, uint32_t attributeMask, const uint32_t* pVertexIndices, uint32_t triangleCount, dynamic_buffer_t<triangle_t>* pVisibleTriangleBuffer)
+{
+    //FK: Reserve room for all triangles up front, the buffer gets shrunk to the visible triangles afterwards
+    triangle_t* pVisibleTriangles = _k15_dynamic_buffer_push_back(pVisibleTriangleBuffer, triangleCount);
+    if( pVisibleTriangles == nullptr )
+    {
+        return false;
+    }
+
+    const vector4f_t* pPositions = pVertices->positions;
+    const __m256i laneIndices = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+
+    alignas(32) uint32_t visibleVertexIndices[3][8];
+    uint32_t visibleTriangleCount = 0u;
+
+    for(uint32_t triangleIndex = 0; triangleIndex < triangleCount; triangleIndex += 8u)
+    {
+        const __m256i triangleIndices = _mm256_add_epi32(_mm256_set1_epi32(triangleIndex), laneIndices);
+        const __m256i laneMask = _mm256_cmpgt_epi32(_mm256_set1_epi32(triangleCount), triangleIndices);
+        const __m256i firstVertexIndices = _mm256_and_si256(_mm256_mullo_epi32(triangleIndices, _mm256_set1_epi32(3)), laneMask);
+
+        //FK: Unused lanes get vertex 0, their result gets masked out
+        __m256i vertexIndices[3];
+        for(uint32_t vertexIndex = 0u; vertexIndex < 3u; ++vertexIndex)
+        {
+            const __m256i triangleVertexIndices = _mm256_add_epi32(firstVertexIndices, _mm256_and_si256(_mm256_set1_epi32(vertexIndex), laneMask));
+            vertexIndices[vertexIndex] = pVertexIndices != nullptr ? 
+                _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int*)pVertexIndices, triangleVertexIndices, laneMask, 4) : 
+                triangleVertexIndices;
+        }
+
+        __m256 x[3], y[3], z[3], w[3];
+        for(uint32_t vertexIndex = 0u; vertexIndex < 3u; ++vertexIndex)
+        {
+            x[vertexIndex] = _k15_gather_position_component(pPositions, vertexIndices[vertexIndex], 0u);
+            y[vertexIndex] = _k15_gather_position_component(pPositions, vertexIndices[vertexIndex], 1u);
+            z[vertexIndex] = _k15_gather_position_component(pPositions, vertexIndices[vertexIndex], 2u);
+            w[vertexIndex] = _k15_gather_position_component(pPositions, vertexIndices[vertexIndex], 3u);
+        }
+
+        //FK: Triangles are culled if all of their vertices are outside of the frustum
+        const __m256 triangleOutsideFrustum = _mm256_and_ps(_mm256_and_ps(
+            _k15_get_outside_frustum_mask(x[0], y[0], z[0], w[0]),
+            _k15_get_outside_frustum_mask(x[1], y[1], z[1], w[1])),
+            _k15_get_outside_frustum_mask(x[2], y[2], z[2], w[2]));
+
+        __m256 visibleMask = _mm256_andnot_ps(triangleOutsideFrustum, _mm256_castsi256_ps(laneMask));
+
+        if(APPLY_BACKFACE_CULLING)
+        {
+            //FK: z of the cross product of (a - c) and (a - b) in normalized device coordinates, triangles are backfacing if it's <= 0
+            const __m256 ax = _mm256_div_ps(x[0], w[0]);
+            const __m256 ay = _mm256_div_ps(y[0], w[0]);
+            const __m256 bx = _mm256_div_ps(x[1], w[1]);
+            const __m256 by = _mm256_div_ps(y[1], w[1]);
+            const __m256 cx = _mm256_div_ps(x[2], w[2]);
+            const __m256 cy = _mm256_div_ps(y[2], w[2]);
+
+            const __m256 abx = _mm256_sub_ps(ax, bx);
+            const __m256 aby = _mm256_sub_ps(ay, by);
+            const __m256 acx = _mm256_sub_ps(ax, cx);
+            const __m256 acy = _mm256_sub_ps(ay, cy);
+            const __m256 normalZ = _mm256_sub_ps(_mm256_mul_ps(acx, aby), _mm256_mul_ps(acy, abx));
+
+            visibleMask = _mm256_and_ps(visibleMask, _mm256_cmp_ps(normalZ, _mm256_setzero_ps(), _CMP_NLE_UQ));
+        }
+
+        const uint32_t visibleBitMask = (uint32_t)_mm256_movemask_ps(visibleMask);
+        if( visibleBitMask == 0u )
+        {
+            continue;
+        }
+
+        const __m256i leftPackPermutation = _k15_get_left_pack_permutation(visibleBitMask);
+        _mm256_store_si256((__m256i*)visibleVertexIndices[0], _mm256_permutevar8x32_epi32(vertexIndices[0], leftPackPermutation));
+        _mm256_store_si256((__m256i*)visibleVertexIndices[1], _mm256_permutevar8x32_epi32(vertexIndices[1], leftPackPermutation));
+        _mm256_store_si256((__m256i*)visibleVertexIndices[2], _mm256_permutevar8x32_epi32(vertexIndices[2], leftPackPermutation));
+
+        const uint32_t visibleTriangleCountInBatch = __popcnt(visibleBitMask);
+        for(uint32_t visibleTriangleIndex = 0u; visibleTriangleIndex < visibleTriangleCountInBatch; ++visibleTriangleIndex)
+        {
+            _k15_gather_triangle_vertices(pVisibleTriangles + visibleTriangleCount++, pVertices, attributeMask, 
+                visibleVertexIndices[0][visibleTriangleIndex], visibleVertexIndices[1][visibleTriangleIndex], visibleVertexIndices[2][visibleTriangleIndex]);
+        }
+    }
+
+    pVisibleTriangleBuffer->count -= triangleCount - visibleTriangleCount;
+    return true;
+}
+
+internal bool _k15_cull_triangles(draw_call_triangles_t* pDrawCallTriangles, const vertex_shader_input_t* pVertices, const uint32_t* pVertexIndices, uint32_t triangleCount, dynamic_buffer_t<triangle_t>* pVisibleTriangleBuffer, bool backFaceCullingEnabeld)
+{
+    const uint32_t startVisibleTriangleCount = pVisibleTriangleBuffer->count;
+    const bool culled = backFaceCullingEnabeld ? 
+        k15_cull_outside_frustum_triangles<true>(pVertices, pDrawCallTriangles->attributeMask, pVertexIndices, triangleCount, pVisibleTriangleBuffer) :
+        k15_cull_outside_frustum_triangles<false>(pVertices, pDrawCallTriangles->attributeMask, pVertexIndices, triangleCount, pVisibleTriangleBuffer);
+
+    if(!culled)
     {
         return false;
     }
 
-    if( !_k15_create_stack_allocator(&pPixelShaderInput->pStackAllocator, 1024*1024 ) )
+    pDrawCallTriangles->pTriangles      = pVisibleTriangleBuffer->pData + startVisibleTriangleCount;
+    pDrawCallTriangles->triangleCount   = pVisibleTriangleBuffer->count - startVisibleTriangleCount;
+    return true;
+}
+
+internal inline float _k15_signf(float value)
+{
+    return value > 0.0f ? 1.0f : -1.0f;
+}
+
+internal inline float k15_vector4f_length_squared(vector4f_t vector)
+{
+    return vector.x * vector.x + vector.y * vector.y + vector.z * vector.z;
+}
+
+enum clip_flag_t : uint8_t
+{
+    Left    = 0b000001,
+    Right   = 0b000010,
+    Bottom  = 0b000100,
+    Top     = 0b001000,
+    Near    = 0b010000,
+    Far     = 0b100000
+};
+
+internal uint8_t _k15_get_position_clipping_flags(const vector4f_t point)
+{
+    const float posW = point.w;
+    const float negW = -posW;
+
+    uint8_t clippingFlags = 0u;
+
+    if( point.x < negW )
+    {
+        clippingFlags |= (uint8_t)clip_flag_t::Left;
+    }
+    else if( point.x > posW )
+    {
+        clippingFlags |= (uint8_t)clip_flag_t::Right;
+    }
+
+    if( point.y < negW )
+    {
+        clippingFlags |= (uint8_t)clip_flag_t::Top;
+    }
+    else if( point.y > posW )
+    {
+        clippingFlags |= (uint8_t)clip_flag_t::Bottom;
+    }
+
+    if( point.z < negW )
+    {
+        clippingFlags |= (uint8_t)clip_flag_t::Far;
+    }
+    else if( point.z > posW )
+    {
+        clippingFlags |= (uint8_t)clip_flag_t::Near;
+    }
+
+    return clippingFlags;
+}
+
+internal vector2f_t _k15_get_guard_band_scale(uint32_t backBufferWidth, uint32_t backBufferHeight)
+{
+    //FK: x/w = +/-1 maps to the screen edges, the guard band extends that to +/-scale
+    vector2f_t guardBandScale;
+    guardBandScale.x = get_max(1.0f, GuardBandSizeInPixels / (float)(backBufferWidth-1u));
+    guardBandScale.y = get_max(1.0f, GuardBandSizeInPixels / (float)(backBufferHeight-1u));
+    return guardBandScale;
+}
+
+//FK: Clip planes (a, b, c, d) in clip space, a point is inside of a plane if a*x + b*y + c*z + d*w >= 0
+internal void _k15_get_clip_planes(vector4f_t* pClipPlanes, vector2f_t guardBandScale)
+{
+    pClipPlanes[0] = { 1.0f,  0.0f,  0.0f, guardBandScale.x};
+    pClipPlanes[1] = {-1.0f,  0.0f,  0.0f, guardBandScale.x};
+    pClipPlanes[2] = { 0.0f,  1.0f,  0.0f, guardBandScale.y};
+    pClipPlanes[3] = { 0.0f, -1.0f,  0.0f, guardBandScale.y};
+    pClipPlanes[4] = { 0.0f,  0.0f,  1.0f, 1.0f};
+    pClipPlanes[5] = { 0.0f,  0.0f, -1.0f, 1.0f};
+}
+
+//FK: Gathers component componentIndex of vertex vertexIndex of 8 triangles.
+internal inline __m256 _k15_gather_triangle_position_component(const triangle_t* pTriangles, __m256i triangleIndices, uint32_t vertexIndex, uint32_t componentIndex)
+{
+    constexpr uint32_t triangleStrideInFloats   = sizeof(triangle_t) / sizeof(float);
+    constexpr uint32_t vertexStrideInFloats     = sizeof(vertex_t) / sizeof(float);
+    const __m256i componentIndices = _mm256_add_epi32(_mm256_mullo_epi32(triangleIndices, _mm256_set1_epi32(triangleStrideInFloats)), 
+        _mm256_set1_epi32(vertexIndex * vertexStrideInFloats + componentIndex));
+    return _mm256_i32gather_ps((const float*)pTriangles, componentIndices, 4);
+}
+
+internal inline void _k15_interpolate_clip_vertex(clip_vertex_t* restrict_modifier pVertex, const clip_vertex_t* restrict_modifier pStart, const clip_vertex_t* restrict_modifier pEnd, float t)
+{
+    const float* pStartComponents   = (const float*)pStart;
+    const float* pEndComponents     = (const float*)pEnd;
+    float* pComponents              = (float*)pVertex;
+
+    const __m256 t8 = _mm256_set1_ps(t);
+    for(uint32_t componentIndex = 0; componentIndex < 16u; componentIndex += 8u)
+    {
+        const __m256 start  = _mm256_load_ps(pStartComponents + componentIndex);
+        const __m256 end    = _mm256_load_ps(pEndComponents + componentIndex);
+        _mm256_store_ps(pComponents + componentIndex, _mm256_fmadd_ps(_mm256_sub_ps(end, start), t8, start));
+    }
+}
+
+//FK: Sutherland-Hodgman, clips the polygon against a single plane.
+internal void _k15_clip_polygon_against_plane(const clip_polygon_t* restrict_modifier pPolygon, clip_polygon_t* restrict_modifier pClippedPolygon, vector4f_t clipPlane)
+{
+    pClippedPolygon->vertexCount = 0u;
+
+    float distances[ClipPolygonMaxVertexCount];
+    for(uint32_t vertexIndex = 0; vertexIndex < pPolygon->vertexCount; ++vertexIndex)
+    {
+        distances[vertexIndex] = k15_vector4f_dot(clipPlane, pPolygon->vertices[vertexIndex].vertex.position);
+    }
+
+    uint32_t previousVertexIndex = pPolygon->vertexCount - 1u;
+    for(uint32_t vertexIndex = 0; vertexIndex < pPolygon->vertexCount; previousVertexIndex = vertexIndex++)
+    {
+        const bool previousVertexInside = distances[previousVertexIndex] >= 0.0f;
+        const bool vertexInside         = distances[vertexIndex] >= 0.0f;
+
+        if( previousVertexInside != vertexInside && pClippedPolygon->vertexCount < ClipPolygonMaxVertexCount )
+        {
+            //FK: Always interpolate from the inside to the outside vertex, that way neighbouring triangles get the exact same
+            //    intersection for their shared edge.
+            const uint32_t insideVertexIndex    = previousVertexInside ? previousVertexIndex : vertexIndex;
+            const uint32_t outsideVertexIndex   = previousVertexInside ? vertexIndex : previousVertexIndex;
+            const float t = distances[insideVertexIndex] / ( distances[insideVertexIndex] - distances[outsideVertexIndex] );
+            _k15_interpolate_clip_vertex(pClippedPolygon->vertices + pClippedPolygon->vertexCount++, pPolygon->vertices + insideVertexIndex, pPolygon->vertices + outsideVertexIndex, t);
+        }
+
+        if( vertexInside && pClippedPolygon->vertexCount < ClipPolygonMaxVertexCount )
+        {
+            pClippedPolygon->vertices[pClippedPolygon->vertexCount++] = pPolygon->vertices[vertexIndex];
+        }
+    }
+}
+
+//FK: Clips the triangle against all planes of clipPlaneMask and appends the resulting polygon as a triangle fan.
+internal bool _k15_clip_triangle(const triangle_t* pTriangle, const vector4f_t* pClipPlanes, uint32_t clipPlaneMask, dynamic_buffer_t<triangle_t>* pClippedTriangles)
+{
+    clip_polygon_t polygons[2];
+    clip_polygon_t* pPolygon        = polygons + 0;
+    clip_polygon_t* pClippedPolygon = polygons + 1;
+
+    pPolygon->vertexCount = 3u;
+    for(uint32_t vertexIndex = 0; vertexIndex < 3u; ++vertexIndex)
+    {
+        pPolygon->vertices[vertexIndex].vertex = pTriangle->vertices[vertexIndex];
+    }
+
+    for(uint32_t clipPlaneIndex = 0; clipPlaneIndex < ClipPlaneCount; ++clipPlaneIndex)
+    {
+        if( ( clipPlaneMask & ( 1u << clipPlaneIndex ) ) == 0u )
+        {
+            continue;
+        }
+
+        _k15_clip_polygon_against_plane(pPolygon, pClippedPolygon, pClipPlanes[clipPlaneIndex]);
+        if( pClippedPolygon->vertexCount < 3u )
+        {
+            return true;
+        }
+
+        clip_polygon_t* pTemp = pPolygon;
+        pPolygon = pClippedPolygon;
+        pClippedPolygon = pTemp;
+    }
+
+    const uint32_t triangleCount = pPolygon->vertexCount - 2u;
+    triangle_t* pTriangles = _k15_dynamic_buffer_push_back(pClippedTriangles, triangleCount);
+    if( pTriangles == nullptr )
     {
         return false;
     }
 
+    for(uint32_t triangleIndex = 0; triangleIndex < triangleCount; ++triangleIndex)
+    {
+        pTriangles[triangleIndex].vertices[0] = pPolygon->vertices[0].vertex;
+        pTriangles[triangleIndex].vertices[1] = pPolygon->vertices[triangleIndex + 1u].vertex;
+        pTriangles[triangleIndex].vertices[2] = pPolygon->vertices[triangleIndex + 2u].vertex;
+    }
+
     return true;
 }
 
-bool k15_create_software_rasterizer_context(software_rasterizer_context_t** pOutContextPtr, const software_rasterizer_context_init_parameters_t* pParameters)
+//FK: Outcodes get computed for 8 triangles at a time. Triangles that are inside of all clip planes get copied as is,
+//    the (rare) rest gets clipped as a polygon against the planes it intersects.
+internal bool _k15_clip_triangles(draw_call_triangles_t* pDrawCallTriangles, dynamic_buffer_t<triangle_t>* pClippedTriangles, vector2f_t guardBandScale)
 {
-    software_rasterizer_context_t* pContext = (software_rasterizer_context_t*)malloc(sizeof(software_rasterizer_context_t));
-    pContext->backBufferHeight              = pParameters->backBufferHeight;
-    pContext->backBufferWidth               = pParameters->backBufferWidth;
-    pContext->colorBufferStride             = pParameters->colorBufferStride;
-    pContext->depthBufferStride             = pParameters->depthBufferStride;
-    pContext->redShift                      = pParameters->redShift;
-    pContext->greenShift                    = pParameters->greenShift;
-    pContext->blueShift                     = pParameters->blueShift;
-    pContext->currentColorBufferIndex       = 0;
-    pContext->currentTriangleVertexIndex    = 0;
-    pContext->pBoundVertexBuffer            = nullptr;
-    pContext->pBoundVertexShader            = nullptr;
-    pContext->pBoundPixelShader             = nullptr;
+    const uint32_t clippedTrianglesCountStart = pClippedTriangles->count;
 
-    if(!_k15_create_font(&pContext->font))
+    const triangle_t* pTriangles = pDrawCallTriangles->pTriangles;
+    const uint32_t triangleCount = pDrawCallTriangles->triangleCount;
+
+    vector4f_t clipPlanes[ClipPlaneCount];
+    _k15_get_clip_planes(clipPlanes, guardBandScale);
+
+    const __m256i laneIndices = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    const __m256 guardBandX = _mm256_set1_ps(guardBandScale.x);
+    const __m256 guardBandY = _mm256_set1_ps(guardBandScale.y);
+
+    for(uint32_t triangleIndex = 0; triangleIndex < triangleCount; triangleIndex += 8u)
+    {
+        const uint32_t batchTriangleCount = get_min(8u, triangleCount - triangleIndex);
+
+        //FK: Unused lanes get the last triangle of the batch, their result gets masked out
+        const __m256i triangleIndices = _mm256_min_epi32(_mm256_add_epi32(_mm256_set1_epi32(triangleIndex), laneIndices), _mm256_set1_epi32(triangleCount - 1u));
+
+        __m256 outsideClipPlane[ClipPlaneCount];
+        __m256 allOutsideClipPlane[ClipPlaneCount];
+        for(uint32_t vertexIndex = 0; vertexIndex < 3u; ++vertexIndex)
+        {
+            const __m256 x = _k15_gather_triangle_position_component(pTriangles, triangleIndices, vertexIndex, 0u);
+            const __m256 y = _k15_gather_triangle_position_component(pTriangles, triangleIndices, vertexIndex, 1u);
+            const __m256 z = _k15_gather_triangle_position_component(pTriangles, triangleIndices, vertexIndex, 2u);
+            const __m256 w = _k15_gather_triangle_position_component(pTriangles, triangleIndices, vertexIndex, 3u);
+
+            const __m256 guardBandW = _mm256_mul_ps(guardBandX, w);
+            const __m256 guardBandH = _mm256_mul_ps(guardBandY, w);
+            const __m256 negW = _mm256_sub_ps(_mm256_setzero_ps(), w);
+
+            const __m256 vertexOutsideClipPlane[ClipPlaneCount] = {
+                _mm256_cmp_ps(x, _mm256_sub_ps(_mm256_setzero_ps(), guardBandW), _CMP_LT_OQ),
+                _mm256_cmp_ps(x, guardBandW, _CMP_GT_OQ),
+                _mm256_cmp_ps(y, _mm256_sub_ps(_mm256_setzero_ps(), guardBandH), _CMP_LT_OQ),
+                _mm256_cmp_ps(y, guardBandH, _CMP_GT_OQ),
+                _mm256_cmp_ps(z, negW, _CMP_LT_OQ),
+                _mm256_cmp_ps(z, w, _CMP_GT_OQ)
+            };
+
+            for(uint32_t clipPlaneIndex = 0; clipPlaneIndex < ClipPlaneCount; ++clipPlaneIndex)
+            {
+                outsideClipPlane[clipPlaneIndex]    = vertexIndex == 0u ? vertexOutsideClipPlane[clipPlaneIndex] : _mm256_or_ps(outsideClipPlane[clipPlaneIndex], vertexOutsideClipPlane[clipPlaneIndex]);
+                allOutsideClipPlane[clipPlaneIndex] = vertexIndex == 0u ? vertexOutsideClipPlane[clipPlaneIndex] : _mm256_and_ps(allOutsideClipPlane[clipPlaneIndex], vertexOutsideClipPlane[clipPlaneIndex]);
+            }
+        }
+
+        uint32_t clipPlaneBitMasks[ClipPlaneCount];
+        uint32_t clipBitMask = 0u;
+        uint32_t rejectBitMask = 0u;
+        for(uint32_t clipPlaneIndex = 0; clipPlaneIndex < ClipPlaneCount; ++clipPlaneIndex)
+        {
+            clipPlaneBitMasks[clipPlaneIndex] = (uint32_t)_mm256_movemask_ps(outsideClipPlane[clipPlaneIndex]);
+            clipBitMask |= clipPlaneBitMasks[clipPlaneIndex];
+            rejectBitMask |= (uint32_t)_mm256_movemask_ps(allOutsideClipPlane[clipPlaneIndex]);
+        }
+
+        const uint32_t batchBitMask = ( 1u << batchTriangleCount ) - 1u;
+        if( ( clipBitMask & batchBitMask ) == 0u )
+        {
+            if( _k15_dynamic_buffer_push_back(pClippedTriangles, pTriangles + triangleIndex, batchTriangleCount) == nullptr )
+            {
+                return false;
+            }
+            continue;
+        }
+
+        for(uint32_t laneIndex = 0; laneIndex < batchTriangleCount; ++laneIndex)
+        {
+            const triangle_t* pTriangle = pTriangles + triangleIndex + laneIndex;
+            const uint32_t laneBit = 1u << laneIndex;
+            if( rejectBitMask & laneBit )
+            {
+                continue;
+            }
+
+            if( ( clipBitMask & laneBit ) == 0u )
+            {
+                if( _k15_dynamic_buffer_push_back(pClippedTriangles, *pTriangle) == nullptr )
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            uint32_t clipPlaneMask = 0u;
+            for(uint32_t clipPlaneIndex = 0; clipPlaneIndex < ClipPlaneCount; ++clipPlaneIndex)
+            {
+                clipPlaneMask |= ( ( clipPlaneBitMasks[clipPlaneIndex] >> laneIndex ) & 1u ) << clipPlaneIndex;
+            }
+
+            if( !_k15_clip_triangle(pTriangle, clipPlanes, clipPlaneMask, pClippedTriangles) )
+            {
+                return false;
+            }
+        }
+    }
+
+    const uint32_t clippedTrianglesCountEnd = pClippedTriangles->count;
+
+    pDrawCallTriangles->pTriangles = pClippedTriangles->pData + clippedTrianglesCountStart;
+    pDrawCallTriangles->triangleCount = clippedTrianglesCountEnd - clippedTrianglesCountStart;
+
+    return true;
+}
+
+internal bool _k15_project_triangles_into_screenspace(draw_call_triangles_t* pDrawCallTriangles, dynamic_buffer_t<screenspace_triangle_t>* pScreenspaceTriangleBuffer, uint32_t backBufferWidth, uint32_t backBufferHeight)
+{
+    pDrawCallTriangles->pScreenspaceTriangles = _k15_dynamic_buffer_push_back(pScreenspaceTriangleBuffer, pDrawCallTriangles->triangleCount);
+    if( pDrawCallTriangles->pScreenspaceTriangles == nullptr )
     {
         return false;
     }
 
-    pContext->settings.backFaceCullingEnabled = 1;
-    for(uint8_t colorBufferIndex = 0; colorBufferIndex < pParameters->colorBufferCount; ++colorBufferIndex)
+    pDrawCallTriangles->screenspaceTriangleCount = pDrawCallTriangles->triangleCount;
+
+    const float width   = (float)(backBufferWidth-1u);
+    const float height  = (float)(backBufferHeight-1u);
+    screenspace_triangle_t* pScreenspaceTriangles = pDrawCallTriangles->pScreenspaceTriangles;
+
+    for(uint32_t triangleIndex = 0; triangleIndex < pDrawCallTriangles->screenspaceTriangleCount; ++triangleIndex)
     {
-        pContext->pColorBuffer[colorBufferIndex] = pParameters->pColorBuffers[colorBufferIndex];
+        triangle_t* pTriangle = pDrawCallTriangles->pTriangles + triangleIndex;
+
+        memcpy(pScreenspaceTriangles[triangleIndex].vertices, pTriangle->vertices, sizeof(pTriangle->vertices));
+
+        pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[0].x = (((1.0f + pTriangle->vertices[0].position.x / pTriangle->vertices[0].position.w) / 2.0f) * width);
+        pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[0].y = (((1.0f + pTriangle->vertices[0].position.y / pTriangle->vertices[0].position.w) / 2.0f) * height);
+        pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[0].z = pTriangle->vertices[0].position.z / pTriangle->vertices[0].position.w;
+
+        pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[1].x = (((1.0f + pTriangle->vertices[1].position.x / pTriangle->vertices[1].position.w) / 2.0f) * width);
+        pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[1].y = (((1.0f + pTriangle->vertices[1].position.y / pTriangle->vertices[1].position.w) / 2.0f) * height);
+        pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[1].z = pTriangle->vertices[1].position.z / pTriangle->vertices[1].position.w;
+
+        pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[2].x = (((1.0f + pTriangle->vertices[2].position.x / pTriangle->vertices[2].position.w) / 2.0f) * width);
+        pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[2].y = (((1.0f + pTriangle->vertices[2].position.y / pTriangle->vertices[2].position.w) / 2.0f) * height);
+        pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[2].z = pTriangle->vertices[2].position.z / pTriangle->vertices[2].position.w;
+
+        pScreenspaceTriangles[triangleIndex].fixedPointVertexPositions[0] = _k15_snap_to_sub_pixel(pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[0]);
+        pScreenspaceTriangles[triangleIndex].fixedPointVertexPositions[1] = _k15_snap_to_sub_pixel(pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[1]);
+        pScreenspaceTriangles[triangleIndex].fixedPointVertexPositions[2] = _k15_snap_to_sub_pixel(pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[2]);
+
+        pScreenspaceTriangles[triangleIndex].oneOverW[0] = 1.0f / pTriangle->vertices[0].position.w;
+        pScreenspaceTriangles[triangleIndex].oneOverW[1] = 1.0f / pTriangle->vertices[1].position.w;
+        pScreenspaceTriangles[triangleIndex].oneOverW[2] = 1.0f / pTriangle->vertices[2].position.w;
+
+        //FK: Vertices in the guard band can be outside of the screen, the bounding box gets clamped to the screen (scissor)
+        const float minX = get_min(pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[0].x, get_min(pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[1].x, pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[2].x));
+        const float maxX = get_max(pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[0].x, get_max(pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[1].x, pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[2].x));
+        const float minY = get_min(pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[0].y, get_min(pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[1].y, pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[2].y));
+        const float maxY = get_max(pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[0].y, get_max(pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[1].y, pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[2].y));
+
+        pScreenspaceTriangles[triangleIndex].boundingBox.x1 = float_to_uint32(get_min(width, (get_max(0.0f, minX))));
+        pScreenspaceTriangles[triangleIndex].boundingBox.x2 = float_to_uint32(get_min(width, (get_max(0.0f, maxX))));
+        pScreenspaceTriangles[triangleIndex].boundingBox.y1 = float_to_uint32(get_min(height, (get_max(0.0f, minY))));
+        pScreenspaceTriangles[triangleIndex].boundingBox.y2 = float_to_uint32(get_min(height, (get_max(0.0f, maxY))));
+
+        pScreenspaceTriangles[triangleIndex].boundingBox.x2 = get_min((uint32_t)width, pScreenspaceTriangles[triangleIndex].boundingBox.x2 + 1u);
+        pScreenspaceTriangles[triangleIndex].boundingBox.y2 = get_min((uint32_t)height, pScreenspaceTriangles[triangleIndex].boundingBox.y2 + 1u);
+    }
+    
+    return true;
+}
+
+void k15_draw_text(uint8_t* pColorBuffer, const bitmap_font_t* pFont, uint32_t colorBufferWidth, uint32_t colorBufferHeight, uint32_t colorBufferStride, int32_t x, int32_t y, const char* pText)
+{
+    RuntimeAssert(pFont->channels == 3);
+
+    const uint32_t charPixelWidth = 16;
+    const uint32_t charPixelHeight = 16;
+    const uint32_t textLength = (uint32_t)strlen(pText);
+    const uint32_t fontBitmapWidth = pFont->width;
+    const char* pTextEnd = pText + textLength;
+    const char* pTextRunning = pText;
+    uint32_t colorBufferPixelX = x;
+
+    while( pTextRunning != pTextEnd )
+    {
+        const uint32_t charIndex = (uint32_t)(pTextRunning - pText);
+        const char charToDraw = *pTextRunning++;
+
+        const uint32_t charPixelStartX = ( charPixelWidth * charToDraw ) & 0xFF;
+        const uint32_t charPixelStartY = ( ( charPixelWidth * charToDraw ) / 0xFF ) * charPixelHeight;
+        const uint32_t charPixelEndX = get_min( colorBufferWidth, charPixelStartX + 16 );
+        const uint32_t charPixelEndY = get_min( colorBufferHeight, charPixelStartY + 16 );
+
+        uint32_t charPixelY = charPixelStartY;
+        uint32_t charPixelX = charPixelStartX;
+        uint32_t colorBufferPixelY = y;
+
+        while( charPixelY < charPixelEndY )
+        {
+            charPixelX = charPixelStartX;
+            colorBufferPixelX = x + charIndex * charPixelWidth;
+            while( charPixelX < charPixelEndX )
+            {
+                const uint32_t colorBufferIndex = ( colorBufferPixelX + colorBufferPixelY * colorBufferStride ) * 4;
+                const uint32_t fontBufferIndex = ( charPixelX + charPixelY * fontBitmapWidth ) * 3;
+                pColorBuffer[colorBufferIndex + 0] = pFont->pRGBPixels[fontBufferIndex + 0];
+                pColorBuffer[colorBufferIndex + 1] = pFont->pRGBPixels[fontBufferIndex + 1];
+                pColorBuffer[colorBufferIndex + 2] = pFont->pRGBPixels[fontBufferIndex + 2];
+                pColorBuffer[colorBufferIndex + 3] = 0xFF;
+
+                ++charPixelX;
+                ++colorBufferPixelX;
+            }
+            
+            ++charPixelY;
+            ++colorBufferPixelY;
+        }
     }
+}
+
+void k15_draw_text_formatted(uint8_t* pColorBuffer, const bitmap_font_t* pFont, uint32_t colorBufferWidth, uint32_t colorBufferHeight, uint32_t colorBufferStride, int32_t x, int32_t y, const char* pText, ...)
+{
+    char textBuffer[512];
+
+    va_list args;
+    va_start(args, pText);
+    vsprintf(textBuffer, pText, args);
+    va_end(args);
+
+    k15_draw_text(pColorBuffer, pFont, colorBufferWidth, colorBufferHeight, colorBufferStride, x, y, textBuffer);
+}
 
-    for(uint8_t colorBufferIndex = 0; colorBufferIndex < pParameters->colorBufferCount; ++colorBufferIndex)
-    {
-        pContext->pDepthBuffer[colorBufferIndex] = pParameters->pDepthBuffers[colorBufferIndex];
-    }
+//FK: Vertices of non-indexed draw calls are already in triangle order, their streams get copied as a whole
+internal void _k15_transform_vertices(shading_context_t* pShadingContext, const draw_call_t* pDrawCall, uint32_t firstTriangleIndex, uint32_t triangleCount)
+{
+    RuntimeAssert(triangleCount <= GeometryJobTriangleCount);
 
-    pContext->colorBufferCount = pParameters->colorBufferCount;
+    vertex_shader_input_t* pVertexShaderInput = &pShadingContext->vertexShaderInput;
+    const uint32_t vertexCount = triangleCount * 3u;
 
-    if(!_k15_create_dynamic_buffer<triangle_t>(&pContext->triangles, DefaultTriangleBufferCapacity))
-    {
-        return false;
-    }
+    _k15_copy_vertex_streams(pVertexShaderInput, 0u, &pDrawCall->pVertexBuffer->streams, pDrawCall->vertexOffset + firstTriangleIndex * 3u, vertexCount);
+    pDrawCall->vertexShader(pVertexShaderInput, vertexCount, pDrawCall->pUniformBufferData);
+}
 
-    if(!_k15_create_dynamic_buffer<triangle_t>(&pContext->visibleTriangles, DefaultTriangleBufferCapacity))
+internal void _k15_fetch_indices(uint32_t* pOutIndices, const index_buffer_t* pIndexBuffer, uint32_t firstIndex, uint32_t indexCount)
+{
+    if( pIndexBuffer->format == index_format_t::uint16 )
     {
-        return false;
+        const uint16_t* pIndices = (const uint16_t*)pIndexBuffer->pData + firstIndex;
+        for(uint32_t index = 0u; index < indexCount; ++index)
+        {
+            pOutIndices[index] = pIndices[index];
+        }
     }
-
-    if(!_k15_create_dynamic_buffer<triangle_t>(&pContext->clippedTriangles, DefaultTriangleBufferCapacity))
+    else
     {
-        return false;
+        const uint32_t* pIndices = (const uint32_t*)pIndexBuffer->pData + firstIndex;
+        memcpy(pOutIndices, pIndices, sizeof(uint32_t) * indexCount);
     }
+}
 
-    if(!_k15_create_dynamic_buffer<vertex_buffer_t>(&pContext->vertexBuffers, DefaultVertexBufferCapacity))
-    {
-        return false;
-    }
+//FK: Replaces every vertex index in pIndexSlots with its post transform cache slot, returns the number of unique vertices
+internal uint32_t _k15_assign_post_transform_cache_slots(post_transform_cache_t* pPostTransformCache, uint32_t indexCount)
+{
+    constexpr uint32_t HashTableMask = PostTransformCacheHashTableSize - 1u;
+    CompiletimeAssert(( PostTransformCacheHashTableSize & HashTableMask ) == 0u);
+    CompiletimeAssert(PostTransformCacheHashTableSize > GeometryJobIndexCount);
 
-    if(!_k15_create_dynamic_buffer<screenspace_triangle_t>(&pContext->screenspaceTriangles, DefaultTriangleBufferCapacity))
-    {
-        return false;
-    }
+    memset(pPostTransformCache->pHashTableVertexIndices, 0xFF, sizeof(uint32_t) * PostTransformCacheHashTableSize);
 
-    if(!_k15_create_dynamic_buffer<texture_t>(&pContext->textures, DefaultTextureCapacity))
+    uint32_t uniqueVertexCount = 0u;
+    for(uint32_t index = 0u; index < indexCount; ++index)
     {
-        return false;
-    }
+        const uint32_t vertexIndex = pPostTransformCache->pIndexSlots[index];
 
-    if(!_k15_create_dynamic_buffer<draw_call_t>(&pContext->drawCalls, DefaultDrawCallCapacity))
-    {
-        return false;
-    }
+        //FK: Knuth multiplicative hash, linear probing
+        uint32_t hashTableIndex = ( vertexIndex * 2654435761u ) & HashTableMask;
+        while( pPostTransformCache->pHashTableVertexIndices[hashTableIndex] != vertexIndex &&
+               pPostTransformCache->pHashTableVertexIndices[hashTableIndex] != InvalidVertexIndex )
+        {
+            hashTableIndex = ( hashTableIndex + 1u ) & HashTableMask;
+        }
 
-    if(!_k15_create_dynamic_buffer<vertex_shader_t>(&pContext->vertexShaders, DefaultShaderCapacity))
-    {
-        return false;
-    }
+        if( pPostTransformCache->pHashTableVertexIndices[hashTableIndex] == InvalidVertexIndex )
+        {
+            pPostTransformCache->pHashTableVertexIndices[hashTableIndex]    = vertexIndex;
+            pPostTransformCache->pHashTableSlots[hashTableIndex]            = uniqueVertexCount;
+            pPostTransformCache->pUniqueVertexIndices[uniqueVertexCount]    = vertexIndex;
+            ++uniqueVertexCount;
+        }
 
-    if(!_k15_create_dynamic_buffer<pixel_shader_t>(&pContext->pixelShaders, DefaultShaderCapacity))
-    {
-        return false;
+        pPostTransformCache->pIndexSlots[index] = pPostTransformCache->pHashTableSlots[hashTableIndex];
     }
 
-    if(!_k15_create_dynamic_buffer<uniform_buffer_t>(&pContext->uniformBuffers, DefaultVertexBufferCapacity))
-    {
-        return false;
-    }
+    return uniqueVertexCount;
+}
 
-    if(!_k15_create_block_allocator(&pContext->pUniformDataAllocator))
-    {
-        return false;
-    }
+//FK: Expects the untransformed vertices of the job (vertexCount per instance) at the start of the vertex streams.
+//    They only get fetched from the vertex buffer once, every other instance replicates them from there and is written
+//    behind the vertices of instance n-1. Each instance gets its own vertex shader call, instances are transformed in
+//    reverse order so that the vertices of the first instance stay untransformed until they have been replicated.
+internal void _k15_transform_instances(shading_context_t* pShadingContext, const draw_call_t* pDrawCall, uint32_t vertexCount, uint32_t firstInstanceIndex, uint32_t instanceCount)
+{
+    RuntimeAssert(vertexCount * instanceCount <= GeometryJobIndexCount);
 
-    if(!_k15_create_stack_allocator(&pContext->pDrawCallDataAllocator, DefaultUniformDataStackAllocatorSizeInBytes))
-    {
-        return false;
-    }
+    vertex_shader_input_t* pVertexShaderInput = &pShadingContext->vertexShaderInput;
+    const instance_buffer_t* pInstanceBuffer = pDrawCall->pInstanceBuffer;
+    const vertex_streams_t* pVertexBufferStreams = &pDrawCall->pVertexBuffer->streams;
 
-    if(!_k15_create_barycentric_coordinate_buffer(&pContext->barycentricCoordinatesBuffer, PixelShaderInputCount))
-    {
-        return false;
-    }
+    //FK: Same streams as the vertex buffer but pointing to the fetched vertices
+    vertex_streams_t fetchedVertexStreams;
+    fetchedVertexStreams.pPositions = pVertexShaderInput->positions;
+    fetchedVertexStreams.pNormals   = pVertexBufferStreams->pNormals != nullptr ? pVertexShaderInput->normals : nullptr;
+    fetchedVertexStreams.pColors    = pVertexBufferStreams->pColors != nullptr ? pVertexShaderInput->colors : nullptr;
+    fetchedVertexStreams.pTexcoords = pVertexBufferStreams->pTexcoords != nullptr ? pVertexShaderInput->texcoords : nullptr;
 
-    if(!_k15_create_pixel_shader_input_buffers(&pContext->bufferedPixelShaderInput, PixelShaderInputCount))
+    for( uint32_t instanceIndex = instanceCount; instanceIndex-- > 0u; )
     {
-        return false;
-    }
+        const uint32_t instanceId = firstInstanceIndex + instanceIndex;
+        const uint32_t instanceVertexOffset = instanceIndex * vertexCount;
+        if( instanceIndex > 0u )
+        {
+            _k15_copy_vertex_streams(pVertexShaderInput, instanceVertexOffset, &fetchedVertexStreams, 0u, vertexCount);
+        }
 
-    if(!_k15_create_pixel_shader_output_buffers(&pContext->bufferedPixelShaderOutput, PixelShaderInputCount))
-    {
-        return false;
+        vertex_shader_input_t instanceVertexShaderInput;
+        instanceVertexShaderInput.positions     = pVertexShaderInput->positions + instanceVertexOffset;
+        instanceVertexShaderInput.normals       = pVertexShaderInput->normals + instanceVertexOffset;
+        instanceVertexShaderInput.colors        = pVertexShaderInput->colors + instanceVertexOffset;
+        instanceVertexShaderInput.texcoords     = pVertexShaderInput->texcoords + instanceVertexOffset;
+        instanceVertexShaderInput.instanceId    = instanceId;
+        instanceVertexShaderInput.pInstanceData = pInstanceBuffer != nullptr ? pInstanceBuffer->pData + instanceId * pInstanceBuffer->strideInBytes : nullptr;
+
+        pDrawCall->vertexShader(&instanceVertexShaderInput, vertexCount, pDrawCall->pUniformBufferData);
     }
+}
 
-    pContext->bufferedPixelShaderOutput.pScreenspaceX = pContext->bufferedPixelShaderInput.pScreenspaceX;
-    pContext->bufferedPixelShaderOutput.pScreenspaceY = pContext->bufferedPixelShaderInput.pScreenspaceY;
+//FK: Instanced counterpart of _k15_transform_vertices
+internal void _k15_transform_instanced_vertices(shading_context_t* pShadingContext, const draw_call_t* pDrawCall, uint32_t firstTriangleIndex, uint32_t triangleCount, uint32_t firstInstanceIndex, uint32_t instanceCount)
+{
+    RuntimeAssert(triangleCount * instanceCount <= GeometryJobTriangleCount);
 
-    *pOutContextPtr = pContext;
-    return true;
+    const uint32_t vertexCount = triangleCount * 3u;
+    _k15_copy_vertex_streams(&pShadingContext->vertexShaderInput, 0u, &pDrawCall->pVertexBuffer->streams, pDrawCall->vertexOffset + firstTriangleIndex * 3u, vertexCount);
+    _k15_transform_instances(pShadingContext, pDrawCall, vertexCount, firstInstanceIndex, instanceCount);
 }
 
-void k15_swap_color_buffers(software_rasterizer_context_t* pContext)
+//FK: Indexed counterpart of _k15_transform_vertices.
+//    Every unique vertex of the job gets transformed once per instance and is then shared by all triangles referencing it.
+//    Indices are relative to the draw call's base vertex (vertexOffset).
+//    Returns the post transform cache slot of every index of the job, the slots of instance n follow the slots of instance n-1.
+internal const uint32_t* _k15_transform_indexed_vertices(shading_context_t* pShadingContext, const draw_call_t* pDrawCall, uint32_t firstTriangleIndex, uint32_t triangleCount, uint32_t firstInstanceIndex, uint32_t instanceCount)
 {
-    if(pContext->colorBufferCount == 1u)
+    RuntimeAssert(triangleCount * instanceCount <= GeometryJobTriangleCount);
+
+    post_transform_cache_t* pPostTransformCache = &pShadingContext->postTransformCache;
+    vertex_shader_input_t* pVertexShaderInput = &pShadingContext->vertexShaderInput;
+    const uint32_t indexCount = triangleCount * 3u;
+
+    _k15_fetch_indices(pPostTransformCache->pIndexSlots, pDrawCall->pIndexBuffer, pDrawCall->indexOffset + firstTriangleIndex * 3u, indexCount);
+    const uint32_t uniqueVertexCount = _k15_assign_post_transform_cache_slots(pPostTransformCache, indexCount);
+
+    _k15_gather_vertex_streams(pVertexShaderInput, &pDrawCall->pVertexBuffer->streams, pDrawCall->vertexOffset, pPostTransformCache->pUniqueVertexIndices, uniqueVertexCount);
+    _k15_transform_instances(pShadingContext, pDrawCall, uniqueVertexCount, firstInstanceIndex, instanceCount);
+
+    for( uint32_t instanceIndex = 1u; instanceIndex < instanceCount; ++instanceIndex )
     {
-        return;
+        uint32_t* pInstanceIndexSlots = pPostTransformCache->pIndexSlots + instanceIndex * indexCount;
+        const uint32_t instanceSlotOffset = instanceIndex * uniqueVertexCount;
+        for( uint32_t index = 0u; index < indexCount; ++index )
+        {
+            pInstanceIndexSlots[index] = pPostTransformCache->pIndexSlots[index] + instanceSlotOffset;
+        }
     }
 
-    const uint8_t newColorBufferIndex = ++pContext->currentColorBufferIndex % pContext->colorBufferCount;
-    pContext->currentColorBufferIndex = newColorBufferIndex;
+    return pPostTransformCache->pIndexSlots;
 }
 
-matrix4x4f_t _k15_mul_matrix4x4f(const matrix4x4f_t* restrict_modifier pMatA, const matrix4x4f_t* restrict_modifier pMatB)
+internal bool _k15_process_geometry(geometry_job_t* pGeometryJob, shading_context_t* pShadingContext)
 {
-    matrix4x4f_t mat = {};
-    mat.m00 = pMatA->m00 * pMatB->m00 + pMatA->m01 * pMatB->m10 + pMatA->m02 * pMatB->m20 + pMatA->m03 * pMatB->m30;
-    mat.m01 = pMatA->m00 * pMatB->m01 + pMatA->m01 * pMatB->m11 + pMatA->m02 * pMatB->m21 + pMatA->m03 * pMatB->m31;
-    mat.m02 = pMatA->m00 * pMatB->m02 + pMatA->m01 * pMatB->m12 + pMatA->m02 * pMatB->m22 + pMatA->m03 * pMatB->m32;
-    mat.m03 = pMatA->m00 * pMatB->m03 + pMatA->m01 * pMatB->m13 + pMatA->m02 * pMatB->m23 + pMatA->m03 * pMatB->m33;
-
-    mat.m10 = pMatA->m10 * pMatB->m00 + pMatA->m11 * pMatB->m10 + pMatA->m12 * pMatB->m20 + pMatA->m13 * pMatB->m30;
-    mat.m11 = pMatA->m10 * pMatB->m01 + pMatA->m11 * pMatB->m11 + pMatA->m12 * pMatB->m21 + pMatA->m13 * pMatB->m31;
-    mat.m12 = pMatA->m10 * pMatB->m02 + pMatA->m11 * pMatB->m12 + pMatA->m12 * pMatB->m22 + pMatA->m13 * pMatB->m32;
-    mat.m13 = pMatA->m10 * pMatB->m03 + pMatA->m11 * pMatB->m13 + pMatA->m12 * pMatB->m23 + pMatA->m13 * pMatB->m33;
+    const software_rasterizer_context_t* pContext = pGeometryJob->pContext;
 
-    mat.m20 = pMatA->m20 * pMatB->m00 + pMatA->m21 * pMatB->m10 + pMatA->m22 * pMatB->m20 + pMatA->m23 * pMatB->m30;
-    mat.m21 = pMatA->m20 * pMatB->m01 + pMatA->m21 * pMatB->m11 + pMatA->m22 * pMatB->m21 + pMatA->m23 * pMatB->m31;
-    mat.m22 = pMatA->m20 * pMatB->m02 + pMatA->m21 * pMatB->m12 + pMatA->m22 * pMatB->m22 + pMatA->m23 * pMatB->m32;
-    mat.m23 = pMatA->m20 * pMatB->m03 + pMatA->m21 * pMatB->m13 + pMatA->m22 * pMatB->m23 + pMatA->m23 * pMatB->m33;
+    pGeometryJob->visibleTriangles.count        = 0u;
+    pGeometryJob->clippedTriangles.count        = 0u;
+    pGeometryJob->screenspaceTriangles.count    = 0u;
 
-    mat.m30 = pMatA->m30 * pMatB->m00 + pMatA->m31 * pMatB->m10 + pMatA->m32 * pMatB->m20 + pMatA->m33 * pMatB->m30;
-    mat.m31 = pMatA->m30 * pMatB->m01 + pMatA->m31 * pMatB->m11 + pMatA->m32 * pMatB->m21 + pMatA->m33 * pMatB->m31;
-    mat.m32 = pMatA->m30 * pMatB->m02 + pMatA->m31 * pMatB->m12 + pMatA->m32 * pMatB->m22 + pMatA->m33 * pMatB->m32;
-    mat.m33 = pMatA->m30 * pMatB->m03 + pMatA->m31 * pMatB->m13 + pMatA->m32 * pMatB->m23 + pMatA->m33 * pMatB->m33;
+    const draw_call_t* pDrawCall = pGeometryJob->pDrawCall;
 
-    return mat;
-}
+    pShadingContext->vertexShaderInput.pInstanceData    = nullptr;
+    pShadingContext->vertexShaderInput.instanceId       = 0u;
 
-void k15_copy_transformed_triangle_vertices(const vertex_shader_input_t* pVertices, triangle_t* pTriangles, uint32_t triangleCount)
-{
-    for(uint32_t triangleIndex = 0u; triangleIndex < triangleCount; ++triangleIndex)
+    //FK: The transformed vertices stay in the vertex streams of the shading context until culling,
+    //    only the vertices of visible triangles get gathered into triangles.
+    const uint32_t* pVertexIndices = nullptr;
+    uint32_t triangleCount = pGeometryJob->triangleCount;
+    if( pDrawCall->pIndexBuffer != nullptr )
+    {
+        pVertexIndices = _k15_transform_indexed_vertices(pShadingContext, pDrawCall, pGeometryJob->firstTriangleIndex, pGeometryJob->triangleCount, pGeometryJob->firstInstanceIndex, pGeometryJob->instanceCount);
+        triangleCount *= pGeometryJob->instanceCount;
+    }
+    else if( pDrawCall->instanceCount > 1u || pDrawCall->pInstanceBuffer != nullptr )
     {
-        const uint32_t vertexIndex = triangleIndex * 3;
+        _k15_transform_instanced_vertices(pShadingContext, pDrawCall, pGeometryJob->firstTriangleIndex, pGeometryJob->triangleCount, pGeometryJob->firstInstanceIndex, pGeometryJob->instanceCount);
+        triangleCount *= pGeometryJob->instanceCount;
+    }
+    else
+    {
+        _k15_transform_vertices(pShadingContext, pDrawCall, pGeometryJob->firstTriangleIndex, pGeometryJob->triangleCount);
+    }
 
-        triangle_t* pTriangle = pTriangles + triangleIndex;
-        pTriangle->vertices[0].position = pVertices->positions[vertexIndex + 0];
-        pTriangle->vertices[1].position = pVertices->positions[vertexIndex + 1];
-        pTriangle->vertices[2].position = pVertices->positions[vertexIndex + 2];
-        pTriangle->vertices[0].normal = pVertices->normals[vertexIndex + 0];
-        pTriangle->vertices[1].normal = pVertices->normals[vertexIndex + 1];
-        pTriangle->vertices[2].normal = pVertices->normals[vertexIndex + 2];
-        pTriangle->vertices[0].color = pVertices->colors[vertexIndex + 0];
-        pTriangle->vertices[1].color = pVertices->colors[vertexIndex + 1];
-        pTriangle->vertices[2].color = pVertices->colors[vertexIndex + 2];
-        pTriangle->vertices[0].texcoord = pVertices->texcoords[vertexIndex + 0];
-        pTriangle->vertices[1].texcoord = pVertices->texcoords[vertexIndex + 1];
-        pTriangle->vertices[2].texcoord = pVertices->texcoords[vertexIndex + 2];
+    draw_call_triangles_t drawCallTriangles;
+    drawCallTriangles.pixelShader               = pDrawCall->pixelShader;
+    drawCallTriangles.vertexShader              = pDrawCall->vertexShader;
+    drawCallTriangles.pUniformData              = pDrawCall->pUniformBufferData;
+    drawCallTriangles.attributeMask             = pDrawCall->attributeMask;
+    drawCallTriangles.pixelShaderInputLayout    = pDrawCall->pixelShaderInputLayout;
+    drawCallTriangles.pTriangles                = nullptr;
+    drawCallTriangles.triangleCount             = 0u;
+    drawCallTriangles.pScreenspaceTriangles     = nullptr;
+    drawCallTriangles.screenspaceTriangleCount  = 0u;
+
+    if(!_k15_cull_triangles(&drawCallTriangles, &pShadingContext->vertexShaderInput, pVertexIndices, triangleCount, &pGeometryJob->visibleTriangles, pContext->settings.backFaceCullingEnabled))
+    {
+        return false;
     }
-}
 
-void k15_copy_vertices_for_vertex_shader(vertex_shader_input_t* pTriangleVertices, const triangle_t* pTriangles, const uint32_t triangleCount)
-{
-    for( uint32_t triangleIndex = 0; triangleIndex < triangleCount; ++triangleIndex )
+    //FK: None of the triangles of a draw call whose bounds are inside of the frustum can intersect a frustum plane
+    const vector2f_t guardBandScale = _k15_get_guard_band_scale(pContext->backBufferWidth, pContext->backBufferHeight);
+    if( pDrawCall->frustumCoverage != frustum_coverage_t::inside && !_k15_clip_triangles(&drawCallTriangles, &pGeometryJob->clippedTriangles, guardBandScale) )
     {
-        const uint32_t vertexIndex = triangleIndex * 3;
-        pTriangleVertices->positions[vertexIndex + 0] = pTriangles[triangleIndex].vertices[0].position;
-        pTriangleVertices->positions[vertexIndex + 1] = pTriangles[triangleIndex].vertices[1].position;
-        pTriangleVertices->positions[vertexIndex + 2] = pTriangles[triangleIndex].vertices[2].position;
-        pTriangleVertices->normals[vertexIndex + 0] = pTriangles[triangleIndex].vertices[0].normal;
-        pTriangleVertices->normals[vertexIndex + 1] = pTriangles[triangleIndex].vertices[1].normal;
-        pTriangleVertices->normals[vertexIndex + 2] = pTriangles[triangleIndex].vertices[2].normal;
-        pTriangleVertices->colors[vertexIndex + 0] = pTriangles[triangleIndex].vertices[0].color;
-        pTriangleVertices->colors[vertexIndex + 1] = pTriangles[triangleIndex].vertices[1].color;
-        pTriangleVertices->colors[vertexIndex + 2] = pTriangles[triangleIndex].vertices[2].color;
-        pTriangleVertices->texcoords[vertexIndex + 0] = pTriangles[triangleIndex].vertices[0].texcoord;
-        pTriangleVertices->texcoords[vertexIndex + 1] = pTriangles[triangleIndex].vertices[1].texcoord;
-        pTriangleVertices->texcoords[vertexIndex + 2] = pTriangles[triangleIndex].vertices[2].texcoord;
+        return false;
     }
+
+    return _k15_project_triangles_into_screenspace(&drawCallTriangles, &pGeometryJob->screenspaceTriangles, pContext->backBufferWidth, pContext->backBufferHeight);
 }
 
-void _k15_transform_vertices(draw_call_triangles_t* pDrawCallTriangles)
+internal void _k15_process_geometry_job(void* pJobData, uint32_t workerIndex)
 {
-    vertex_shader_fnc_t vertexShader = pDrawCallTriangles->vertexShader;
-    void* pUniformData = pDrawCallTriangles->pUniformData;
+    geometry_job_t* pGeometryJob = (geometry_job_t*)pJobData;
+    shading_context_t* pShadingContext = pGeometryJob->pContext->pShadingContexts + workerIndex;
 
-    constexpr uint32_t TrianglesPerVertexShaderCount = VertexShaderInputCount / 3;
-    static_buffer_t<vertex_shader_input_t, VertexShaderInputCount> vertices = {};
-    static_buffer_t<triangle_t, TrianglesPerVertexShaderCount> triangles = {};
+    pGeometryJob->succeeded = _k15_process_geometry(pGeometryJob, pShadingContext);
+}
 
-    for( uint32_t triangleIndex = 0; triangleIndex < pDrawCallTriangles->triangleCount; triangleIndex += TrianglesPerVertexShaderCount )
+internal geometry_job_t* _k15_push_geometry_job(software_rasterizer_context_t* pContext, uint32_t* pGeometryJobCount)
+{
+    //FK: Jobs keep their triangle buffers alive between frames, only create buffers for jobs that didn't exist yet
+    if( *pGeometryJobCount == pContext->geometryJobs.count )
     {
-        const uint32_t triangleCount = get_min(TrianglesPerVertexShaderCount, pDrawCallTriangles->triangleCount - triangleIndex);
-        const uint32_t vertexCount = triangleCount * 3;
-        triangle_t* pVertexShaderTriangles = _k15_static_buffer_push_back(&triangles, triangleCount);
-        triangle_t* pTriangles = pDrawCallTriangles->pTriangles + triangleIndex;
-        memcpy(pVertexShaderTriangles, pTriangles, triangleCount * sizeof(triangle_t));
-
-        vertex_shader_input_t* pTriangleVertices = _k15_static_buffer_push_back(&vertices, vertexCount);
-        k15_copy_vertices_for_vertex_shader(pTriangleVertices, pVertexShaderTriangles, triangleCount);
+        geometry_job_t* pNewGeometryJob = _k15_dynamic_buffer_push_back(&pContext->geometryJobs, 1u);
+        if( pNewGeometryJob == nullptr )
+        {
+            return nullptr;
+        }
 
-        if(vertices.count == vertices.capacity || triangleCount < TrianglesPerVertexShaderCount)
+        if(!_k15_create_dynamic_buffer(&pNewGeometryJob->visibleTriangles, GeometryJobTriangleCount) ||
+           !_k15_create_dynamic_buffer(&pNewGeometryJob->clippedTriangles, GeometryJobTriangleCount) ||
+           !_k15_create_dynamic_buffer(&pNewGeometryJob->screenspaceTriangles, GeometryJobTriangleCount))
         {
-            vertexShader(pTriangleVertices, vertexCount, pUniformData);
-            k15_copy_transformed_triangle_vertices(pTriangleVertices, pTriangles, triangleCount);     
-            triangles.count = 0;
-            vertices.count = 0;
+            --pContext->geometryJobs.count;
+            return nullptr;
         }
     }
-}
-
-inline vector4f_t k15_vector4f_div(vector4f_t vector, float div)
-{
-    vector4f_t divVector = vector;
-    divVector.x = vector.x / div;
-    divVector.y = vector.y / div;
-    divVector.z = vector.z / div;
-    divVector.w = vector.w / div;
 
-    return divVector;
+    return pContext->geometryJobs.pData + (*pGeometryJobCount)++;
 }
 
-inline vector3f_t k15_vector3f_normalize(vector3f_t vector)
+//FK: Returns the most recent completed frame whose hi-z buffer matches the current back buffer or nullptr if there's none.
+//    Its hi-z buffer doesn't change until the geometry of pFrame has been processed: pFrame's own tiles haven't been
+//    rasterized yet and the other frames only get reused by the next k15_draw_frame.
+internal const frame_t* _k15_find_occlusion_frame(const software_rasterizer_context_t* pContext, const frame_t* pFrame)
 {
-    vector3f_t normalizedVector = {};
-    float vectorLength = sqrtf(vector.x * vector.x + vector.y * vector.y + vector.z * vector.z);
-    normalizedVector.x = vector.x / vectorLength;
-    normalizedVector.y = vector.y / vectorLength;
-    normalizedVector.z = vector.z / vectorLength;
-
-    return normalizedVector;
-}
+    const uint32_t hiZBufferWidth = ( pContext->backBufferWidth + RasterBlockSize - 1u ) / RasterBlockSize;
+    const uint32_t hiZBufferHeight = ( pContext->backBufferHeight + RasterBlockSize - 1u ) / RasterBlockSize;
 
-inline vector4f_t k15_vector4f_normalize(vector4f_t vector)
-{
-    vector4f_t normalizedVector = {};
-    float vectorLength = sqrtf(vector.x * vector.x + vector.y * vector.y + vector.z * vector.z + vector.w * vector.w);
-    normalizedVector.x = vector.x / vectorLength;
-    normalizedVector.y = vector.y / vectorLength;
-    normalizedVector.z = vector.z / vectorLength;
-    normalizedVector.w = vector.w / vectorLength;
+    const frame_t* pOcclusionFrame = nullptr;
+    for(uint32_t frameIndex = 0u; frameIndex < MaxFramesInFlight; ++frameIndex)
+    {
+        const frame_t* pOtherFrame = pContext->pFrames + frameIndex;
+        if( pOtherFrame->hiZFrameNumber == 0u || pOtherFrame->hiZBufferStride != hiZBufferWidth || pOtherFrame->hiZBufferHeight != hiZBufferHeight )
+        {
+            continue;
+        }
 
-    return normalizedVector;
-}
+        if( pOtherFrame != pFrame && !k15_are_jobs_finished(&pOtherFrame->jobCounter) )
+        {
+            continue;
+        }
 
-inline vector3f_t k15_vector3f_cross(vector3f_t a, vector3f_t b)
-{
-    vector3f_t crossVector = {};
-    crossVector.x = a.y * b.z - a.z * b.y;
-    crossVector.y = a.z * b.x - a.x * b.z;
-    crossVector.z = a.x * b.y - a.y * b.x;
+        if( pOcclusionFrame == nullptr || pOtherFrame->hiZFrameNumber > pOcclusionFrame->hiZFrameNumber )
+        {
+            pOcclusionFrame = pOtherFrame;
+        }
+    }
 
-    return crossVector;
+    return pOcclusionFrame;
 }
 
-inline vector4f_t k15_vector4f_cross(vector4f_t a, vector4f_t b)
+internal bool _k15_is_draw_call_occluded(const software_rasterizer_context_t* pContext, const frame_t* pOcclusionFrame, const occlusion_bounds_t* pBounds)
 {
-    vector4f_t crossVector = {};
-    crossVector.x = a.y * b.z - a.z * b.y;
-    crossVector.y = a.z * b.x - a.x * b.z;
-    crossVector.z = a.x * b.y - a.y * b.x;
-    crossVector.w = 0.0f; //TODO
+    //FK: Same mapping as _k15_project_triangles_into_screenspace
+    const float width   = (float)(pContext->backBufferWidth-1u);
+    const float height  = (float)(pContext->backBufferHeight-1u);
 
-    return crossVector;
-}
+    const float x1 = ( ( 1.0f + pBounds->min.x ) / 2.0f ) * width;
+    const float y1 = ( ( 1.0f + pBounds->min.y ) / 2.0f ) * height;
+    const float x2 = ( ( 1.0f + pBounds->max.x ) / 2.0f ) * width;
+    const float y2 = ( ( 1.0f + pBounds->max.y ) / 2.0f ) * height;
 
-float k15_vector4f_dot(vector4f_t a, vector4f_t b)
-{
-    const float dot = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
-    return dot;
-}
+    if( x2 < 0.0f || y2 < 0.0f || x1 > width || y1 > height )
+    {
+        //FK: Completely off screen
+        return true;
+    }
 
-vector4f_t k15_vector4f_sub(vector4f_t a, vector4f_t b)
-{
-    vector4f_t v = {};
-    v.x = a.x - b.x;
-    v.y = a.y - b.y;
-    v.z = a.z - b.z;
-    v.w = a.w - b.w;
+    const uint32_t pixelX1 = (uint32_t)(get_max(x1, 0.0f));
+    const uint32_t pixelY1 = (uint32_t)(get_max(y1, 0.0f));
+    const uint32_t pixelX2 = (uint32_t)(get_min(x2, width)) + 1u;
+    const uint32_t pixelY2 = (uint32_t)(get_min(y2, height)) + 1u;
 
-    return v;
+    const float hiZMinDepth = _k15_get_hi_z_min_depth(pOcclusionFrame->pHiZBuffer, pOcclusionFrame->hiZBufferStride, pixelX1, pixelY1, pixelX2, pixelY2);
+    return _k15_is_occluded_by_hi_z(pBounds->maxDepth, hiZMinDepth);
 }
 
-inline bool _k15_is_position_outside_frustum(const vector4f_t position)
+internal bool _k15_prepare_geometry_jobs(software_rasterizer_context_t* pContext, const frame_t* pFrame, uint32_t* pOutGeometryJobCount)
 {
-    const float posW = position.w;
-    const float negW = -position.w;
-    return position.z < negW || position.z > posW || 
-        position.y < negW || position.y > posW || 
-        position.x < negW || position.x > posW;
-}
+    const frame_t* pOcclusionFrame = _k15_find_occlusion_frame(pContext, pFrame);
 
-template<bool APPLY_BACKFACE_CULLING>
-bool k15_cull_outside_frustum_triangles(draw_call_triangles_t* pDrawCallTriangles, dynamic_buffer_t<triangle_t>* pCulledTriangleBuffer)
-{
-    const uint32_t startCulledTriangleCount = pCulledTriangleBuffer->count;
-    triangle_t* pTriangles = pDrawCallTriangles->pTriangles;
-    uint32_t numTrianglesCompletelyOutsideFrustum = 0;
-    for(uint32_t triangleIndex = 0; triangleIndex < pDrawCallTriangles->triangleCount; ++triangleIndex)
+    uint32_t geometryJobCount = 0u;
+    for(uint32_t drawCallIndex = 0; drawCallIndex < pFrame->drawCalls.count; ++drawCallIndex)
     {
-        const triangle_t* pTriangle = pTriangles + triangleIndex;
-        const bool triangleOutsideFrustum = _k15_is_position_outside_frustum(pTriangle->vertices[0].position) && 
-        _k15_is_position_outside_frustum(pTriangle->vertices[1].position) && 
-        _k15_is_position_outside_frustum(pTriangle->vertices[2].position);
-
-        if(!triangleOutsideFrustum)
+        const draw_call_t* pDrawCall = pFrame->drawCalls.pData + drawCallIndex;
+        if( pDrawCall->frustumCoverage == frustum_coverage_t::outside || pDrawCall->hasOcclusionBounds || pDrawCall->pOcclusionQueryResult != nullptr )
         {
-            if(APPLY_BACKFACE_CULLING)
+            //FK: Draw calls outside of the frustum get dropped before any of their vertices get transformed
+            const bool occluded = pDrawCall->frustumCoverage == frustum_coverage_t::outside ||
+                                  ( pDrawCall->hasOcclusionBounds && pOcclusionFrame != nullptr && _k15_is_draw_call_occluded(pContext, pOcclusionFrame, &pDrawCall->occlusionBounds) );
+            if( pDrawCall->pOcclusionQueryResult != nullptr )
             {
-                const vector4f_t a = k15_vector4f_div(pTriangle->vertices[0].position, pTriangle->vertices[0].position.w);
-                const vector4f_t b = k15_vector4f_div(pTriangle->vertices[1].position, pTriangle->vertices[1].position.w);
-                const vector4f_t c = k15_vector4f_div(pTriangle->vertices[2].position, pTriangle->vertices[2].position.w);
-                const vector4f_t ab = k15_vector4f_sub(a, b);
-                const vector4f_t ac = k15_vector4f_sub(a, c);
-                const vector4f_t normal = k15_vector4f_cross(ac, ab);
-
-                const bool isTriangleBackfacing = normal.z <= 0.0f;
-                if(isTriangleBackfacing)
-                {
-                    continue;
-                }
+                *pDrawCall->pOcclusionQueryResult = occluded ? occlusion_query_result_t::occluded : occlusion_query_result_t::visible;
             }
 
-            if(!_k15_dynamic_buffer_push_back(pCulledTriangleBuffer, *pTriangle))
+            if( occluded )
             {
-                return false;
+                continue;
             }
         }
-    }
 
-    const uint32_t endCulledTriangleCount = pCulledTriangleBuffer->count;
+        const uint32_t triangleCount = ( pDrawCall->pIndexBuffer != nullptr ? pDrawCall->indexCount : pDrawCall->vertexCount ) / 3u;
 
-    pDrawCallTriangles->pTriangles      = pCulledTriangleBuffer->pData;
-    pDrawCallTriangles->triangleCount   = endCulledTriangleCount - startCulledTriangleCount;
+        //FK: Instances of small meshes get batched so that a job still processes around GeometryJobTriangleCount triangles
+        const uint32_t instancesPerJob = get_max(1u, GeometryJobTriangleCount / triangleCount);
 
-    return true;
-}
+        for(uint32_t instanceIndex = 0u; instanceIndex < pDrawCall->instanceCount; instanceIndex += instancesPerJob)
+        {
+            for(uint32_t triangleIndex = 0u; triangleIndex < triangleCount; triangleIndex += GeometryJobTriangleCount)
+            {
+                geometry_job_t* pGeometryJob = _k15_push_geometry_job(pContext, &geometryJobCount);
+                if( pGeometryJob == nullptr )
+                {
+                    return false;
+                }
 
-internal bool _k15_cull_triangles(draw_call_triangles_t* pDrawCallTriangles, dynamic_buffer_t<triangle_t>* pVisibleTriangleBuffer, bool backFaceCullingEnabeld)
-{
-    if(backFaceCullingEnabeld)
-    {
-        return k15_cull_outside_frustum_triangles<true>(pDrawCallTriangles, pVisibleTriangleBuffer);
-    }
-    else
-    {
-        return k15_cull_outside_frustum_triangles<false>(pDrawCallTriangles, pVisibleTriangleBuffer);
+                pGeometryJob->pContext              = pContext;
+                pGeometryJob->pDrawCall             = pDrawCall;
+                pGeometryJob->drawCallIndex         = drawCallIndex;
+                pGeometryJob->firstTriangleIndex    = triangleIndex;
+                pGeometryJob->triangleCount         = get_min(GeometryJobTriangleCount, triangleCount - triangleIndex);
+                pGeometryJob->firstInstanceIndex    = instanceIndex;
+                pGeometryJob->instanceCount         = get_min(instancesPerJob, pDrawCall->instanceCount - instanceIndex);
+                pGeometryJob->succeeded             = false;
+            }
+        }
     }
-}
-
-internal inline float _k15_signf(float value)
-{
-    return value > 0.0f ? 1.0f : -1.0f;
-}
 
-internal inline float k15_vector4f_length_squared(vector4f_t vector)
-{
-    return vector.x * vector.x + vector.y * vector.y + vector.z * vector.z;
+    *pOutGeometryJobCount = geometryJobCount;
+    return true;
 }
 
-enum clip_flag_t : uint8_t
+internal bool _k15_gather_geometry_job_results(const software_rasterizer_context_t* pContext, frame_t* pFrame, uint32_t geometryJobCount)
 {
-    Left    = 0b000001,
-    Right   = 0b000010,
-    Bottom  = 0b000100,
-    Top     = 0b001000,
-    Near    = 0b010000,
-    Far     = 0b100000
-};
+    //FK: Results are gathered in submission order so that the draw order doesn't depend on job scheduling
+    raster_draw_call_t* pRasterDrawCall = nullptr;
+    uint32_t rasterDrawCallIndex = ~0u;
 
-internal void _k15_get_clipping_flags(const vertex_t* restrict_modifier ppPoints, uint8_t* restrict_modifier ppClippingFlags)
-{
-    for( uint8_t pointIndex = 0; pointIndex < 2u; ++pointIndex )
+    for(uint32_t geometryJobIndex = 0u; geometryJobIndex < geometryJobCount; ++geometryJobIndex)
     {
-        const vector4f_t point = ppPoints[pointIndex].position;
-        uint8_t* restrict_modifier pClippingFlags = ppClippingFlags + pointIndex;
-
-        const float posW = point.w;
-        const float negW = -posW;
-
-        *pClippingFlags = 0u;
-
-        if( point.x < negW )
+        const geometry_job_t* pGeometryJob = pContext->geometryJobs.pData + geometryJobIndex;
+        if( !pGeometryJob->succeeded )
         {
-            *pClippingFlags |= (uint8_t)clip_flag_t::Left;
-        }
-        else if( point.x > posW )
-        {
-            *pClippingFlags |= (uint8_t)clip_flag_t::Right;
+            //TODO: log error
+            continue;
         }
 
-        if( point.y < negW )
+        const uint32_t screenspaceTriangleCount = pGeometryJob->screenspaceTriangles.count;
+        if( screenspaceTriangleCount == 0u )
         {
-            *pClippingFlags |= (uint8_t)clip_flag_t::Top;
-        }
-        else if( point.y > posW )
-        {
-            *pClippingFlags |= (uint8_t)clip_flag_t::Bottom;
+            continue;
         }
 
-        if( point.z < negW )
+        const uint32_t screenspaceTriangleOffset = pFrame->screenspaceTriangles.count;
+        if(!_k15_dynamic_buffer_push_back(&pFrame->screenspaceTriangles, pGeometryJob->screenspaceTriangles.pData, screenspaceTriangleCount))
         {
-            *pClippingFlags |= (uint8_t)clip_flag_t::Far;
+            return false;
         }
-        else if( point.z > posW )
+
+        if( rasterDrawCallIndex != pGeometryJob->drawCallIndex )
         {
-            *pClippingFlags |= (uint8_t)clip_flag_t::Near;
+            pRasterDrawCall = _k15_dynamic_buffer_push_back(&pFrame->rasterDrawCalls, 1u);
+            if( pRasterDrawCall == nullptr )
+            {
+                return false;
+            }
+
+            rasterDrawCallIndex = pGeometryJob->drawCallIndex;
+            pRasterDrawCall->pixelShader                = pGeometryJob->pDrawCall->pixelShader;
+            pRasterDrawCall->interpolationMode          = pGeometryJob->pDrawCall->interpolationMode;
+            pRasterDrawCall->pixelShaderInputLayout     = pGeometryJob->pDrawCall->pixelShaderInputLayout;
+            pRasterDrawCall->quadShadingEnabled         = pGeometryJob->pDrawCall->quadShadingEnabled;
+            pRasterDrawCall->pUniformData               = pGeometryJob->pDrawCall->pUniformBufferData;
+            pRasterDrawCall->attributeMask              = pGeometryJob->pDrawCall->attributeMask;
+            pRasterDrawCall->screenspaceTriangleOffset  = screenspaceTriangleOffset;
+            pRasterDrawCall->screenspaceTriangleCount   = 0u;
         }
+
+        pRasterDrawCall->screenspaceTriangleCount += screenspaceTriangleCount;
     }
+
+    return true;
 }
 
-internal vertex_t _k15_interpolate_vertex(const vertex_t* restrict_modifier pStart, const vertex_t* restrict_modifier pEnd, float t)
+internal bool _k15_process_draw_calls(software_rasterizer_context_t* pContext, frame_t* pFrame)
 {
-    vertex_t interpolatedVertex = {};
-    interpolatedVertex.position.x = pStart->position.x + (pEnd->position.x - pStart->position.x) * t;
-    interpolatedVertex.position.y = pStart->position.y + (pEnd->position.y - pStart->position.y) * t;
-    interpolatedVertex.position.z = pStart->position.z + (pEnd->position.z - pStart->position.z) * t;
-    interpolatedVertex.position.w = pStart->position.w + (pEnd->position.w - pStart->position.w) * t;
+    uint32_t geometryJobCount = 0u;
+    if(!_k15_prepare_geometry_jobs(pContext, pFrame, &geometryJobCount))
+    {
+        return false;
+    }
 
-    interpolatedVertex.normal.x = pStart->normal.x + (pEnd->normal.x - pStart->normal.x) * t;
-    interpolatedVertex.normal.y = pStart->normal.y + (pEnd->normal.y - pStart->normal.y) * t;
-    interpolatedVertex.normal.z = pStart->normal.z + (pEnd->normal.z - pStart->normal.z) * t;
+    job_counter_t jobCounter;
+    const bool jobsSubmitted = _k15_submit_jobs(pContext->pJobSystem, _k15_process_geometry_job, pContext->geometryJobs.pData, sizeof(geometry_job_t), geometryJobCount, &jobCounter, 0u);
+    _k15_wait_for_jobs(pContext->pJobSystem, &jobCounter, 0u);
 
-    interpolatedVertex.color.x = pStart->color.x + (pEnd->color.x - pStart->color.x) * t;
-    interpolatedVertex.color.y = pStart->color.y + (pEnd->color.y - pStart->color.y) * t;
-    interpolatedVertex.color.z = pStart->color.z + (pEnd->color.z - pStart->color.z) * t;
-    interpolatedVertex.color.w = pStart->color.w + (pEnd->color.w - pStart->color.w) * t;
+    if( !jobsSubmitted )
+    {
+        return false;
+    }
 
-    interpolatedVertex.texcoord.x = pStart->texcoord.x + (pEnd->texcoord.x - pStart->texcoord.x) * t;
-    interpolatedVertex.texcoord.y = pStart->texcoord.y + (pEnd->texcoord.y - pStart->texcoord.y) * t;
+    return _k15_gather_geometry_job_results(pContext, pFrame, geometryJobCount);
+}
 
-    return interpolatedVertex;
+void _k15_clear_buffers(unsigned long* restrict_modifier pColorBuffer, unsigned long* restrict_modifier pDepthBuffer, uint32_t bufferHeight, uint32_t colorBufferStride, uint32_t depthBufferStride)
+{
+    __stosd(pDepthBuffer, 0u, bufferHeight * depthBufferStride);
+	__stosd(pColorBuffer, 0u, bufferHeight * colorBufferStride);
 }
 
-internal clipped_vertex_t _k15_create_clipped_vertex(const vertex_t* pVertex, uint32_t triangleIndex)
+internal void _k15_clear_screen_tile(const screen_tile_t* pScreenTile, void* pColorBuffer, void* pDepthBuffer, hi_z_entry_t* pHiZBuffer, uint32_t colorBufferStride, uint32_t depthBufferStride, uint32_t hiZBufferStride)
 {
-    clipped_vertex_t clippedVertex;
-    memcpy(&clippedVertex, pVertex, sizeof(vertex_t));
-    clippedVertex.triangleIndex = triangleIndex;
+    uint32_t* restrict_modifier pColorBufferContent = (uint32_t* restrict_modifier)pColorBuffer;
+    float* restrict_modifier pDepthBufferContent = (float* restrict_modifier)pDepthBuffer;
+
+    const bounding_box_t boundingBox = pScreenTile->boundingBox;
+    const uint32_t tileWidth = boundingBox.x2 - boundingBox.x1;
+    for(uint32_t y = boundingBox.y1; y < boundingBox.y2; ++y)
+    {
+        memset(pColorBufferContent + boundingBox.x1 + y * colorBufferStride, 0, tileWidth * sizeof(uint32_t));
+        memset(pDepthBufferContent + boundingBox.x1 + y * depthBufferStride, 0, tileWidth * sizeof(float));
+    }
 
-    return clippedVertex;
+    const uint32_t hiZBlockX1 = boundingBox.x1 / RasterBlockSize;
+    const uint32_t hiZBlockCountX = ( boundingBox.x2 - boundingBox.x1 + RasterBlockSize - 1u ) / RasterBlockSize;
+    for(uint32_t y = boundingBox.y1; y < boundingBox.y2; y += RasterBlockSize)
+    {
+        memset(pHiZBuffer + hiZBlockX1 + ( y / RasterBlockSize ) * hiZBufferStride, 0, hiZBlockCountX * sizeof(hi_z_entry_t));
+    }
 }
 
-internal bool _k15_generate_clip_triangles_from_clip_vertices(clipped_vertex_t* pClippedVertices, uint32_t vertexCount, dynamic_buffer_t<triangle_t>* pClippedTriangles)
+internal void _k15_rasterize_screen_tile(void* pJobData, uint32_t workerIndex)
 {
-    if( vertexCount < 3u )
+    const screen_tile_t* pScreenTile = (const screen_tile_t*)pJobData;
+    const frame_t* pFrame = pScreenTile->pFrame;
+    const software_rasterizer_context_t* pContext = pFrame->pContext;
+
+    _k15_clear_screen_tile(pScreenTile, pFrame->pColorBuffer, pFrame->pDepthBuffer, pFrame->pHiZBuffer, pContext->colorBufferStride, pContext->depthBufferStride, pFrame->hiZBufferStride);
+
+    if( pFrame->settings.depthPrepassEnabled )
     {
-        return true;
+        //FK: First pass fills the tile's depth buffer, the second pass only shades the pixels whose depth made it into the depth buffer.
+        _k15_draw_triangles_8_step<raster_pass_t::depth_only>(pScreenTile, pFrame->screenspaceTriangles.pData, pFrame->rasterDrawCalls.pData, pContext->pShadingContexts + workerIndex, pFrame->pColorBuffer, pFrame->pDepthBuffer, pFrame->pHiZBuffer, pContext->colorBufferStride, pContext->depthBufferStride, pFrame->hiZBufferStride, pContext->redShift, pContext->greenShift, pContext->blueShift);
+        _k15_draw_triangles_8_step<raster_pass_t::color_equal_depth>(pScreenTile, pFrame->screenspaceTriangles.pData, pFrame->rasterDrawCalls.pData, pContext->pShadingContexts + workerIndex, pFrame->pColorBuffer, pFrame->pDepthBuffer, pFrame->pHiZBuffer, pContext->colorBufferStride, pContext->depthBufferStride, pFrame->hiZBufferStride, pContext->redShift, pContext->greenShift, pContext->blueShift);
+    }
+    else
+    {
+        _k15_draw_triangles_8_step<raster_pass_t::depth_and_color>(pScreenTile, pFrame->screenspaceTriangles.pData, pFrame->rasterDrawCalls.pData, pContext->pShadingContexts + workerIndex, pFrame->pColorBuffer, pFrame->pDepthBuffer, pFrame->pHiZBuffer, pContext->colorBufferStride, pContext->depthBufferStride, pFrame->hiZBufferStride, pContext->redShift, pContext->greenShift, pContext->blueShift);
     }
 
-    for(uint32_t clippedVertexIndex = 0; clippedVertexIndex < vertexCount;)
+    if( pFrame->settings.drawDepthBuffer )
     {
-        const uint32_t remainingVertexCount = vertexCount - clippedVertexIndex;
-        RuntimeAssert(remainingVertexCount >= 3u);
-        
-        const uint32_t localTriangleIndex = pClippedVertices[clippedVertexIndex].triangleIndex;
-        if(remainingVertexCount >= 5u &&
-           pClippedVertices[clippedVertexIndex + 1].triangleIndex == localTriangleIndex &&
-           pClippedVertices[clippedVertexIndex + 2].triangleIndex == localTriangleIndex &&
-           pClippedVertices[clippedVertexIndex + 3].triangleIndex == localTriangleIndex &&
-           pClippedVertices[clippedVertexIndex + 4].triangleIndex == localTriangleIndex)
-        {
-            triangle_t* pTriangles = _k15_dynamic_buffer_push_back(pClippedTriangles, 3u);
-            if( pTriangles == nullptr )
-            {
-                return false;
-            }
+        const bounding_box_t boundingBox = pScreenTile->boundingBox;
+        uint32_t* pTileColorBuffer = (uint32_t*)pFrame->pColorBuffer + boundingBox.x1 + boundingBox.y1 * pContext->colorBufferStride;
+        const float* pTileDepthBuffer = (const float*)pFrame->pDepthBuffer + boundingBox.x1 + boundingBox.y1 * pContext->depthBufferStride;
+        _k15_convert_depth_buffer_to_color_buffer(pTileDepthBuffer, pTileColorBuffer, boundingBox.x2 - boundingBox.x1, boundingBox.y2 - boundingBox.y1, pContext->colorBufferStride, pContext->depthBufferStride, pContext->redShift, pContext->greenShift, pContext->blueShift);
+    }
+}
 
-            pTriangles[0] = {pClippedVertices[clippedVertexIndex + 0], pClippedVertices[clippedVertexIndex + 1], pClippedVertices[clippedVertexIndex + 2]};
-            pTriangles[1] = {pClippedVertices[clippedVertexIndex + 2], pClippedVertices[clippedVertexIndex + 3], pClippedVertices[clippedVertexIndex + 4]};
-            pTriangles[2] = {pClippedVertices[clippedVertexIndex + 4], pClippedVertices[clippedVertexIndex + 0], pClippedVertices[clippedVertexIndex + 2]};
-            clippedVertexIndex += 5;
-        }
-        else if(remainingVertexCount >= 4u && 
-           pClippedVertices[clippedVertexIndex + 1].triangleIndex == localTriangleIndex &&
-           pClippedVertices[clippedVertexIndex + 2].triangleIndex == localTriangleIndex &&
-           pClippedVertices[clippedVertexIndex + 3].triangleIndex == localTriangleIndex)
-        {
-            triangle_t* pTriangles = _k15_dynamic_buffer_push_back(pClippedTriangles, 2u);
-            if( pTriangles == nullptr )
-            {
-                return false;
-            }
+internal bool _k15_prepare_screen_tiles(frame_t* pFrame)
+{
+    const software_rasterizer_context_t* pContext = pFrame->pContext;
+    const uint32_t screenTileCountX = ( pContext->backBufferWidth + ScreenTileSize - 1u ) / ScreenTileSize;
+    const uint32_t screenTileCountY = ( pContext->backBufferHeight + ScreenTileSize - 1u ) / ScreenTileSize;
+    const uint32_t screenTileCount = screenTileCountX * screenTileCountY;
 
-            pTriangles[0] = {pClippedVertices[clippedVertexIndex + 0], pClippedVertices[clippedVertexIndex + 1], pClippedVertices[clippedVertexIndex + 2]};
-            pTriangles[1] = {pClippedVertices[clippedVertexIndex + 2], pClippedVertices[clippedVertexIndex + 3], pClippedVertices[clippedVertexIndex + 0]};
-            clippedVertexIndex += 4;
+    //FK: Tiles keep their triangle buffers alive between frames, only create buffers for tiles that didn't exist yet
+    while( pFrame->screenTiles.count < screenTileCount )
+    {
+        screen_tile_t* pScreenTile = _k15_dynamic_buffer_push_back(&pFrame->screenTiles, 1u);
+        if( pScreenTile == nullptr )
+        {
+            return false;
         }
-        else if(pClippedVertices[clippedVertexIndex + 1].triangleIndex == localTriangleIndex && pClippedVertices[clippedVertexIndex + 2].triangleIndex == localTriangleIndex)
+
+        if(!_k15_create_dynamic_buffer(&pScreenTile->triangles, DefaultScreenTileTriangleCapacity))
         {
-            triangle_t* pTriangle = _k15_dynamic_buffer_push_back(pClippedTriangles, 1u);
-            if( pTriangle == nullptr )
-            {
-                return false;
-            }
+            --pFrame->screenTiles.count;
+            return false;
+        }
+    }
 
-            pTriangle[0] = {pClippedVertices[clippedVertexIndex + 0], pClippedVertices[clippedVertexIndex + 1], pClippedVertices[clippedVertexIndex + 2]};
-            clippedVertexIndex += 3;
+    pFrame->screenTileCountX = screenTileCountX;
+    pFrame->screenTileCountY = screenTileCountY;
+
+    //FK: One hi-z entry per RasterBlockSize x RasterBlockSize block, gets cleared together with the screen tiles.
+    const uint32_t hiZBufferWidth = ( pContext->backBufferWidth + RasterBlockSize - 1u ) / RasterBlockSize;
+    const uint32_t hiZBufferHeight = ( pContext->backBufferHeight + RasterBlockSize - 1u ) / RasterBlockSize;
+    const uint32_t hiZEntryCount = hiZBufferWidth * hiZBufferHeight;
+    if( pFrame->hiZBufferCapacity < hiZEntryCount )
+    {
+        _mm_free(pFrame->pHiZBuffer);
+        pFrame->pHiZBuffer = (hi_z_entry_t*)_mm_malloc(_k15_align_to_cache_line(hiZEntryCount * sizeof(hi_z_entry_t)), CacheLineSizeInBytes);
+        pFrame->hiZBufferCapacity = pFrame->pHiZBuffer != nullptr ? hiZEntryCount : 0u;
+        if( pFrame->pHiZBuffer == nullptr )
+        {
+            return false;
         }
-        else
+    }
+
+    pFrame->hiZBufferStride = hiZBufferWidth;
+    pFrame->hiZBufferHeight = hiZBufferHeight;
+
+    for(uint32_t tileY = 0u; tileY < screenTileCountY; ++tileY)
+    {
+        for(uint32_t tileX = 0u; tileX < screenTileCountX; ++tileX)
         {
-            RuntimeAssert(false);
+            screen_tile_t* pScreenTile = pFrame->screenTiles.pData + tileX + tileY * screenTileCountX;
+            pScreenTile->pFrame             = pFrame;
+            pScreenTile->boundingBox.x1     = tileX * ScreenTileSize;
+            pScreenTile->boundingBox.y1     = tileY * ScreenTileSize;
+            pScreenTile->boundingBox.x2     = get_min(pScreenTile->boundingBox.x1 + ScreenTileSize, pContext->backBufferWidth);
+            pScreenTile->boundingBox.y2     = get_min(pScreenTile->boundingBox.y1 + ScreenTileSize, pContext->backBufferHeight);
+            pScreenTile->triangles.count    = 0u;
+            pScreenTile->binningFailed      = false;
         }
     }
 
     return true;
 }
 
-internal bool _k15_clip_triangles(draw_call_triangles_t* pDrawCallTriangles, dynamic_buffer_t<triangle_t>* pClippedTriangles)
+internal void _k15_bin_triangles_into_screen_tile_row(void* pJobData, uint32_t workerIndex)
 {
-    const uint32_t clippedTrianglesCountStart = pClippedTriangles->count;
+    UnusedVariable(workerIndex);
 
-    const triangle_t* pTriangles = pDrawCallTriangles->pTriangles;
-    const uint32_t triangleCount = pDrawCallTriangles->triangleCount;
-    static_buffer_t<clipped_vertex_t, 128u> localClippedVertices = {};
-    
-    for(uint32_t triangleIndex = 0; triangleIndex < triangleCount; ++triangleIndex)
+    //FK: Every job bins into its own row of tiles, so no two jobs ever push into the same tile.
+    //    Draw calls and their triangles are binned in submission order, this keeps the draw order within each tile intact
+    screen_tile_t* pFirstScreenTile = (screen_tile_t*)pJobData;
+    const frame_t* pFrame = pFirstScreenTile->pFrame;
+    const uint32_t tileY = pFirstScreenTile->boundingBox.y1 / ScreenTileSize;
+
+    for(uint32_t drawCallIndex = 0; drawCallIndex < pFrame->rasterDrawCalls.count; ++drawCallIndex)
     {
-        if(localClippedVertices.count + 6u >= localClippedVertices.capacity)
+        const raster_draw_call_t* pDrawCall = pFrame->rasterDrawCalls.pData + drawCallIndex;
+        for(uint32_t triangleIndex = 0; triangleIndex < pDrawCall->screenspaceTriangleCount; ++triangleIndex)
         {
-            if(!_k15_generate_clip_triangles_from_clip_vertices(localClippedVertices.pStaticData, localClippedVertices.count, pClippedTriangles))
+            const uint32_t screenspaceTriangleIndex = pDrawCall->screenspaceTriangleOffset + triangleIndex;
+            const bounding_box_t boundingBox = pFrame->screenspaceTriangles.pData[screenspaceTriangleIndex].boundingBox;
+            if( boundingBox.x1 >= boundingBox.x2 || boundingBox.y1 >= boundingBox.y2 )
             {
-                return false;
+                continue;
             }
-            localClippedVertices.count = 0;
-        }
-
-        const triangle_t* pCurrentTriangle = pTriangles + triangleIndex;
-
-        bool clipped = false;
-        bool startVertexClipped = false;
-        vertex_t intersectionVertex = {};
-        for(uint32_t vertexIndex = 0; vertexIndex < 3u; ++vertexIndex)
-        {
-            const uint32_t nextVertexIndex = ( vertexIndex + 1u ) % 3u;
-
-            vertex_t edgeVertices[2] = {
-                pCurrentTriangle->vertices[vertexIndex],
-                pCurrentTriangle->vertices[nextVertexIndex]
-            };
-
-            uint8_t clippingFlags[2] = {0};
-            _k15_get_clipping_flags(edgeVertices, clippingFlags);
 
-        clipStart:
-            if( ( clippingFlags[0] | clippingFlags[1] ) == 0 )
+            const uint32_t tileY1 = boundingBox.y1 / ScreenTileSize;
+            const uint32_t tileY2 = ( boundingBox.y2 - 1u ) / ScreenTileSize;
+            if( tileY < tileY1 || tileY > tileY2 )
             {
-                if( !startVertexClipped )
-                {
-                    _k15_static_buffer_push_back(&localClippedVertices, _k15_create_clipped_vertex(&edgeVertices[0], triangleIndex));
-                }
-
-                startVertexClipped = false;
-
-                if( clipped )
-                {
-                    _k15_static_buffer_push_back(&localClippedVertices, _k15_create_clipped_vertex(&intersectionVertex, triangleIndex));
-                    clipped = false;
-                }
                 continue;
             }
-            else
-            {
-                const uint8_t clipAnd = clippingFlags[0] & clippingFlags[1];
-                if( clipAnd != 0 )
-                {
-                    continue;
-                }
 
-                const uint8_t vertexIndex = clippingFlags[0] == 0 ? 1 : 0;
-                const vector4f_t delta = k15_vector4f_sub(edgeVertices[!vertexIndex].position, edgeVertices[vertexIndex].position);
+            const uint32_t tileX1 = boundingBox.x1 / ScreenTileSize;
+            const uint32_t tileX2 = ( boundingBox.x2 - 1u ) / ScreenTileSize;
 
-                startVertexClipped = clippingFlags[0] != 0u;
-                intersectionVertex = edgeVertices[vertexIndex];
-                if( clippingFlags[vertexIndex] & (uint8_t)clip_flag_t::Left )
-                {
-                    const float t = ( -edgeVertices[vertexIndex].position.w - edgeVertices[vertexIndex].position.x ) / ( ( -edgeVertices[vertexIndex].position.w - edgeVertices[vertexIndex].position.x ) - ( -edgeVertices[!vertexIndex].position.w - edgeVertices[!vertexIndex].position.x ) );
-                    intersectionVertex = _k15_interpolate_vertex( &intersectionVertex, edgeVertices + !vertexIndex, t);
-                }
-                else if( clippingFlags[vertexIndex] & (uint8_t)clip_flag_t::Right )
-                {
-                    const float t = ( edgeVertices[vertexIndex].position.w - edgeVertices[vertexIndex].position.x ) / ( ( edgeVertices[vertexIndex].position.w - edgeVertices[vertexIndex].position.x ) - ( edgeVertices[!vertexIndex].position.w - edgeVertices[!vertexIndex].position.x ) );
-                    intersectionVertex = _k15_interpolate_vertex( &intersectionVertex, edgeVertices + !vertexIndex, t);
-                }
-                else if( clippingFlags[vertexIndex] & (uint8_t)clip_flag_t::Top )
-                {
-                    const float t = ( -edgeVertices[vertexIndex].position.w - edgeVertices[vertexIndex].position.y ) / ( ( -edgeVertices[vertexIndex].position.w - edgeVertices[vertexIndex].position.y ) - ( -edgeVertices[!vertexIndex].position.w - edgeVertices[!vertexIndex].position.y ) );
-                    intersectionVertex = _k15_interpolate_vertex( &intersectionVertex, edgeVertices + !vertexIndex, t);
-                }
-                else if( clippingFlags[vertexIndex] & (uint8_t)clip_flag_t::Bottom )
-                {
-                    const float t = ( edgeVertices[vertexIndex].position.w - edgeVertices[vertexIndex].position.y ) / ( ( edgeVertices[vertexIndex].position.w - edgeVertices[vertexIndex].position.y ) - ( edgeVertices[!vertexIndex].position.w - edgeVertices[!vertexIndex].position.y ) );
-                    intersectionVertex = _k15_interpolate_vertex( &intersectionVertex, edgeVertices + !vertexIndex, t);
-                }
-                else if( clippingFlags[vertexIndex] & (uint8_t)clip_flag_t::Far )
-                {
-                    const float t = ( -edgeVertices[vertexIndex].position.w - edgeVertices[vertexIndex].position.z ) / ( ( -edgeVertices[vertexIndex].position.w - edgeVertices[vertexIndex].position.z ) - ( -edgeVertices[!vertexIndex].position.w - edgeVertices[!vertexIndex].position.z ) );
-                    intersectionVertex = _k15_interpolate_vertex( &intersectionVertex, edgeVertices + !vertexIndex, t);
-                }
-                else if( clippingFlags[vertexIndex] & (uint8_t)clip_flag_t::Near )
+            const tile_triangle_t tileTriangle = {screenspaceTriangleIndex, drawCallIndex};
+            for(uint32_t tileX = tileX1; tileX <= tileX2; ++tileX)
+            {
+                screen_tile_t* pScreenTile = pFirstScreenTile + tileX;
+                if(_k15_dynamic_buffer_push_back(&pScreenTile->triangles, tileTriangle) == nullptr)
                 {
-                    const float t = ( edgeVertices[vertexIndex].position.w - edgeVertices[vertexIndex].position.z ) / ( ( edgeVertices[vertexIndex].position.w - edgeVertices[vertexIndex].position.z ) - ( edgeVertices[!vertexIndex].position.w - edgeVertices[!vertexIndex].position.z ) );
-                    intersectionVertex = _k15_interpolate_vertex( &intersectionVertex, edgeVertices + !vertexIndex, t);
+                    pScreenTile->binningFailed = true;
                 }
-
-                edgeVertices[vertexIndex] = intersectionVertex;
-                _k15_get_clipping_flags(edgeVertices, clippingFlags);
-                clipped = true;
-                goto clipStart;
             }
         }
     }
+}
+
+internal bool _k15_bin_triangles_into_screen_tiles(software_rasterizer_context_t* pContext, frame_t* pFrame)
+{
+    const uint32_t screenTileCountX = pFrame->screenTileCountX;
+    const uint32_t screenTileCount = screenTileCountX * pFrame->screenTileCountY;
+    job_counter_t jobCounter;
+
+    const bool jobsSubmitted = _k15_submit_jobs(pContext->pJobSystem, _k15_bin_triangles_into_screen_tile_row, pFrame->screenTiles.pData, sizeof(screen_tile_t) * screenTileCountX, pFrame->screenTileCountY, &jobCounter, 0u);
+    _k15_wait_for_jobs(pContext->pJobSystem, &jobCounter, 0u);
+
+    if( !jobsSubmitted )
+    {
+        return false;
+    }
 
-    if(localClippedVertices.count > 0u)
+    for(uint32_t screenTileIndex = 0u; screenTileIndex < screenTileCount; ++screenTileIndex)
     {
-        if(!_k15_generate_clip_triangles_from_clip_vertices(localClippedVertices.pStaticData, localClippedVertices.count, pClippedTriangles))
+        if( pFrame->screenTiles.pData[screenTileIndex].binningFailed )
         {
             return false;
         }
     }
 
-    const uint32_t clippedTrianglesCountEnd = pClippedTriangles->count;
-
-    pDrawCallTriangles->pTriangles = pClippedTriangles->pData;
-    pDrawCallTriangles->triangleCount = clippedTrianglesCountEnd - clippedTrianglesCountStart;
-
     return true;
 }
 
-internal bool _k15_project_triangles_into_screenspace(draw_call_triangles_t* pDrawCallTriangles, dynamic_buffer_t<screenspace_triangle_t>* pScreenspaceTriangleBuffer, uint32_t backBufferWidth, uint32_t backBufferHeight)
+internal bool _k15_rasterize_screen_tiles(software_rasterizer_context_t* pContext, frame_t* pFrame)
 {
-    pDrawCallTriangles->pScreenspaceTriangles = _k15_dynamic_buffer_push_back(pScreenspaceTriangleBuffer, pDrawCallTriangles->triangleCount);
-    if( pDrawCallTriangles->pScreenspaceTriangles == nullptr )
-    {
-        return false;
-    }
-
-    pDrawCallTriangles->screenspaceTriangleCount = pDrawCallTriangles->triangleCount;
-
-    const float width   = (float)(backBufferWidth-1u);
-    const float height  = (float)(backBufferHeight-1u);
-    screenspace_triangle_t* pScreenspaceTriangles = pDrawCallTriangles->pScreenspaceTriangles;
-
-    for(uint32_t triangleIndex = 0; triangleIndex < pDrawCallTriangles->screenspaceTriangleCount; ++triangleIndex)
-    {
-        triangle_t* pTriangle = pDrawCallTriangles->pTriangles + triangleIndex;
-
-        memcpy(pScreenspaceTriangles[triangleIndex].vertices, pTriangle->vertices, sizeof(pTriangle->vertices));
+    //FK: Doesn't wait for the tiles to be shaded, pFrame->jobCounter tracks them until the frame is complete
+    const uint32_t screenTileCount = pFrame->screenTileCountX * pFrame->screenTileCountY;
+    return _k15_submit_jobs(pContext->pJobSystem, _k15_rasterize_screen_tile, pFrame->screenTiles.pData, sizeof(screen_tile_t), screenTileCount, &pFrame->jobCounter, 0u);
+}
 
-        pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[0].x = (((1.0f + pTriangle->vertices[0].position.x / pTriangle->vertices[0].position.w) / 2.0f) * width);
-        pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[0].y = (((1.0f + pTriangle->vertices[0].position.y / pTriangle->vertices[0].position.w) / 2.0f) * height);
-        pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[0].z = pTriangle->vertices[0].position.z / pTriangle->vertices[0].position.w;
+internal frame_t* _k15_begin_frame(software_rasterizer_context_t* pContext)
+{
+    const uint64_t frameNumber = ++pContext->frameNumber;
+    frame_t* pFrame = pContext->pFrames + ( frameNumber % MaxFramesInFlight );
 
-        pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[1].x = (((1.0f + pTriangle->vertices[1].position.x / pTriangle->vertices[1].position.w) / 2.0f) * width);
-        pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[1].y = (((1.0f + pTriangle->vertices[1].position.y / pTriangle->vertices[1].position.w) / 2.0f) * height);
-        pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[1].z = pTriangle->vertices[1].position.z / pTriangle->vertices[1].position.w;
+    //FK: The frame that used this slot before might still be in flight
+    _k15_wait_for_jobs(pContext->pJobSystem, &pFrame->jobCounter, 0u);
 
-        pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[2].x = (((1.0f + pTriangle->vertices[2].position.x / pTriangle->vertices[2].position.w) / 2.0f) * width);
-        pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[2].y = (((1.0f + pTriangle->vertices[2].position.y / pTriangle->vertices[2].position.w) / 2.0f) * height);
-        pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[2].z = pTriangle->vertices[2].position.z / pTriangle->vertices[2].position.w;
+    //FK: Hand the recorded draw calls over to the frame and continue recording into the buffers of the old frame
+    const dynamic_buffer_t<draw_call_t> drawCalls = pFrame->drawCalls;
+    pFrame->drawCalls = pContext->drawCalls;
+    pContext->drawCalls = drawCalls;
+    pContext->drawCalls.count = 0;
 
-        pScreenspaceTriangles[triangleIndex].boundingBox.x1 = float_to_uint32(get_min(pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[0].x, get_min(pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[1].x, pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[2].x)));
-        pScreenspaceTriangles[triangleIndex].boundingBox.x2 = float_to_uint32(get_max(pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[0].x, get_max(pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[1].x, pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[2].x)));
-        pScreenspaceTriangles[triangleIndex].boundingBox.y1 = float_to_uint32(get_min(pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[0].y, get_min(pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[1].y, pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[2].y)));
-        pScreenspaceTriangles[triangleIndex].boundingBox.y2 = float_to_uint32(get_max(pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[0].y, get_max(pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[1].y, pScreenspaceTriangles[triangleIndex].screenspaceVertexPositions[2].y)));
+    stack_allocator_t* pDrawCallDataAllocator = pFrame->pDrawCallDataAllocator;
+    pFrame->pDrawCallDataAllocator = pContext->pDrawCallDataAllocator;
+    pContext->pDrawCallDataAllocator = pDrawCallDataAllocator;
+    _k15_reset_stack_allocator(pContext->pDrawCallDataAllocator);
 
-        pScreenspaceTriangles[triangleIndex].boundingBox.x1 = get_max(0u, pScreenspaceTriangles[triangleIndex].boundingBox.x1);
-        pScreenspaceTriangles[triangleIndex].boundingBox.y1 = get_max(0u, pScreenspaceTriangles[triangleIndex].boundingBox.y1);
+    pFrame->frameNumber                 = frameNumber;
+    pFrame->settings                    = pContext->settings;
+    pFrame->pColorBuffer                = pContext->pColorBuffer[pContext->currentColorBufferIndex];
+    pFrame->pDepthBuffer                = pContext->pDepthBuffer[pContext->currentColorBufferIndex];
+    pFrame->rasterDrawCalls.count       = 0;
+    pFrame->screenspaceTriangles.count  = 0;
 
-        //pScreenspaceTriangles[triangleIndex].boundingBox.x1 = get_max(0u, pScreenspaceTriangles[triangleIndex].boundingBox.x1 - 1u);
-        //pScreenspaceTriangles[triangleIndex].boundingBox.y1 = get_max(0u, pScreenspaceTriangles[triangleIndex].boundingBox.y1 - 1u);
-        pScreenspaceTriangles[triangleIndex].boundingBox.x2 = get_min((uint32_t)width, pScreenspaceTriangles[triangleIndex].boundingBox.x2 + 1u);
-        pScreenspaceTriangles[triangleIndex].boundingBox.y2 = get_min((uint32_t)height, pScreenspaceTriangles[triangleIndex].boundingBox.y2 + 1u);
-    }
-    
-    return true;
+    return pFrame;
 }
 
-void k15_draw_text(uint8_t* pColorBuffer, const bitmap_font_t* pFont, uint32_t colorBufferWidth, uint32_t colorBufferHeight, uint32_t colorBufferStride, int32_t x, int32_t y, const char* pText)
+internal void _k15_wait_for_frames_using_color_buffer(software_rasterizer_context_t* pContext, const frame_t* pFrame)
 {
-    RuntimeAssert(pFont->channels == 3);
-
-    const uint32_t charPixelWidth = 16;
-    const uint32_t charPixelHeight = 16;
-    const uint32_t textLength = (uint32_t)strlen(pText);
-    const uint32_t fontBitmapWidth = pFont->width;
-    const char* pTextEnd = pText + textLength;
-    const char* pTextRunning = pText;
-    uint32_t colorBufferPixelX = x;
-
-    while( pTextRunning != pTextEnd )
+    //FK: With less color buffers than frames in flight, older frames might still render into the same buffers
+    for(uint32_t frameIndex = 0u; frameIndex < MaxFramesInFlight; ++frameIndex)
     {
-        const uint32_t charIndex = (uint32_t)(pTextRunning - pText);
-        const char charToDraw = *pTextRunning++;
-
-        const uint32_t charPixelStartX = ( charPixelWidth * charToDraw ) & 0xFF;
-        const uint32_t charPixelStartY = ( ( charPixelWidth * charToDraw ) / 0xFF ) * charPixelHeight;
-        const uint32_t charPixelEndX = get_min( colorBufferWidth, charPixelStartX + 16 );
-        const uint32_t charPixelEndY = get_min( colorBufferHeight, charPixelStartY + 16 );
-
-        uint32_t charPixelY = charPixelStartY;
-        uint32_t charPixelX = charPixelStartX;
-        uint32_t colorBufferPixelY = y;
-
-        while( charPixelY < charPixelEndY )
+        frame_t* pOtherFrame = pContext->pFrames + frameIndex;
+        if( pOtherFrame != pFrame && pOtherFrame->pColorBuffer == pFrame->pColorBuffer )
         {
-            charPixelX = charPixelStartX;
-            colorBufferPixelX = x + charIndex * charPixelWidth;
-            while( charPixelX < charPixelEndX )
-            {
-                const uint32_t colorBufferIndex = ( colorBufferPixelX + colorBufferPixelY * colorBufferStride ) * 4;
-                const uint32_t fontBufferIndex = ( charPixelX + charPixelY * fontBitmapWidth ) * 3;
-                pColorBuffer[colorBufferIndex + 0] = pFont->pRGBPixels[fontBufferIndex + 0];
-                pColorBuffer[colorBufferIndex + 1] = pFont->pRGBPixels[fontBufferIndex + 1];
-                pColorBuffer[colorBufferIndex + 2] = pFont->pRGBPixels[fontBufferIndex + 2];
-                pColorBuffer[colorBufferIndex + 3] = 0xFF;
-
-                ++charPixelX;
-                ++colorBufferPixelX;
-            }
-            
-            ++charPixelY;
-            ++colorBufferPixelY;
+            _k15_wait_for_jobs(pContext->pJobSystem, &pOtherFrame->jobCounter, 0u);
         }
     }
 }
 
-void k15_draw_text_formatted(uint8_t* pColorBuffer, const bitmap_font_t* pFont, uint32_t colorBufferWidth, uint32_t colorBufferHeight, uint32_t colorBufferStride, int32_t x, int32_t y, const char* pText, ...)
-{
-    char textBuffer[512];
-
-    va_list args;
-    va_start(args, pText);
-    vsprintf(textBuffer, pText, args);
-    va_end(args);
-
-    k15_draw_text(pColorBuffer, pFont, colorBufferWidth, colorBufferHeight, colorBufferStride, x, y, textBuffer);
-}
-
-internal bool _k15_generate_triangles(draw_call_triangles_t* pOutDrawCallTriangles, dynamic_buffer_t<triangle_t>* pTriangleBuffer, const draw_call_t* pDrawCall)
+frame_fence_t k15_draw_frame(software_rasterizer_context_t* pContext)
 {
-    const uint32_t triangleCount = pDrawCall->vertexCount / 3;
-    triangle_t* pTriangles = _k15_dynamic_buffer_push_back(pTriangleBuffer, triangleCount);
-    if(pTriangles == nullptr)
-    {
-        return false;
-    }
+    frame_t* pFrame = _k15_begin_frame(pContext);
 
-    for( uint32_t triangleIndex = 0; triangleIndex < triangleCount; ++triangleIndex )
+    //FK: The geometry stages of this frame overlap with the tiles of the previous frame still being shaded
+    if(!_k15_process_draw_calls(pContext, pFrame))
     {
-        const uint32_t vertexBufferOffset = triangleIndex * 3u;
-        memcpy(pTriangles[triangleIndex].vertices, pDrawCall->pVertexBuffer->pData + vertexBufferOffset, sizeof(vertex_t) * 3);
+        //TODO: log error
     }
 
-    pOutDrawCallTriangles->pixelShader              = pDrawCall->pixelShader;
-    pOutDrawCallTriangles->vertexShader             = pDrawCall->vertexShader;
-    pOutDrawCallTriangles->pUniformData             = pDrawCall->pUniformBufferData;
-    pOutDrawCallTriangles->pTriangles               = pTriangles;
-    pOutDrawCallTriangles->triangleCount            = triangleCount;
-    return true;
-}
-
-void _k15_clear_buffers(unsigned long* restrict_modifier pColorBuffer, unsigned long* restrict_modifier pDepthBuffer, uint32_t bufferHeight, uint32_t colorBufferStride, uint32_t depthBufferStride)
-{
-    __stosd(pDepthBuffer, 0u, bufferHeight * depthBufferStride);
-	__stosd(pColorBuffer, 0u, bufferHeight * colorBufferStride);
-}
+    _k15_wait_for_frames_using_color_buffer(pContext, pFrame);
 
-void k15_draw_frame(software_rasterizer_context_t* pContext)
-{
-    _k15_clear_buffers((unsigned long* restrict_modifier)pContext->pColorBuffer[pContext->currentColorBufferIndex], (unsigned long* restrict_modifier)pContext->pDepthBuffer[pContext->currentColorBufferIndex], pContext->backBufferHeight, pContext->colorBufferStride, pContext->depthBufferStride);
+    //FK: Only valid again once the tiles of this frame have been rasterized
+    pFrame->hiZFrameNumber = 0u;
 
-    for(uint32_t drawCallIndex = 0; drawCallIndex < pContext->drawCalls.count; ++drawCallIndex)
+    if( pFrame->settings.drawWireframe )
     {
-        draw_call_t* pDrawCall = pContext->drawCalls.pData + drawCallIndex;
+        _k15_clear_buffers((unsigned long* restrict_modifier)pFrame->pColorBuffer, (unsigned long* restrict_modifier)pFrame->pDepthBuffer, pContext->backBufferHeight, pContext->colorBufferStride, pContext->depthBufferStride);
 
-        draw_call_triangles_t drawCallTriangles;
-        if(!_k15_generate_triangles(&drawCallTriangles, &pContext->triangles, pDrawCall))
+        for(uint32_t drawCallIndex = 0; drawCallIndex < pFrame->rasterDrawCalls.count; ++drawCallIndex)
         {
-            //TODO: log error
-            continue;
-        }
-        
-        _k15_transform_vertices(&drawCallTriangles);
-        if(!_k15_cull_triangles(&drawCallTriangles, &pContext->visibleTriangles, pContext->settings.backFaceCullingEnabled))
-        {
-            //TODO: log error
-            continue;
+            const raster_draw_call_t* pRasterDrawCall = pFrame->rasterDrawCalls.pData + drawCallIndex;
+
+            draw_call_triangles_t drawCallTriangles = {};
+            drawCallTriangles.pixelShader               = pRasterDrawCall->pixelShader;
+            drawCallTriangles.pUniformData              = pRasterDrawCall->pUniformData;
+            drawCallTriangles.attributeMask             = pRasterDrawCall->attributeMask;
+            drawCallTriangles.pixelShaderInputLayout    = pRasterDrawCall->pixelShaderInputLayout;
+            drawCallTriangles.pScreenspaceTriangles     = pFrame->screenspaceTriangles.pData + pRasterDrawCall->screenspaceTriangleOffset;
+            drawCallTriangles.screenspaceTriangleCount  = pRasterDrawCall->screenspaceTriangleCount;
+            _k15_draw_triangle_lines(&drawCallTriangles, pContext->pShadingContexts, pFrame->pColorBuffer, pFrame->pDepthBuffer, pContext->backBufferWidth, pContext->backBufferHeight, pContext->colorBufferStride, pContext->depthBufferStride, pContext->redShift, pContext->greenShift, pContext->blueShift);
         }
 
-        if(!_k15_clip_triangles(&drawCallTriangles, &pContext->clippedTriangles))
+        if( pFrame->settings.drawDepthBuffer )
         {
-            //TODO: log error
-            continue;
+            _k15_convert_depth_buffer_to_color_buffer(pFrame->pDepthBuffer, pFrame->pColorBuffer, pContext->backBufferWidth, pContext->backBufferHeight, pContext->colorBufferStride, pContext->depthBufferStride, pContext->redShift, pContext->greenShift, pContext->blueShift);
         }
-
-        if(!_k15_project_triangles_into_screenspace(&drawCallTriangles, &pContext->screenspaceTriangles, pContext->backBufferWidth, pContext->backBufferHeight))
+    }
+    else
+    {
+        if(!_k15_prepare_screen_tiles(pFrame) || 
+           !_k15_bin_triangles_into_screen_tiles(pContext, pFrame) ||
+           !_k15_rasterize_screen_tiles(pContext, pFrame))
         {
             //TODO: log error
-            continue;
-        }
-
-        if( pContext->settings.drawWireframe )
-        {
-            _k15_draw_triangle_lines(&drawCallTriangles, pContext->bufferedPixelShaderInput, pContext->bufferedPixelShaderOutput, pContext->barycentricCoordinatesBuffer, pContext->pColorBuffer[pContext->currentColorBufferIndex], pContext->pDepthBuffer[pContext->currentColorBufferIndex], pContext->colorBufferStride, pContext->depthBufferStride, pContext->redShift, pContext->greenShift, pContext->blueShift);
         }
         else
         {
-            _k15_draw_triangles_8_step(&drawCallTriangles, pContext->bufferedPixelShaderInput, pContext->bufferedPixelShaderOutput, pContext->barycentricCoordinatesBuffer, pContext->pColorBuffer[pContext->currentColorBufferIndex], pContext->pDepthBuffer[pContext->currentColorBufferIndex], pContext->colorBufferStride, pContext->depthBufferStride, pContext->redShift, pContext->greenShift, pContext->blueShift);
+            pFrame->hiZFrameNumber = pFrame->frameNumber;
         }
+    }
 
-        if( pContext->settings.drawDepthBuffer )
-        {
-            _k15_convert_depth_buffer_to_color_buffer(pContext->pDepthBuffer[pContext->currentColorBufferIndex], pContext->pColorBuffer[pContext->currentColorBufferIndex], pContext->backBufferWidth, pContext->backBufferHeight, pContext->colorBufferStride, pContext->depthBufferStride, pContext->redShift, pContext->greenShift, pContext->blueShift);
-        }
+    frame_fence_t frameFence = {pFrame->frameNumber};
+    if( !pFrame->settings.asyncFrameSubmission )
+    {
+        k15_wait_frame(pContext, frameFence);
+    }
+
+    return frameFence;
+}
 
-        pContext->triangles.count = 0;
-        pContext->visibleTriangles.count = 0;
-        pContext->clippedTriangles.count = 0;
-        pContext->screenspaceTriangles.count = 0;
+void k15_wait_frame(software_rasterizer_context_t* pContext, frame_fence_t frameFence)
+{
+    RuntimeAssert(pContext != nullptr);
+
+    frame_t* pFrame = pContext->pFrames + ( frameFence.frameNumber % MaxFramesInFlight );
+    if( pFrame->frameNumber != frameFence.frameNumber )
+    {
+        //FK: The slot only gets reused after the frame has completed
+        return;
     }
 
-    pContext->drawCalls.count = 0;
+    job_system_t* pJobSystem = pContext->pJobSystem;
+    _k15_wait_for_jobs(pJobSystem, &pFrame->jobCounter, _k15_get_current_worker_index(pJobSystem));
+}
 
-    _k15_reset_stack_allocator(pContext->pDrawCallDataAllocator);
+bool k15_is_frame_complete(const software_rasterizer_context_t* pContext, frame_fence_t frameFence)
+{
+    RuntimeAssert(pContext != nullptr);
+
+    const frame_t* pFrame = pContext->pFrames + ( frameFence.frameNumber % MaxFramesInFlight );
+    if( pFrame->frameNumber != frameFence.frameNumber )
+    {
+        return true;
+    }
+
+    return k15_are_jobs_finished(&pFrame->jobCounter);
 }
 
 void k15_change_color_buffers(software_rasterizer_context_t* pContext, void** restrict_modifier pColorBuffers, uint8_t colorBufferCount, uint32_t widthInPixels, uint32_t heightInPixels, uint32_t strideInBytes)
 {
+    //FK: Frames that are still in flight render into the old color buffers
+    for(uint32_t frameIndex = 0u; frameIndex < MaxFramesInFlight; ++frameIndex)
+    {
+        _k15_wait_for_jobs(pContext->pJobSystem, &pContext->pFrames[frameIndex].jobCounter, 0u);
+    }
+
     for(uint8_t colorBufferIndex = 0; colorBufferIndex < colorBufferCount; ++colorBufferIndex)
     {
         pContext->pColorBuffer[colorBufferIndex] = pColorBuffers[colorBufferIndex];
@@ -2714,9 +5650,19 @@ void k15_change_color_buffers(software_rasterizer_context_t* pContext, void** re
     pContext->colorBufferStride = strideInBytes;
 }
 
-bool k15_is_valid_vertex_buffer(const vertex_buffer_handle_t vertexBuffer)
+bool k15_is_valid_vertex_buffer(const vertex_buffer_handle_t vertexBuffer)
+{
+    return vertexBuffer.pHandle != nullptr;
+}
+
+bool k15_is_valid_index_buffer(const index_buffer_handle_t indexBuffer)
+{
+    return indexBuffer.pHandle != nullptr;
+}
+
+bool k15_is_valid_instance_buffer(const instance_buffer_handle_t instanceBuffer)
 {
-    return vertexBuffer.pHandle != nullptr;
+    return instanceBuffer.pHandle != nullptr;
 }
 
 bool k15_is_valid_uniform_buffer(const uniform_buffer_handle_t uniformBuffer)
@@ -2756,9 +5702,30 @@ vertex_shader_handle_t k15_create_vertex_shader(software_rasterizer_context_t* p
 }
 
 pixel_shader_handle_t k15_create_pixel_shader(software_rasterizer_context_t* pContext, pixel_shader_fnc_t pixelShaderFnc)
+{
+    const pixel_shader_desc_t pixelShaderDesc = k15_create_default_pixel_shader_desc(pixelShaderFnc);
+    return k15_create_pixel_shader_from_desc(pContext, &pixelShaderDesc);
+}
+
+pixel_shader_handle_t k15_create_pixel_shader_with_interpolation_mode(software_rasterizer_context_t* pContext, pixel_shader_fnc_t pixelShaderFnc, interpolation_mode_t interpolationMode)
+{
+    pixel_shader_desc_t pixelShaderDesc = k15_create_default_pixel_shader_desc(pixelShaderFnc);
+    pixelShaderDesc.interpolationMode = interpolationMode;
+    return k15_create_pixel_shader_from_desc(pContext, &pixelShaderDesc);
+}
+
+pixel_shader_handle_t k15_create_pixel_shader_from_desc(software_rasterizer_context_t* pContext, const pixel_shader_desc_t* pPixelShaderDesc)
 {
     RuntimeAssert(pContext != nullptr);
-    RuntimeAssert(pixelShaderFnc != nullptr);
+    RuntimeAssert(pPixelShaderDesc != nullptr);
+    RuntimeAssert(pPixelShaderDesc->function != nullptr);
+    RuntimeAssert(pPixelShaderDesc->attributeCount <= (uint32_t)vertex_attribute_t::count);
+
+    uint32_t attributeMask = 0u;
+    for(uint32_t attributeIndex = 0; attributeIndex < pPixelShaderDesc->attributeCount; ++attributeIndex)
+    {
+        attributeMask |= 1u << (uint32_t)pPixelShaderDesc->attributes[attributeIndex];
+    }
 
     pixel_shader_t* pPixelShader = _k15_dynamic_buffer_push_back(&pContext->pixelShaders, 1u);
     if( pPixelShader == nullptr )
@@ -2766,30 +5733,253 @@ pixel_shader_handle_t k15_create_pixel_shader(software_rasterizer_context_t* pCo
         return k15_invalid_pixel_shader_handle;
     }
 
-    pPixelShader->function = pixelShaderFnc;
+    pPixelShader->function          = pPixelShaderDesc->function;
+    pPixelShader->interpolationMode = pPixelShaderDesc->interpolationMode;
+    pPixelShader->inputLayout       = pPixelShaderDesc->inputLayout;
+    pPixelShader->quadShadingEnabled = pPixelShaderDesc->quadShadingEnabled;
+    pPixelShader->attributeMask     = attributeMask;
     pixel_shader_handle_t handle = {pPixelShader};
     return handle;
 }
 
-vertex_buffer_handle_t k15_create_vertex_buffer(software_rasterizer_context_t* pContext, const vertex_t* pVertexData, uint32_t vertexCount )
+vertex_buffer_handle_t k15_create_vertex_buffer(software_rasterizer_context_t* pContext, const vertex_t* pVertexData, uint32_t vertexCount)
+{
+    const vertex_layout_t vertexLayout = k15_create_default_vertex_layout();
+    return k15_create_vertex_buffer_with_layout(pContext, pVertexData, vertexCount, &vertexLayout);
+}
+
+internal float _k15_half_to_float(uint16_t half)
+{
+    const __m128i halfWide = _mm_cvtsi32_si128(half);
+    return _mm_cvtss_f32(_mm_cvtph_ps(halfWide));
+}
+
+internal float _k15_snorm8_to_float(uint8_t snorm)
+{
+    return get_max(-1.0f, (float)(int8_t)snorm / 127.0f);
+}
+
+internal vector4f_t _k15_decode_vertex_attribute(const uint8_t* pAttribute, vertex_attribute_format_t format, float defaultW)
+{
+    vector4f_t attribute = {0.0f, 0.0f, 0.0f, defaultW};
+    switch(format)
+    {
+        case vertex_attribute_format_t::float2:
+            memcpy(&attribute, pAttribute, sizeof(float) * 2u);
+            break;
+
+        case vertex_attribute_format_t::float3:
+            memcpy(&attribute, pAttribute, sizeof(float) * 3u);
+            break;
+
+        case vertex_attribute_format_t::float4:
+            memcpy(&attribute, pAttribute, sizeof(float) * 4u);
+            break;
+
+        case vertex_attribute_format_t::half2:
+        case vertex_attribute_format_t::half4:
+        {
+            uint16_t halfs[4];
+            const uint32_t componentCount = format == vertex_attribute_format_t::half2 ? 2u : 4u;
+            memcpy(halfs, pAttribute, sizeof(uint16_t) * componentCount);
+            attribute.x = _k15_half_to_float(halfs[0]);
+            attribute.y = _k15_half_to_float(halfs[1]);
+            if( componentCount == 4u )
+            {
+                attribute.z = _k15_half_to_float(halfs[2]);
+                attribute.w = _k15_half_to_float(halfs[3]);
+            }
+            break;
+        }
+
+        case vertex_attribute_format_t::snorm8x4:
+            attribute.x = _k15_snorm8_to_float(pAttribute[0]);
+            attribute.y = _k15_snorm8_to_float(pAttribute[1]);
+            attribute.z = _k15_snorm8_to_float(pAttribute[2]);
+            attribute.w = _k15_snorm8_to_float(pAttribute[3]);
+            break;
+
+        case vertex_attribute_format_t::unorm8x4:
+            attribute.x = (float)pAttribute[0] / 255.0f;
+            attribute.y = (float)pAttribute[1] / 255.0f;
+            attribute.z = (float)pAttribute[2] / 255.0f;
+            attribute.w = (float)pAttribute[3] / 255.0f;
+            break;
+
+        default:
+            RuntimeAssert(false);
+    }
+
+    return attribute;
+}
+
+vertex_buffer_handle_t k15_create_vertex_buffer_with_layout(software_rasterizer_context_t* pContext, const void* pVertexData, uint32_t vertexCount, const vertex_layout_t* pVertexLayout)
 {
     RuntimeAssert(pContext != nullptr);
     RuntimeAssert(pVertexData != nullptr);
+    RuntimeAssert(pVertexLayout != nullptr);
     RuntimeAssert(vertexCount > 0u);
-    
+    RuntimeAssert(pVertexLayout->attributeCount <= (uint32_t)vertex_attribute_t::count);
+    RuntimeAssert(pVertexLayout->strideInBytes > 0u);
+
+    uint32_t attributeMask = 0u;
+    for(uint32_t attributeIndex = 0u; attributeIndex < pVertexLayout->attributeCount; ++attributeIndex)
+    {
+        const uint32_t attributeBit = 1u << (uint32_t)pVertexLayout->attributes[attributeIndex].attribute;
+        RuntimeAssert(( attributeMask & attributeBit ) == 0u);
+        attributeMask |= attributeBit;
+    }
+    RuntimeAssert(attributeMask & VertexAttributeMaskPosition);
+
+    //FK: Vertices get decoded into separate float streams once so that the geometry stage never has to shuffle them.
+    //    Only attributes of the layout get a stream.
+    const uint32_t vector4SizeInBytes   = _k15_align_to_cache_line(vertexCount * sizeof(vector4f_t));
+    const uint32_t vector2SizeInBytes   = _k15_align_to_cache_line(vertexCount * sizeof(vector2f_t));
+    const uint32_t memorySizeInBytes    = vector4SizeInBytes * ( 1u + ( attributeMask & VertexAttributeMaskNormal ? 1u : 0u ) + ( attributeMask & VertexAttributeMaskColor ? 1u : 0u ) ) + 
+                                          ( attributeMask & VertexAttributeMaskTexcoord ? vector2SizeInBytes : 0u );
+
+    uint8_t* pMemory = (uint8_t*)_mm_malloc(memorySizeInBytes, CacheLineSizeInBytes);
+    if( pMemory == nullptr )
+    {
+        return k15_invalid_vertex_buffer_handle;
+    }
+
+    vertex_buffer_t* pVertexBuffer = _k15_dynamic_buffer_push_back(&pContext->vertexBuffers, 1u);
+    if( pVertexBuffer == nullptr )
+    {
+        _mm_free(pMemory);
+        return k15_invalid_vertex_buffer_handle;
+    }
+
+    uint8_t* pCurrentMemory = pMemory;
+    vector4f_t* pPositions  = (vector4f_t*)pCurrentMemory;                                                  pCurrentMemory += vector4SizeInBytes;
+    vector4f_t* pNormals    = attributeMask & VertexAttributeMaskNormal ? (vector4f_t*)pCurrentMemory : nullptr;   pCurrentMemory += pNormals ? vector4SizeInBytes : 0u;
+    vector4f_t* pColors     = attributeMask & VertexAttributeMaskColor ? (vector4f_t*)pCurrentMemory : nullptr;    pCurrentMemory += pColors ? vector4SizeInBytes : 0u;
+    vector2f_t* pTexcoords  = attributeMask & VertexAttributeMaskTexcoord ? (vector2f_t*)pCurrentMemory : nullptr; pCurrentMemory += pTexcoords ? vector2SizeInBytes : 0u;
+    RuntimeAssert(pCurrentMemory == pMemory + memorySizeInBytes);
+
+    const uint8_t* pVertices = (const uint8_t*)pVertexData;
+    for(uint32_t attributeIndex = 0u; attributeIndex < pVertexLayout->attributeCount; ++attributeIndex)
+    {
+        const vertex_attribute_desc_t* pAttributeDesc = pVertexLayout->attributes + attributeIndex;
+        const uint8_t* pAttributes = pVertices + pAttributeDesc->offsetInBytes;
+        const uint32_t strideInBytes = pVertexLayout->strideInBytes;
+
+        switch(pAttributeDesc->attribute)
+        {
+            case vertex_attribute_t::position:
+                for(uint32_t vertexIndex = 0u; vertexIndex < vertexCount; ++vertexIndex)
+                {
+                    pPositions[vertexIndex] = _k15_decode_vertex_attribute(pAttributes + vertexIndex * strideInBytes, pAttributeDesc->format, 1.0f);
+                }
+                break;
+
+            case vertex_attribute_t::normal:
+                for(uint32_t vertexIndex = 0u; vertexIndex < vertexCount; ++vertexIndex)
+                {
+                    pNormals[vertexIndex] = _k15_decode_vertex_attribute(pAttributes + vertexIndex * strideInBytes, pAttributeDesc->format, 0.0f);
+                }
+                break;
+
+            case vertex_attribute_t::color:
+                for(uint32_t vertexIndex = 0u; vertexIndex < vertexCount; ++vertexIndex)
+                {
+                    pColors[vertexIndex] = _k15_decode_vertex_attribute(pAttributes + vertexIndex * strideInBytes, pAttributeDesc->format, 1.0f);
+                }
+                break;
+
+            case vertex_attribute_t::texcoord:
+                for(uint32_t vertexIndex = 0u; vertexIndex < vertexCount; ++vertexIndex)
+                {
+                    const vector4f_t texcoord = _k15_decode_vertex_attribute(pAttributes + vertexIndex * strideInBytes, pAttributeDesc->format, 0.0f);
+                    pTexcoords[vertexIndex] = k15_create_vector2f(texcoord.x, texcoord.y);
+                }
+                break;
+
+            default:
+                RuntimeAssert(false);
+        }
+    }
+
+    pVertexBuffer->vertexCount          = vertexCount;
+    pVertexBuffer->attributeMask        = attributeMask;
+    pVertexBuffer->pMemory              = pMemory;
+    pVertexBuffer->streams.pPositions   = pPositions;
+    pVertexBuffer->streams.pNormals     = pNormals;
+    pVertexBuffer->streams.pColors      = pColors;
+    pVertexBuffer->streams.pTexcoords   = pTexcoords;
+
+    vertex_buffer_handle_t handle = {pVertexBuffer};
+    return handle;
+}
+
+//FK: Other than k15_create_vertex_buffer the streams don't get copied, they have to stay alive as long as the vertex buffer is used
+vertex_buffer_handle_t k15_create_vertex_buffer_from_streams(software_rasterizer_context_t* pContext, const vertex_streams_t* pVertexStreams, uint32_t vertexCount)
+{
+    RuntimeAssert(pContext != nullptr);
+    RuntimeAssert(pVertexStreams != nullptr);
+    RuntimeAssert(pVertexStreams->pPositions != nullptr);
+    RuntimeAssert(vertexCount > 0u);
+
     vertex_buffer_t* pVertexBuffer = _k15_dynamic_buffer_push_back(&pContext->vertexBuffers, 1u);
     if( pVertexBuffer == nullptr )
     {
         return k15_invalid_vertex_buffer_handle;
     }
 
-    pVertexBuffer->vertexCount  = vertexCount;
-    pVertexBuffer->pData        = pVertexData;
+    pVertexBuffer->vertexCount      = vertexCount;
+    pVertexBuffer->pMemory          = nullptr;
+    pVertexBuffer->streams          = *pVertexStreams;
+    pVertexBuffer->attributeMask    = VertexAttributeMaskPosition;
+    pVertexBuffer->attributeMask    |= pVertexStreams->pNormals != nullptr ? VertexAttributeMaskNormal : 0u;
+    pVertexBuffer->attributeMask    |= pVertexStreams->pColors != nullptr ? VertexAttributeMaskColor : 0u;
+    pVertexBuffer->attributeMask    |= pVertexStreams->pTexcoords != nullptr ? VertexAttributeMaskTexcoord : 0u;
 
     vertex_buffer_handle_t handle = {pVertexBuffer};
     return handle;
 }
 
+index_buffer_handle_t k15_create_index_buffer(software_rasterizer_context_t* pContext, const void* pIndexData, uint32_t indexCount, index_format_t indexFormat)
+{
+    RuntimeAssert(pContext != nullptr);
+    RuntimeAssert(pIndexData != nullptr);
+    RuntimeAssert(indexCount > 0u);
+
+    index_buffer_t* pIndexBuffer = _k15_dynamic_buffer_push_back(&pContext->indexBuffers, 1u);
+    if( pIndexBuffer == nullptr )
+    {
+        return k15_invalid_index_buffer_handle;
+    }
+
+    pIndexBuffer->indexCount    = indexCount;
+    pIndexBuffer->format        = indexFormat;
+    pIndexBuffer->pData         = pIndexData;
+
+    index_buffer_handle_t handle = {pIndexBuffer};
+    return handle;
+}
+
+instance_buffer_handle_t k15_create_instance_buffer(software_rasterizer_context_t* pContext, const void* pInstanceData, uint32_t instanceDataStrideInBytes, uint32_t instanceCount)
+{
+    RuntimeAssert(pContext != nullptr);
+    RuntimeAssert(pInstanceData != nullptr);
+    RuntimeAssert(instanceDataStrideInBytes > 0u);
+    RuntimeAssert(instanceCount > 0u);
+
+    instance_buffer_t* pInstanceBuffer = _k15_dynamic_buffer_push_back(&pContext->instanceBuffers, 1u);
+    if( pInstanceBuffer == nullptr )
+    {
+        return k15_invalid_instance_buffer_handle;
+    }
+
+    pInstanceBuffer->instanceCount  = instanceCount;
+    pInstanceBuffer->strideInBytes  = instanceDataStrideInBytes;
+    pInstanceBuffer->pData          = (const uint8_t*)pInstanceData;
+
+    instance_buffer_handle_t handle = {pInstanceBuffer};
+    return handle;
+}
+
 uniform_buffer_handle_t k15_create_uniform_buffer(software_rasterizer_context_t* pContext, uint32_t uniformBufferSizeInBytes)
 {
     RuntimeAssert(pContext != nullptr);
@@ -2873,6 +6063,22 @@ void k15_bind_vertex_buffer(software_rasterizer_context_t* pContext, vertex_buff
     pContext->pBoundVertexBuffer = (vertex_buffer_t*)vertexBuffer.pHandle;
 }
 
+void k15_bind_index_buffer(software_rasterizer_context_t* pContext, index_buffer_handle_t indexBuffer)
+{
+    RuntimeAssert(pContext != nullptr);
+    RuntimeAssert(k15_is_valid_index_buffer(indexBuffer));
+
+    pContext->pBoundIndexBuffer = (index_buffer_t*)indexBuffer.pHandle;
+}
+
+void k15_bind_instance_buffer(software_rasterizer_context_t* pContext, instance_buffer_handle_t instanceBuffer)
+{
+    RuntimeAssert(pContext != nullptr);
+    RuntimeAssert(k15_is_valid_instance_buffer(instanceBuffer));
+
+    pContext->pBoundInstanceBuffer = (instance_buffer_t*)instanceBuffer.pHandle;
+}
+
 void k15_bind_uniform_buffer(software_rasterizer_context_t* pContext, uniform_buffer_handle_t uniformBuffer)
 {
     RuntimeAssert(pContext != nullptr);
@@ -2890,19 +6096,12 @@ void k15_bind_texture(software_rasterizer_context_t* pContext, texture_handle_t
     pContext->boundTextures[slot] = (texture_t*)texture.pHandle;
 }
 
-bool k15_draw(software_rasterizer_context_t* pContext, uint32_t vertexCount, uint32_t vertexOffset)
+internal draw_call_t* _k15_push_draw_call(software_rasterizer_context_t* pContext)
 {
-    RuntimeAssert(pContext != nullptr);
-    RuntimeAssert(pContext->pBoundVertexBuffer != nullptr);
-    RuntimeAssert(pContext->pBoundVertexShader != nullptr);
-    RuntimeAssert(pContext->pBoundPixelShader != nullptr);
-    RuntimeAssert(pContext->pBoundVertexBuffer->vertexCount >= vertexOffset + vertexCount);
-    RuntimeAssert(vertexCount > 0u && ( vertexCount % 3u ) == 0);
-
     draw_call_t* pDrawCall = _k15_dynamic_buffer_push_back(&pContext->drawCalls, 1u);
     if( pDrawCall == nullptr )
     {
-        return false;
+        return nullptr;
     }
 
     if( pContext->pBoundUniformBuffer != nullptr )
@@ -2911,7 +6110,8 @@ bool k15_draw(software_rasterizer_context_t* pContext, uint32_t vertexCount, uin
         void* pDrawCallUniformBufferData = _k15_allocate_from_stack_allocator(pContext->pDrawCallDataAllocator, pUniformBuffer->dataSizeInBytes);
         if( pDrawCallUniformBufferData == nullptr )
         {
-            return false;
+            --pContext->drawCalls.count;
+            return nullptr;
         }
 
         memcpy(pDrawCallUniformBufferData, pUniformBuffer->pData, pUniformBuffer->dataSizeInBytes);
@@ -2925,12 +6125,293 @@ bool k15_draw(software_rasterizer_context_t* pContext, uint32_t vertexCount, uin
 
     pDrawCall->vertexShader             = pContext->pBoundVertexShader->function;
     pDrawCall->pixelShader              = pContext->pBoundPixelShader->function;
+    pDrawCall->interpolationMode        = pContext->pBoundPixelShader->interpolationMode;
+    pDrawCall->pixelShaderInputLayout   = pContext->pBoundPixelShader->inputLayout;
+    pDrawCall->quadShadingEnabled       = pContext->pBoundPixelShader->quadShadingEnabled;
     pDrawCall->pVertexBuffer            = pContext->pBoundVertexBuffer;
+    pDrawCall->pIndexBuffer             = nullptr;
+    pDrawCall->pInstanceBuffer          = nullptr;
+    pDrawCall->vertexCount              = 0u;
+    pDrawCall->vertexOffset             = 0u;
+    pDrawCall->indexCount               = 0u;
+    pDrawCall->indexOffset              = 0u;
+    pDrawCall->instanceCount            = 1u;
+    pDrawCall->attributeMask            = pContext->pBoundVertexBuffer->attributeMask & ( pContext->pBoundPixelShader->attributeMask | VertexAttributeMaskPosition );
+    pDrawCall->occlusionBounds          = pContext->nextDrawCallOcclusionBounds;
+    pDrawCall->pOcclusionQueryResult    = pContext->pNextDrawCallOcclusionQueryResult;
+    pDrawCall->hasOcclusionBounds       = pContext->nextDrawCallHasOcclusionBounds;
+    pDrawCall->frustumCoverage          = pContext->nextDrawCallFrustumCoverage;
+
+    pContext->pNextDrawCallOcclusionQueryResult = nullptr;
+    pContext->nextDrawCallHasOcclusionBounds    = false;
+    pContext->nextDrawCallFrustumCoverage       = frustum_coverage_t::partial;
+
+    return pDrawCall;
+}
+
+bool k15_draw(software_rasterizer_context_t* pContext, uint32_t vertexCount, uint32_t vertexOffset)
+{
+    RuntimeAssert(pContext != nullptr);
+    RuntimeAssert(pContext->pBoundVertexBuffer != nullptr);
+    RuntimeAssert(pContext->pBoundVertexShader != nullptr);
+    RuntimeAssert(pContext->pBoundPixelShader != nullptr);
+    RuntimeAssert(pContext->pBoundVertexBuffer->vertexCount >= vertexOffset + vertexCount);
+    RuntimeAssert(vertexCount > 0u && ( vertexCount % 3u ) == 0);
+
+    draw_call_t* pDrawCall = _k15_push_draw_call(pContext);
+    if( pDrawCall == nullptr )
+    {
+        return false;
+    }
+
     pDrawCall->vertexCount              = vertexCount;
     pDrawCall->vertexOffset             = vertexOffset;
 
     return true;
 }
 
+bool k15_draw_indexed(software_rasterizer_context_t* pContext, uint32_t indexCount, uint32_t indexOffset, uint32_t baseVertex)
+{
+    RuntimeAssert(pContext != nullptr);
+    RuntimeAssert(pContext->pBoundVertexBuffer != nullptr);
+    RuntimeAssert(pContext->pBoundIndexBuffer != nullptr);
+    RuntimeAssert(pContext->pBoundVertexShader != nullptr);
+    RuntimeAssert(pContext->pBoundPixelShader != nullptr);
+    RuntimeAssert(pContext->pBoundIndexBuffer->indexCount >= indexOffset + indexCount);
+    RuntimeAssert(pContext->pBoundVertexBuffer->vertexCount > baseVertex);
+    RuntimeAssert(indexCount > 0u && ( indexCount % 3u ) == 0);
+
+    draw_call_t* pDrawCall = _k15_push_draw_call(pContext);
+    if( pDrawCall == nullptr )
+    {
+        return false;
+    }
+
+    pDrawCall->pIndexBuffer             = pContext->pBoundIndexBuffer;
+    pDrawCall->vertexOffset             = baseVertex;
+    pDrawCall->indexCount               = indexCount;
+    pDrawCall->indexOffset              = indexOffset;
+
+    return true;
+}
+
+//FK: Draws instanceCount instances of the bound vertex buffer with a single draw call.
+//    The vertex shader gets the instance id and - if an instance buffer is bound - the data of the current instance
+//    via vertex_shader_input_t. Uniform data gets copied only once for all instances.
+bool k15_draw_instanced(software_rasterizer_context_t* pContext, uint32_t vertexCount, uint32_t instanceCount)
+{
+    RuntimeAssert(pContext != nullptr);
+    RuntimeAssert(pContext->pBoundVertexBuffer != nullptr);
+    RuntimeAssert(pContext->pBoundVertexShader != nullptr);
+    RuntimeAssert(pContext->pBoundPixelShader != nullptr);
+    RuntimeAssert(pContext->pBoundVertexBuffer->vertexCount >= vertexCount);
+    RuntimeAssert(pContext->pBoundInstanceBuffer == nullptr || pContext->pBoundInstanceBuffer->instanceCount >= instanceCount);
+    RuntimeAssert(vertexCount > 0u && ( vertexCount % 3u ) == 0);
+    RuntimeAssert(instanceCount > 0u);
+
+    draw_call_t* pDrawCall = _k15_push_draw_call(pContext);
+    if( pDrawCall == nullptr )
+    {
+        return false;
+    }
+
+    pDrawCall->pInstanceBuffer          = pContext->pBoundInstanceBuffer;
+    pDrawCall->vertexCount              = vertexCount;
+    pDrawCall->instanceCount            = instanceCount;
+
+    return true;
+}
+
+//FK: Indexed counterpart of k15_draw_instanced, indices are relative to baseVertex.
+//    Vertices get transformed once per instance and job through the post transform cache.
+bool k15_draw_indexed_instanced(software_rasterizer_context_t* pContext, uint32_t indexCount, uint32_t indexOffset, uint32_t baseVertex, uint32_t instanceCount)
+{
+    RuntimeAssert(pContext != nullptr);
+    RuntimeAssert(pContext->pBoundVertexBuffer != nullptr);
+    RuntimeAssert(pContext->pBoundIndexBuffer != nullptr);
+    RuntimeAssert(pContext->pBoundVertexShader != nullptr);
+    RuntimeAssert(pContext->pBoundPixelShader != nullptr);
+    RuntimeAssert(pContext->pBoundIndexBuffer->indexCount >= indexOffset + indexCount);
+    RuntimeAssert(pContext->pBoundVertexBuffer->vertexCount > baseVertex);
+    RuntimeAssert(pContext->pBoundInstanceBuffer == nullptr || pContext->pBoundInstanceBuffer->instanceCount >= instanceCount);
+    RuntimeAssert(indexCount > 0u && ( indexCount % 3u ) == 0);
+    RuntimeAssert(instanceCount > 0u);
+
+    draw_call_t* pDrawCall = _k15_push_draw_call(pContext);
+    if( pDrawCall == nullptr )
+    {
+        return false;
+    }
+
+    pDrawCall->pIndexBuffer             = pContext->pBoundIndexBuffer;
+    pDrawCall->pInstanceBuffer          = pContext->pBoundInstanceBuffer;
+    pDrawCall->vertexOffset             = baseVertex;
+    pDrawCall->indexCount               = indexCount;
+    pDrawCall->indexOffset              = indexOffset;
+    pDrawCall->instanceCount            = instanceCount;
+
+    return true;
+}
+
+//FK: Classifies the bounds against the frustum and projects them for the occlusion test.
+//    Clip space planes are linear, so the bounds are outside if all corners are outside of the same plane and
+//    inside if no corner is outside of any plane.
+internal void _k15_set_next_draw_call_bounds(software_rasterizer_context_t* pContext, const vector3f_t* pMin, const vector3f_t* pMax, const matrix4x4f_t* pClipSpaceTransform, occlusion_query_result_t* pOutQueryResult)
+{
+    if( pOutQueryResult != nullptr )
+    {
+        *pOutQueryResult = occlusion_query_result_t::pending;
+    }
+
+    occlusion_bounds_t bounds;
+    bounds.min      = { FLT_MAX, FLT_MAX };
+    bounds.max      = { -FLT_MAX, -FLT_MAX };
+    bounds.maxDepth = -FLT_MAX;
+
+    uint8_t clippingFlagsAnd = 0xFFu;
+    uint8_t clippingFlagsOr = 0u;
+    bool canBeProjected = true;
+
+    for(uint32_t cornerIndex = 0u; cornerIndex < 8u; ++cornerIndex)
+    {
+        const vector4f_t corner = {
+            cornerIndex & 1u ? pMax->x : pMin->x,
+            cornerIndex & 2u ? pMax->y : pMin->y,
+            cornerIndex & 4u ? pMax->z : pMin->z,
+            1.0f
+        };
+
+        const vector4f_t clipSpaceCorner = _k15_mul_vector4_matrix44(&corner, pClipSpaceTransform);
+        const uint8_t clippingFlags = _k15_get_position_clipping_flags(clipSpaceCorner);
+        clippingFlagsAnd &= clippingFlags;
+        clippingFlagsOr |= clippingFlags;
+
+        if( clipSpaceCorner.w <= 0.0f )
+        {
+            //FK: Bounds that reach behind the camera can't be projected, the occlusion test always considers them visible
+            canBeProjected = false;
+            continue;
+        }
+
+        const float x = clipSpaceCorner.x / clipSpaceCorner.w;
+        const float y = clipSpaceCorner.y / clipSpaceCorner.w;
+        const float depth = 1.0f - clipSpaceCorner.z / clipSpaceCorner.w;
+
+        bounds.min.x    = get_min(bounds.min.x, x);
+        bounds.min.y    = get_min(bounds.min.y, y);
+        bounds.max.x    = get_max(bounds.max.x, x);
+        bounds.max.y    = get_max(bounds.max.y, y);
+        bounds.maxDepth = get_max(bounds.maxDepth, depth);
+    }
+
+    frustum_coverage_t frustumCoverage = frustum_coverage_t::partial;
+    if( clippingFlagsAnd != 0u )
+    {
+        frustumCoverage = frustum_coverage_t::outside;
+    }
+    else if( clippingFlagsOr == 0u )
+    {
+        frustumCoverage = frustum_coverage_t::inside;
+    }
+
+    pContext->nextDrawCallOcclusionBounds       = bounds;
+    pContext->pNextDrawCallOcclusionQueryResult = pOutQueryResult;
+    pContext->nextDrawCallHasOcclusionBounds    = canBeProjected;
+    pContext->nextDrawCallFrustumCoverage       = frustumCoverage;
+}
+
+//FK: Sets the bounds of the next draw call. pClipSpaceTransform transforms the bounds to clip space - usually the same
+//    matrix the vertex shader uses - bounds of instanced draw calls have to contain all instances.
+//    The draw call gets skipped entirely if its bounds are outside of the frustum or hidden behind the depth of the most
+//    recent completed frame, objects that get uncovered by camera movement can therefore show up one frame late.
+//    Draw calls whose bounds are fully inside of the frustum skip clipping.
+//    pOutQueryResult is optional and has to stay valid until k15_draw_frame returns.
+void k15_set_draw_bounds(software_rasterizer_context_t* pContext, const vector3f_t* pMin, const vector3f_t* pMax, const matrix4x4f_t* pClipSpaceTransform, occlusion_query_result_t* pOutQueryResult)
+{
+    RuntimeAssert(pContext != nullptr);
+    RuntimeAssert(pMin != nullptr && pMax != nullptr);
+    RuntimeAssert(pClipSpaceTransform != nullptr);
+
+    _k15_set_next_draw_call_bounds(pContext, pMin, pMax, pClipSpaceTransform, pOutQueryResult);
+}
+
+//FK: Same as k15_set_draw_bounds with a bounding sphere. The frustum test uses the frustum planes of pClipSpaceTransform
+//    which is tighter than the box of the sphere for spheres close to the corners of the frustum.
+void k15_set_draw_bounding_sphere(software_rasterizer_context_t* pContext, const vector3f_t* pCenter, float radius, const matrix4x4f_t* pClipSpaceTransform, occlusion_query_result_t* pOutQueryResult)
+{
+    RuntimeAssert(pContext != nullptr);
+    RuntimeAssert(pCenter != nullptr);
+    RuntimeAssert(pClipSpaceTransform != nullptr);
+    RuntimeAssert(radius >= 0.0f);
+
+    const vector3f_t min = { pCenter->x - radius, pCenter->y - radius, pCenter->z - radius };
+    const vector3f_t max = { pCenter->x + radius, pCenter->y + radius, pCenter->z + radius };
+    _k15_set_next_draw_call_bounds(pContext, &min, &max, pClipSpaceTransform, pOutQueryResult);
+
+    //FK: Frustum planes are row 3 +/- row 0..2 of the matrix (-w <= x,y,z <= w)
+    const matrix4x4f_t* pMatrix = pClipSpaceTransform;
+    const vector4f_t rows[4] = {
+        { pMatrix->m00, pMatrix->m01, pMatrix->m02, pMatrix->m03 },
+        { pMatrix->m10, pMatrix->m11, pMatrix->m12, pMatrix->m13 },
+        { pMatrix->m20, pMatrix->m21, pMatrix->m22, pMatrix->m23 },
+        { pMatrix->m30, pMatrix->m31, pMatrix->m32, pMatrix->m33 }
+    };
+
+    frustum_coverage_t frustumCoverage = frustum_coverage_t::inside;
+    for(uint32_t planeIndex = 0u; planeIndex < 6u; ++planeIndex)
+    {
+        const vector4f_t row = rows[planeIndex / 2u];
+        const float sign = ( planeIndex & 1u ) ? -1.0f : 1.0f;
+        const vector3f_t planeNormal = { rows[3].x + sign * row.x, rows[3].y + sign * row.y, rows[3].z + sign * row.z };
+        const float planeDistance = rows[3].w + sign * row.w;
+
+        const float planeNormalLength = sqrtf(k15_vector3f_dot(planeNormal, planeNormal));
+        const float distance = k15_vector3f_dot(planeNormal, *pCenter) + planeDistance;
+        if( distance < -radius * planeNormalLength )
+        {
+            frustumCoverage = frustum_coverage_t::outside;
+            break;
+        }
+
+        if( distance < radius * planeNormalLength )
+        {
+            frustumCoverage = frustum_coverage_t::partial;
+        }
+    }
+
+    pContext->nextDrawCallFrustumCoverage = frustumCoverage;
+}
+
+uint32_t k15_get_worker_thread_count(const software_rasterizer_context_t* pContext)
+{
+    RuntimeAssert(pContext != nullptr);
+    return pContext->pJobSystem->workerThreadCount;
+}
+
+bool k15_submit_jobs(software_rasterizer_context_t* pContext, job_fnc_t jobFunction, void* pJobData, uint32_t jobDataStrideInBytes, uint32_t jobCount, job_counter_t* pJobCounter)
+{
+    RuntimeAssert(pContext != nullptr);
+    RuntimeAssert(jobFunction != nullptr);
+    RuntimeAssert(pJobCounter != nullptr);
+
+    job_system_t* pJobSystem = pContext->pJobSystem;
+    return _k15_submit_jobs(pJobSystem, jobFunction, pJobData, jobDataStrideInBytes, jobCount, pJobCounter, _k15_get_current_worker_index(pJobSystem));
+}
+
+void k15_wait_for_jobs(software_rasterizer_context_t* pContext, job_counter_t* pJobCounter)
+{
+    RuntimeAssert(pContext != nullptr);
+    RuntimeAssert(pJobCounter != nullptr);
+
+    job_system_t* pJobSystem = pContext->pJobSystem;
+    _k15_wait_for_jobs(pJobSystem, pJobCounter, _k15_get_current_worker_index(pJobSystem));
+}
+
+bool k15_are_jobs_finished(const job_counter_t* pJobCounter)
+{
+    RuntimeAssert(pJobCounter != nullptr);
+    return pJobCounter->pendingJobCount.load(std::memory_order_acquire) == 0u;
+}
+
 #endif //K15_SOFTWARE_RASTERIZER_IMPLEMENTATION
 #endif //K15_SOFTWARE_RASTERIZER_INCLUDE
\ No newline at end of file
@@ -16,8 +16,8 @@ int test_matrix_multiplications()
 {
     matrix4x4f_t identityMatrix = {};
     matrix4x4f_t scaleMatrix = {};
-    _k15_set_identity_matrix4x4f(&identityMatrix);
-    _k15_set_identity_matrix4x4f(&scaleMatrix);
+    k15_set_identity_matrix4x4f(&identityMatrix);
+    k15_set_identity_matrix4x4f(&scaleMatrix);
 
     scaleMatrix.m00 = 2.0f;
     scaleMatrix.m11 = 2.0f;
@@ -33,7 +33,7 @@ int test_vector_matrix_multiplications()
     matrix4x4f_t matrix = {};
     vector4f_t vector = k15_create_vector4f(0.0f, 0.0f, 0.0f, 1.0f);
 
-    _k15_set_identity_matrix4x4f(&matrix);
+    k15_set_identity_matrix4x4f(&matrix);
 
     matrix.m03 = 10.0f;
     matrix.m13 = 20.0f;
@@ -41,7 +41,7 @@ int test_vector_matrix_multiplications()
 
     vector4f_t newVector = _k15_mul_vector4_matrix44(&vector, &matrix);
 
-    _k15_set_identity_matrix4x4f(&matrix);
+    k15_set_identity_matrix4x4f(&matrix);
     matrix.m00 = 2.0f;
     matrix.m11 = 2.0f;
     matrix.m22 = 2.0f;
@@ -50,9 +50,218 @@ int test_vector_matrix_multiplications()
     return newVector.x == 20.0f && newVector.y == 40.0f && newVector.z == 60.0f;
 }
 
+//FK: Number of triangles whose edge functions cover pixel (x,y), triangles are given in pixel coordinates
+uint32_t count_raster_edge_coverage(const vector2i_t (*pTriangles)[3], uint32_t triangleCount, uint32_t x, uint32_t y)
+{
+    uint32_t coverageCount = 0u;
+    for(uint32_t triangleIndex = 0u; triangleIndex < triangleCount; ++triangleIndex)
+    {
+        vector2i_t fixedPointVertexPositions[3];
+        for(uint32_t vertexIndex = 0u; vertexIndex < 3u; ++vertexIndex)
+        {
+            fixedPointVertexPositions[vertexIndex].x = pTriangles[triangleIndex][vertexIndex].x << SubPixelBits;
+            fixedPointVertexPositions[vertexIndex].y = pTriangles[triangleIndex][vertexIndex].y << SubPixelBits;
+        }
+
+        raster_edge_t edges[3];
+        if(_k15_setup_raster_edges(edges, fixedPointVertexPositions) <= 0)
+        {
+            continue;
+        }
+
+        if(_k15_evaluate_raster_edge(edges + 0, x, y) >= 0 &&
+           _k15_evaluate_raster_edge(edges + 1, x, y) >= 0 &&
+           _k15_evaluate_raster_edge(edges + 2, x, y) >= 0)
+        {
+            ++coverageCount;
+        }
+    }
+
+    return coverageCount;
+}
+
+int test_raster_edges_top_left_rule()
+{
+    //FK: Quad (0,0) - (16,16) split along its diagonal and a fan of 4 triangles around its center.
+    //    Vertices are on pixel centers, so a lot of pixels are exactly on the shared edges.
+    const vector2i_t quadTriangles[2][3] = {
+        {{0, 0}, {16, 16}, {16, 0}},
+        {{0, 0}, {0, 16}, {16, 16}}
+    };
+
+    const vector2i_t fanTriangles[4][3] = {
+        {{8, 8}, {16, 0}, {0, 0}},
+        {{8, 8}, {16, 16}, {16, 0}},
+        {{8, 8}, {0, 16}, {16, 16}},
+        {{8, 8}, {0, 0}, {0, 16}}
+    };
+
+    for(uint32_t y = 0u; y <= 20u; ++y)
+    {
+        for(uint32_t x = 0u; x <= 20u; ++x)
+        {
+            const bool isInsideQuad = x > 0u && x < 16u && y > 0u && y < 16u;
+            const uint32_t expectedMinCoverageCount = isInsideQuad ? 1u : 0u;
+
+            const uint32_t quadCoverageCount = count_raster_edge_coverage(quadTriangles, 2u, x, y);
+            const uint32_t fanCoverageCount = count_raster_edge_coverage(fanTriangles, 4u, x, y);
+            if(quadCoverageCount > 1u || quadCoverageCount < expectedMinCoverageCount)
+            {
+                return 0;
+            }
+
+            if(fanCoverageCount > 1u || fanCoverageCount < expectedMinCoverageCount)
+            {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+float get_signed_triangle_area(const vector4f_t& a, const vector4f_t& b, const vector4f_t& c)
+{
+    return ( ( b.x - a.x ) * ( c.y - a.y ) - ( b.y - a.y ) * ( c.x - a.x ) ) * 0.5f;
+}
+
+int test_clip_triangle_corner_fan()
+{
+    //FK: Triangle (0,0), (1.5,0), (0,1.5) clipped against x <= w and y <= w. The corner that gets cut off turns the
+    //    triangle into the pentagon (0,0), (1,0), (1,0.5), (0.5,1), (0,1) (area 0.875) which has to come out as a fan of
+    //    3 triangles. The color of every vertex is its position, so interpolated attributes can be checked as well.
+    const vector4f_t positions[3] = {
+        k15_create_vector4f(0.0f, 0.0f, 0.0f, 1.0f),
+        k15_create_vector4f(1.5f, 0.0f, 0.0f, 1.0f),
+        k15_create_vector4f(0.0f, 1.5f, 0.0f, 1.0f)
+    };
+
+    triangle_t triangle;
+    for(uint32_t vertexIndex = 0u; vertexIndex < 3u; ++vertexIndex)
+    {
+        triangle.vertices[vertexIndex] = k15_create_vertex(positions[vertexIndex], k15_create_vector4f(0.0f, 0.0f, 1.0f, 0.0f), positions[vertexIndex], k15_create_vector2f(0.0f, 0.0f));
+    }
+
+    vector4f_t clipPlanes[ClipPlaneCount];
+    _k15_get_clip_planes(clipPlanes, k15_create_vector2f(1.0f, 1.0f));
+
+    dynamic_buffer_t<triangle_t> clippedTriangles;
+    if(!_k15_create_dynamic_buffer(&clippedTriangles, 8u))
+    {
+        return -1;
+    }
+
+    const uint32_t clipPlaneMask = ( 1u << 1u ) | ( 1u << 3u );
+    const bool clipped = _k15_clip_triangle(&triangle, clipPlanes, clipPlaneMask, &clippedTriangles);
+
+    int result = clipped && clippedTriangles.count == 3u ? 1 : 0;
+    const float epsilon = 0.0001f;
+    float clippedArea = 0.0f;
+    for(uint32_t triangleIndex = 0u; result == 1 && triangleIndex < clippedTriangles.count; ++triangleIndex)
+    {
+        const triangle_t* pTriangle = clippedTriangles.pData + triangleIndex;
+
+        //FK: Fan around the first polygon vertex, neighbouring triangles share an edge
+        if(memcmp(&pTriangle->vertices[0], &clippedTriangles.pData[0].vertices[0], sizeof(vertex_t)) != 0)
+        {
+            result = 0;
+        }
+
+        if(triangleIndex > 0u && memcmp(&pTriangle->vertices[1], &clippedTriangles.pData[triangleIndex - 1u].vertices[2], sizeof(vertex_t)) != 0)
+        {
+            result = 0;
+        }
+
+        for(uint32_t vertexIndex = 0u; vertexIndex < 3u; ++vertexIndex)
+        {
+            const vertex_t* pVertex = pTriangle->vertices + vertexIndex;
+            if(pVertex->position.x > 1.0f + epsilon || pVertex->position.y > 1.0f + epsilon ||
+               fabsf(pVertex->color.x - pVertex->position.x) > epsilon || fabsf(pVertex->color.y - pVertex->position.y) > epsilon)
+            {
+                result = 0;
+            }
+        }
+
+        //FK: Clipping must not flip the winding order
+        const float area = get_signed_triangle_area(pTriangle->vertices[0].position, pTriangle->vertices[1].position, pTriangle->vertices[2].position);
+        if(area <= 0.0f)
+        {
+            result = 0;
+        }
+
+        clippedArea += area;
+    }
+
+    if(fabsf(clippedArea - 0.875f) > epsilon)
+    {
+        result = 0;
+    }
+
+    _k15_destroy_dynamic_buffer(&clippedTriangles);
+    return result;
+}
+
+int test_post_transform_cache_slots()
+{
+    post_transform_cache_t postTransformCache;
+    if(!_k15_create_post_transform_cache(&postTransformCache))
+    {
+        return -1;
+    }
+
+    //FK: Vertex indices that are PostTransformCacheHashTableSize apart end up in the same hash table entry and have to be probed.
+    //    Slots get assigned in order of the first occurrence of a vertex index.
+    const uint32_t vertexIndices[] = {
+        7u, 3u, 7u + PostTransformCacheHashTableSize, 3u, 0u, 7u, 7u + PostTransformCacheHashTableSize, 0u, 5u
+    };
+
+    const uint32_t expectedSlots[] = {
+        0u, 1u, 2u, 1u, 3u, 0u, 2u, 3u, 4u
+    };
+
+    constexpr uint32_t indexCount = sizeof(vertexIndices) / sizeof(vertexIndices[0]);
+    memcpy(postTransformCache.pIndexSlots, vertexIndices, sizeof(vertexIndices));
+
+    int result = _k15_assign_post_transform_cache_slots(&postTransformCache, indexCount) == 5u ? 1 : 0;
+    for(uint32_t index = 0u; index < indexCount; ++index)
+    {
+        if(postTransformCache.pIndexSlots[index] != expectedSlots[index] ||
+           postTransformCache.pUniqueVertexIndices[expectedSlots[index]] != vertexIndices[index])
+        {
+            result = 0;
+        }
+    }
+
+    //FK: A full job where every vertex gets referenced by 3 indices, slots of the previous job must not leak into this one.
+    for(uint32_t index = 0u; index < GeometryJobIndexCount; ++index)
+    {
+        postTransformCache.pIndexSlots[index] = ( index % ( GeometryJobIndexCount / 3u ) ) * 3u;
+    }
+
+    if(_k15_assign_post_transform_cache_slots(&postTransformCache, GeometryJobIndexCount) != GeometryJobIndexCount / 3u)
+    {
+        result = 0;
+    }
+
+    for(uint32_t index = 0u; index < GeometryJobIndexCount; ++index)
+    {
+        const uint32_t expectedSlot = index % ( GeometryJobIndexCount / 3u );
+        if(postTransformCache.pIndexSlots[index] != expectedSlot || postTransformCache.pUniqueVertexIndices[expectedSlot] != expectedSlot * 3u)
+        {
+            result = 0;
+        }
+    }
+
+    _mm_free(postTransformCache.pMemory);
+    return result;
+}
+
 constexpr test_t tests[] = {
     TEST(test_matrix_multiplications),
-    TEST(test_vector_matrix_multiplications)
+    TEST(test_vector_matrix_multiplications),
+    TEST(test_raster_edges_top_left_rule),
+    TEST(test_clip_triangle_corner_fan),
+    TEST(test_post_transform_cache_slots)
 };
 
 constexpr uint32_t testCount = sizeof(tests) / sizeof(test_t);
@@ -60,6 +60,7 @@ int screenHeight = virtualScreenHeight*screenScaleFactor;
 bool appHasFocus = true;
 bool drawDepthBuffer = false;
 bool drawWireframe = false;
+bool depthPrepassEnabled = false;
 
 vector4f_t cameraPos = {0.442f, -0.059f, 3.057f, 1.0f};
 vector4f_t cameraVelocity = {};
@@ -90,8 +91,9 @@ constexpr vertex_t test_quad_vertices[] = {
 
 struct loaded_model_t
 {
-	vertex_buffer_handle_t 	vertexBuffers[6];
+	vertex_buffer_handle_t 	vertexBuffer;
 	texture_handle_t 		textures[6];
+	uint32_t 				vertexOffsets[6];
 	uint32_t 				vertexCounts[6];
 	uint32_t 				subModelCount;
 };
@@ -390,35 +392,32 @@ struct scn_material_t
 	char normalMapPath[128];
 };
 
-vertex_buffer_handle_t extractVerticesForMaterialFromWavefrontModel(software_rasterizer_context_t* restrict_modifier pContext, const char* restrict_modifier pModelFilePath, wavefront_material_t* restrict_modifier pMaterial, uint32_t* restrict_modifier pOutVertexCount, float scaleFactor)
+//FK: Appends the vertices of the given material to pVertices so that all materials of a model can share one vertex buffer.
+//    The sub range of this material is returned via pOutVertexOffset and pOutVertexCount.
+bool extractVerticesForMaterialFromWavefrontModel(dynamic_buffer_t<vertex_t>* restrict_modifier pVertices, const char* restrict_modifier pModelFilePath, wavefront_material_t* restrict_modifier pMaterial, uint32_t* restrict_modifier pOutVertexOffset, uint32_t* restrict_modifier pOutVertexCount, float scaleFactor)
 {
 	Win32FileMapping modelFileMapping;
 	if(!mapFileForReading(&modelFileMapping, pModelFilePath))
 	{
-		return k15_invalid_vertex_buffer_handle;
+		return false;
 	}
 
 	const char* pFileStart 	= (const char*)modelFileMapping.pFileBaseAddress;
 	const char* pFileEnd 	= (const char*)modelFileMapping.pFileBaseAddress + modelFileMapping.fileSizeInBytes;
 
-	dynamic_buffer_t<vertex_t> vertices = {};
-	if( !_k15_create_dynamic_buffer( &vertices, 128u ) )
-	{
-		unmapFileMapping(&modelFileMapping);
-		return k15_invalid_vertex_buffer_handle;
-	}
-	
+	const uint32_t vertexOffset = pVertices->count;
 	uint32_t vertexCountForThisMaterial = 0;
-	if(!assembleVerticesForMaterial(pMaterial == nullptr ? nullptr : pMaterial->materialName, &vertexCountForThisMaterial, &vertices, pFileStart, pFileEnd, scaleFactor))
+	if(!assembleVerticesForMaterial(pMaterial == nullptr ? nullptr : pMaterial->materialName, &vertexCountForThisMaterial, pVertices, pFileStart, pFileEnd, scaleFactor))
 	{
 		unmapFileMapping(&modelFileMapping);
-		return k15_invalid_vertex_buffer_handle;
+		return false;
 	}
 
 	unmapFileMapping(&modelFileMapping);
+	*pOutVertexOffset = vertexOffset;
 	*pOutVertexCount = vertexCountForThisMaterial;
 
-	return k15_create_vertex_buffer(pContext, vertices.pData, vertices.count);
+	return true;
 }
 
 uint32_t getPositionOfNextNewLine(const char* pLine)
@@ -593,7 +592,18 @@ bool loadScnModel(software_rasterizer_context_t* pContext, loaded_model_t* pOutM
 	char correctModelPath[512];
 	sprintf(correctModelPath, "test_models/%s", modelPath);
 
-	pOutModel->vertexBuffers[0] = extractVerticesForMaterialFromWavefrontModel(pContext, correctModelPath, nullptr, &pOutModel->vertexCounts[0], scaleFactor);
+	dynamic_buffer_t<vertex_t> vertices = {};
+	if( !_k15_create_dynamic_buffer( &vertices, 128u ) )
+	{
+		return false;
+	}
+
+	if(!extractVerticesForMaterialFromWavefrontModel(&vertices, correctModelPath, nullptr, &pOutModel->vertexOffsets[0], &pOutModel->vertexCounts[0], scaleFactor))
+	{
+		return false;
+	}
+
+	pOutModel->vertexBuffer = k15_create_vertex_buffer(pContext, vertices.pData, vertices.count);
 	pOutModel->subModelCount = 1u;
 	return true;
 }
@@ -610,10 +620,19 @@ bool loadObjModel(software_rasterizer_context_t* pContext, loaded_model_t* pOutM
 	uint32_t materialCount = 0;
 	extractMaterialsFromWavefrontMaterial(materialPath, materials, &materialCount);
 
+	dynamic_buffer_t<vertex_t> vertices = {};
+	if( !_k15_create_dynamic_buffer( &vertices, 128u ) )
+	{
+		return false;
+	}
+
 	char texturePath[512];
 	for( uint32_t materialIndex = 0; materialIndex < materialCount; ++materialIndex )
 	{
-		model.vertexBuffers[materialIndex] = extractVerticesForMaterialFromWavefrontModel(pContext, modelPath, materials + materialIndex, &model.vertexCounts[materialIndex], scaleFactor);
+		if(!extractVerticesForMaterialFromWavefrontModel(&vertices, modelPath, materials + materialIndex, &model.vertexOffsets[materialIndex], &model.vertexCounts[materialIndex], scaleFactor))
+		{
+			return false;
+		}
 
 		sprintf(texturePath, "test_models/%s", materials[materialIndex].materialTexturePath);
 
@@ -626,6 +645,9 @@ bool loadObjModel(software_rasterizer_context_t* pContext, loaded_model_t* pOutM
 		model.textures[materialIndex] = k15_create_texture(pContext, materials[materialIndex].materialName, textureWidth, textureHeight, textureWidth, textureComponents, pImageData);
 		++model.subModelCount;
 	}
+
+	//FK: Create the vertex buffer only after all materials have been appended since the dynamic buffer might have been reallocated.
+	model.vertexBuffer = k15_create_vertex_buffer(pContext, vertices.pData, vertices.count);
 	
 	*pOutModel = model;
 	return true;
@@ -644,8 +666,9 @@ bool loadTriangle(software_rasterizer_context_t* pContext, loaded_model_t* pOutM
 	}
 
 	pOutModel->subModelCount 	= 1u;
-	pOutModel->vertexBuffers[0] = k15_create_vertex_buffer(pContext, test_quad_vertices, 6u);
+	pOutModel->vertexBuffer 	= k15_create_vertex_buffer(pContext, test_quad_vertices, 6u);
 	pOutModel->textures[0] 		= k15_create_texture(pContext, "triangle_test", textureWidth, textureHeight, textureWidth, textureComponents, pImageData);
+	pOutModel->vertexOffsets[0] = 0u;
 	pOutModel->vertexCounts[0] 	= 6u;
 
 	return true;
@@ -772,6 +795,11 @@ void K15_KeyInput(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
 	{
 		drawWireframe = !drawWireframe;
 	}
+
+	if(wparam == VK_F5 && firstKeyDown)
+	{
+		depthPrepassEnabled = !depthPrepassEnabled;
+	}
 }
 
 void K15_MouseButtonInput(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
@@ -987,7 +1015,7 @@ void pixelShader(const pixel_shader_input_t* pPixelShaderInput, pixel_shader_out
 #if 0
 	for( uint32_t pixelIndex = 0; pixelIndex < pixelCount; ++pixelIndex )
 	{
-		vector4f_t color = k15_create_vector4f(pPixelShaderInput->pVertexData[pixelIndex].texcoord.x, pPixelShaderInput->pVertexData[pixelIndex].texcoord.y, 0.0f, 1.0f);
+		vector4f_t color = k15_create_vector4f(pPixelShaderInput->attributes.pTexcoordU[pixelIndex], pPixelShaderInput->attributes.pTexcoordV[pixelIndex], 0.0f, 1.0f);
 		pPixelShaderOutput->pColor[pixelIndex] = color;
 	}
 #else
@@ -1024,22 +1052,12 @@ void pixelShader(const pixel_shader_input_t* pPixelShaderInput, pixel_shader_out
 #endif
 }
 
-bool setupThreadPool()
-{
-	return true;
-}
-
 loaded_model_t loadedModel = {};
 bool setup()
 {
-	pDepthBufferPixels = (float*)_mm_malloc(virtualScreenWidth * virtualScreenHeight * sizeof(float), 16);
+	pDepthBufferPixels = (float*)_mm_malloc(virtualScreenWidth * virtualScreenHeight * sizeof(float), 32);
 	memset(pDepthBufferPixels, 0, virtualScreenWidth * virtualScreenHeight * sizeof(float));
 
-	if(!setupThreadPool())
-	{
-		return false;
-	}
-
 	software_rasterizer_context_init_parameters_t parameters = k15_create_default_software_rasterizer_context_parameters(virtualScreenWidth, virtualScreenHeight, (void**)&pBackBufferPixels, (void**)&pDepthBufferPixels, 1u);
 	parameters.redShift 	= 16;
 	parameters.greenShift 	= 8;
@@ -1054,7 +1072,13 @@ bool setup()
 	k15_create_projection_matrix(&projectionMatrix, virtualScreenWidth, virtualScreenHeight, 0.2f, 20.f, 90.f);
 
 	vertexShaderHandle = k15_create_vertex_shader(pContext, vertexShader);
-	pixelShaderHandle = k15_create_pixel_shader(pContext, pixelShader);
+	//FK: The pixel shader only samples the texture, the other attributes don't need to be interpolated
+	pixel_shader_desc_t pixelShaderDesc = k15_create_default_pixel_shader_desc(pixelShader);
+	pixelShaderDesc.attributes[0] = vertex_attribute_t::texcoord;
+	pixelShaderDesc.attributeCount = 1u;
+	pixelShaderDesc.inputLayout = pixel_shader_input_layout_t::attribute_arrays;
+
+	pixelShaderHandle = k15_create_pixel_shader_from_desc(pContext, &pixelShaderDesc);
 	uniformBufferHandle = k15_create_uniform_buffer(pContext, sizeof(shaderData));
 
 	shaderData.lightCount = 1u;
@@ -1189,27 +1213,27 @@ void doFrame(float deltaTimeInMs)
 
 	pContext->settings.drawWireframe 	= drawWireframe;
 	pContext->settings.drawDepthBuffer 	= drawDepthBuffer;
+	pContext->settings.depthPrepassEnabled = depthPrepassEnabled;
 
+	k15_bind_vertex_buffer(pContext, loadedModel.vertexBuffer);
 #if 1
 	for( uint32_t subModelIndex = 0; subModelIndex < loadedModel.subModelCount; ++subModelIndex )
 	{
-		k15_bind_vertex_buffer(pContext, loadedModel.vertexBuffers[subModelIndex]);
 		k15_bind_texture(pContext, loadedModel.textures[subModelIndex], 0u);
 		shaderData.texture = loadedModel.textures[subModelIndex];
 		shaderData.normalMap = loadedModel.textures[1];
 		shaderData.viewDir = k15_create_vector4f(shaderData.viewProjMatrix.m20, shaderData.viewProjMatrix.m21, shaderData.viewProjMatrix.m22, 0.0f);
 		k15_set_uniform_buffer_data(uniformBufferHandle, &shaderData, sizeof(shaderData), 0u);
-		k15_draw(pContext, loadedModel.vertexCounts[subModelIndex], 0u);
+		k15_draw(pContext, loadedModel.vertexCounts[subModelIndex], loadedModel.vertexOffsets[subModelIndex]);
 	}
 #else
 	const uint32_t subModelIndex = 1u;
-	k15_bind_vertex_buffer(pContext, loadedModel.vertexBuffers[subModelIndex]);
 	k15_bind_texture(pContext, loadedModel.textures[subModelIndex], 0u);
 	shaderData.texture = loadedModel.textures[subModelIndex];
 	shaderData.normalMap = loadedModel.textures[1];
 	shaderData.viewDir = k15_create_vector4f(shaderData.viewProjMatrix.m20, shaderData.viewProjMatrix.m21, shaderData.viewProjMatrix.m22, 0.0f);
 	k15_set_uniform_buffer_data(uniformBufferHandle, &shaderData, sizeof(shaderData), 0u);
-	k15_draw(pContext, loadedModel.vertexCounts[subModelIndex], 0u);
+	k15_draw(pContext, loadedModel.vertexCounts[subModelIndex], loadedModel.vertexOffsets[subModelIndex]);
 #endif
 
 	k15_draw_frame(pContext);
@@ -1280,6 +1304,9 @@ int CALLBACK WinMain(HINSTANCE hInstance,
 		SetWindowText(hwnd, windowTitle);
 	}
 
+	k15_destroy_software_rasterizer_context(pContext);
+	_mm_free(pDepthBufferPixels);
+
 	DestroyWindow(hwnd);
 
 	return 0;